@@ -1,4 +1,4 @@
-QT       += core gui
+QT       += core gui concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -8,22 +8,75 @@ CONFIG += c++17
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# 导入时输出网格优化前后的ACMR和ATVR
+#DEFINES += MESH_OPTIMIZER_REPORT
+
 SOURCES += \
+    animation.cpp \
+    animator.cpp \
     camera.cpp \
+    conflictdetector.cpp \
+    frameuniforms.cpp \
+    geometrypool.cpp \
+    glstatecache.cpp \
+    gpuculler.cpp \
+    impostor.cpp \
+    instancebuffer.cpp \
     main.cpp \
     mainwindow.cpp \
+    material.cpp \
     mesh.cpp \
+    meshcache.cpp \
+    meshlet.cpp \
+    meshoptimizer.cpp \
+    meshsimplifier.cpp \
     model.cpp \
+    modelloader.cpp \
     myopenglwidget.cpp \
-    objectpose.cpp
+    objectpose.cpp \
+    programcache.cpp \
+    rendergraph.cpp \
+    renderqueue.cpp \
+    resourceiosystem.cpp \
+    resourcemanager.cpp \
+    scenegraph.cpp \
+    shaderpermutations.cpp \
+    stlloader.cpp \
+    streambuffer.cpp \
+    vertexformat.cpp
 
 HEADERS += \
+    animation.h \
+    animator.h \
     camera.h \
+    conflictdetector.h \
+    frameuniforms.h \
+    geometrypool.h \
+    glstatecache.h \
+    gpuculler.h \
+    impostor.h \
+    instancebuffer.h \
     mainwindow.h \
+    material.h \
     mesh.h \
+    meshcache.h \
+    meshlet.h \
+    meshoptimizer.h \
+    meshsimplifier.h \
     model.h \
+    modelloader.h \
     myopenglwidget.h \
-    objectpose.h
+    objectpose.h \
+    programcache.h \
+    rendergraph.h \
+    renderqueue.h \
+    resourceiosystem.h \
+    resourcemanager.h \
+    scenegraph.h \
+    shaderpermutations.h \
+    stlloader.h \
+    streambuffer.h \
+    vertexformat.h
 
 FORMS += \
     mainwindow.ui
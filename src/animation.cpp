@@ -0,0 +1,218 @@
+#include "animation.h"
+#include <QQuaternion>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define POSE_USE_SSE 1
+#endif
+
+namespace {
+
+// 查找time所在的关键帧区间[cursor, cursor + 1]：时间前进时从上次的位置往后找，倒退或循环回绕时二分查找
+template <typename Key>
+uint32_t FindKey(const vector<Key> &keys, float time, uint32_t &cursor)
+{
+    if (cursor >= keys.size() || keys[cursor].time > time)
+    {
+        auto it = std::upper_bound(keys.begin(), keys.end(), time, [](float t, const Key &key) { return t < key.time; });
+        cursor = it == keys.begin() ? 0 : (uint32_t)(it - keys.begin() - 1);
+    }
+    while (cursor + 1 < keys.size() && keys[cursor + 1].time <= time)
+        cursor++;
+    return cursor;
+}
+
+template <typename Key>
+float KeyFactor(const vector<Key> &keys, uint32_t cursor, float time)
+{
+    if (cursor + 1 >= keys.size())
+        return 0.0f;
+    float span = keys[cursor + 1].time - keys[cursor].time;
+    return span > 0.0f ? std::min(std::max((time - keys[cursor].time) / span, 0.0f), 1.0f) : 0.0f;
+}
+
+} // namespace
+
+void Pose::Resize(uint32_t node_count)
+{
+    this->node_count = node_count;
+    stride = (node_count + 3) & ~3u;
+    values.assign(POSE_COMPONENT_COUNT * stride, 0.0f);
+    std::fill(Component(POSE_RW), Component(POSE_RW) + stride, 1.0f);
+    std::fill(Component(POSE_SX), Component(POSE_SZ) + stride, 1.0f);
+}
+
+void Pose::SetFromMatrix(uint32_t node, const QMatrix4x4 &local)
+{
+    QVector3D axes[3] = {local.column(0).toVector3D(), local.column(1).toVector3D(), local.column(2).toVector3D()};
+    float scale[3] = {axes[0].length(), axes[1].length(), axes[2].length()};
+    // 镜像变换把负号放在x轴缩放上
+    if (QVector3D::dotProduct(QVector3D::crossProduct(axes[0], axes[1]), axes[2]) < 0.0f)
+        scale[0] = -scale[0];
+    QMatrix3x3 rotation;
+    for (int c = 0; c < 3; c++)
+    {
+        for (int r = 0; r < 3; r++)
+            rotation(r, c) = scale[c] != 0.0f ? axes[c][r] / scale[c] : (r == c ? 1.0f : 0.0f);
+    }
+    QQuaternion q = QQuaternion::fromRotationMatrix(rotation).normalized();
+
+    Component(POSE_TX)[node] = local(0, 3);
+    Component(POSE_TY)[node] = local(1, 3);
+    Component(POSE_TZ)[node] = local(2, 3);
+    Component(POSE_RX)[node] = q.x();
+    Component(POSE_RY)[node] = q.y();
+    Component(POSE_RZ)[node] = q.z();
+    Component(POSE_RW)[node] = q.scalar();
+    Component(POSE_SX)[node] = scale[0];
+    Component(POSE_SY)[node] = scale[1];
+    Component(POSE_SZ)[node] = scale[2];
+}
+
+QMatrix4x4 Pose::LocalMatrix(uint32_t node) const
+{
+    const float x = Component(POSE_RX)[node], y = Component(POSE_RY)[node], z = Component(POSE_RZ)[node], w = Component(POSE_RW)[node];
+    const float sx = Component(POSE_SX)[node], sy = Component(POSE_SY)[node], sz = Component(POSE_SZ)[node];
+    // T * R * S，按行给出
+    return QMatrix4x4((1.0f - 2.0f * (y * y + z * z)) * sx, 2.0f * (x * y - z * w) * sy, 2.0f * (x * z + y * w) * sz, Component(POSE_TX)[node],
+                      2.0f * (x * y + z * w) * sx, (1.0f - 2.0f * (x * x + z * z)) * sy, 2.0f * (y * z - x * w) * sz, Component(POSE_TY)[node],
+                      2.0f * (x * z - y * w) * sx, 2.0f * (y * z + x * w) * sy, (1.0f - 2.0f * (x * x + y * y)) * sz, Component(POSE_TZ)[node],
+                      0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+void Pose::Blend(const Pose &a, const Pose &b, float weight, Pose &out)
+{
+    if (&out != &a && &out != &b)
+    {
+        out.node_count = a.node_count;
+        out.stride = a.stride;
+        out.values.resize(a.values.size());
+    }
+    const uint32_t n = a.stride;
+    const PoseComponent_t linear[] = {POSE_TX, POSE_TY, POSE_TZ, POSE_SX, POSE_SY, POSE_SZ};
+
+#ifdef POSE_USE_SSE
+    const __m128 w = _mm_set1_ps(weight);
+    for (PoseComponent_t c : linear)
+    {
+        const float *pa = a.Component(c), *pb = b.Component(c);
+        float *po = out.Component(c);
+        for (uint32_t i = 0; i < n; i += 4)
+        {
+            __m128 va = _mm_loadu_ps(pa + i);
+            _mm_storeu_ps(po + i, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(pb + i), va), w)));
+        }
+    }
+
+    // 四元数q与-q表示同一旋转，点积为负时翻转b，保证沿最短路径插值
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const float *ax = a.Component(POSE_RX), *ay = a.Component(POSE_RY), *az = a.Component(POSE_RZ), *aw = a.Component(POSE_RW);
+    const float *bx = b.Component(POSE_RX), *by = b.Component(POSE_RY), *bz = b.Component(POSE_RZ), *bw = b.Component(POSE_RW);
+    float *ox = out.Component(POSE_RX), *oy = out.Component(POSE_RY), *oz = out.Component(POSE_RZ), *ow = out.Component(POSE_RW);
+    for (uint32_t i = 0; i < n; i += 4)
+    {
+        __m128 qax = _mm_loadu_ps(ax + i), qay = _mm_loadu_ps(ay + i), qaz = _mm_loadu_ps(az + i), qaw = _mm_loadu_ps(aw + i);
+        __m128 qbx = _mm_loadu_ps(bx + i), qby = _mm_loadu_ps(by + i), qbz = _mm_loadu_ps(bz + i), qbw = _mm_loadu_ps(bw + i);
+        __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(qax, qbx), _mm_mul_ps(qay, qby)),
+                                _mm_add_ps(_mm_mul_ps(qaz, qbz), _mm_mul_ps(qaw, qbw)));
+        __m128 flip = _mm_and_ps(dot, sign_mask);
+        qbx = _mm_xor_ps(qbx, flip);
+        qby = _mm_xor_ps(qby, flip);
+        qbz = _mm_xor_ps(qbz, flip);
+        qbw = _mm_xor_ps(qbw, flip);
+        __m128 rx = _mm_add_ps(qax, _mm_mul_ps(_mm_sub_ps(qbx, qax), w));
+        __m128 ry = _mm_add_ps(qay, _mm_mul_ps(_mm_sub_ps(qby, qay), w));
+        __m128 rz = _mm_add_ps(qaz, _mm_mul_ps(_mm_sub_ps(qbz, qaz), w));
+        __m128 rw = _mm_add_ps(qaw, _mm_mul_ps(_mm_sub_ps(qbw, qaw), w));
+        __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)),
+                                               _mm_add_ps(_mm_mul_ps(rz, rz), _mm_mul_ps(rw, rw))));
+        _mm_storeu_ps(ox + i, _mm_div_ps(rx, length));
+        _mm_storeu_ps(oy + i, _mm_div_ps(ry, length));
+        _mm_storeu_ps(oz + i, _mm_div_ps(rz, length));
+        _mm_storeu_ps(ow + i, _mm_div_ps(rw, length));
+    }
+#else
+    for (PoseComponent_t c : linear)
+    {
+        const float *pa = a.Component(c), *pb = b.Component(c);
+        float *po = out.Component(c);
+        for (uint32_t i = 0; i < n; i++)
+            po[i] = pa[i] + (pb[i] - pa[i]) * weight;
+    }
+    for (uint32_t i = 0; i < n; i++)
+    {
+        float qa[4], qb[4], r[4];
+        for (int k = 0; k < 4; k++)
+        {
+            qa[k] = a.Component((PoseComponent_t)(POSE_RX + k))[i];
+            qb[k] = b.Component((PoseComponent_t)(POSE_RX + k))[i];
+        }
+        float dot = qa[0] * qb[0] + qa[1] * qb[1] + qa[2] * qb[2] + qa[3] * qb[3];
+        float sign = dot < 0.0f ? -1.0f : 1.0f;
+        for (int k = 0; k < 4; k++)
+            r[k] = qa[k] + (qb[k] * sign - qa[k]) * weight;
+        float length = std::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + r[3] * r[3]);
+        for (int k = 0; k < 4; k++)
+            out.Component((PoseComponent_t)(POSE_RX + k))[i] = r[k] / length;
+    }
+#endif
+}
+
+void AnimationSampler::Sample(const AnimationClip &clip, float time, Pose &pose)
+{
+    // 换片段时重置关键帧缓存
+    if (p_clip != &clip)
+    {
+        p_clip = &clip;
+        cursors.assign(clip.channels.size(), Cursor{0, 0, 0});
+    }
+
+    float *tx = pose.Component(POSE_TX), *ty = pose.Component(POSE_TY), *tz = pose.Component(POSE_TZ);
+    float *rx = pose.Component(POSE_RX), *ry = pose.Component(POSE_RY), *rz = pose.Component(POSE_RZ), *rw = pose.Component(POSE_RW);
+    float *sx = pose.Component(POSE_SX), *sy = pose.Component(POSE_SY), *sz = pose.Component(POSE_SZ);
+    for (size_t c = 0; c < clip.channels.size(); c++)
+    {
+        const AnimationChannel &channel = clip.channels[c];
+        Cursor &cursor = cursors[c];
+        const uint32_t node = channel.node;
+
+        if (!channel.positions.empty())
+        {
+            uint32_t k = FindKey(channel.positions, time, cursor.position);
+            float f = KeyFactor(channel.positions, k, time);
+            const float *v0 = channel.positions[k].value;
+            const float *v1 = channel.positions[std::min<size_t>(k + 1, channel.positions.size() - 1)].value;
+            tx[node] = v0[0] + (v1[0] - v0[0]) * f;
+            ty[node] = v0[1] + (v1[1] - v0[1]) * f;
+            tz[node] = v0[2] + (v1[2] - v0[2]) * f;
+        }
+        if (!channel.rotations.empty())
+        {
+            uint32_t k = FindKey(channel.rotations, time, cursor.rotation);
+            float f = KeyFactor(channel.rotations, k, time);
+            const float *q0 = channel.rotations[k].value;
+            const float *q1 = channel.rotations[std::min<size_t>(k + 1, channel.rotations.size() - 1)].value;
+            float sign = q0[0] * q1[0] + q0[1] * q1[1] + q0[2] * q1[2] + q0[3] * q1[3] < 0.0f ? -1.0f : 1.0f;
+            float r[4];
+            for (int i = 0; i < 4; i++)
+                r[i] = q0[i] + (q1[i] * sign - q0[i]) * f;
+            float length = std::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + r[3] * r[3]);
+            rx[node] = r[0] / length;
+            ry[node] = r[1] / length;
+            rz[node] = r[2] / length;
+            rw[node] = r[3] / length;
+        }
+        if (!channel.scalings.empty())
+        {
+            uint32_t k = FindKey(channel.scalings, time, cursor.scaling);
+            float f = KeyFactor(channel.scalings, k, time);
+            const float *v0 = channel.scalings[k].value;
+            const float *v1 = channel.scalings[std::min<size_t>(k + 1, channel.scalings.size() - 1)].value;
+            sx[node] = v0[0] + (v1[0] - v0[0]) * f;
+            sy[node] = v0[1] + (v1[1] - v0[1]) * f;
+            sz[node] = v0[2] + (v1[2] - v0[2]) * f;
+        }
+    }
+}
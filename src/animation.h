@@ -0,0 +1,144 @@
+/**
+  ******************************************************************************
+  * @file           : animation.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了骨骼/节点动画的数据结构和采样、混合函数。动画片段由Assimp的aiAnimation
+  * 导入，每个通道对应场景图中的一个节点；姿态（Pose）按分量分开存放（SoA），所有节点的同一
+  * 分量连续，混合时用SIMD一次处理4个节点；采样器为每个通道缓存上一次的关键帧位置，正常播放时
+  * 查找关键帧的代价为常数
+  ******************************************************************************
+  * @attention
+  *     姿态覆盖模型的所有场景图节点，未被动画驱动的节点保持绑定姿态；
+  * 旋转用四元数（x, y, z, w）表示，关键帧之间用最短路径的归一化线性插值
+  ******************************************************************************
+  */
+
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <QMatrix4x4>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+// 位置/缩放关键帧，时间单位为tick
+struct VectorKey {
+    float time;
+    float value[3];
+};
+
+// 旋转关键帧，四元数按x, y, z, w存放
+struct QuatKey {
+    float time;
+    float value[4];
+};
+
+// 一个节点的动画通道
+struct AnimationChannel {
+    uint32_t node;
+    vector<VectorKey> positions;
+    vector<QuatKey> rotations;
+    vector<VectorKey> scalings;
+};
+
+// 动画片段
+struct AnimationClip {
+    string name;
+    float duration;             // 时长（tick）
+    float ticks_per_second;
+    vector<AnimationChannel> channels;
+};
+
+// 骨骼：绑定的节点和逆绑定矩阵（网格空间 -> 骨骼空间）
+struct Bone {
+    string name;
+    uint32_t node;
+    QMatrix4x4 offset;
+};
+
+// 姿态分量，每个分量为所有节点的一段连续数组
+typedef enum
+{
+    POSE_TX, POSE_TY, POSE_TZ,
+    POSE_RX, POSE_RY, POSE_RZ, POSE_RW,
+    POSE_SX, POSE_SY, POSE_SZ,
+    POSE_COMPONENT_COUNT,
+} PoseComponent_t;
+
+class Pose
+{
+public:
+    /**
+      * @brief  设置节点数量，每个分量的长度补齐到4的倍数，补齐部分为单位变换
+      * @author agent
+      * @param  node_count: 节点数量
+      * @retval none
+      */
+    void Resize(uint32_t node_count);
+
+    /**
+      * @brief  把节点的局部变换矩阵分解为平移、旋转和缩放写入姿态
+      * @author agent
+      * @param  node: 节点编号
+      * @param  local: 局部变换，不能含切变
+      * @retval none
+      */
+    void SetFromMatrix(uint32_t node, const QMatrix4x4 &local);
+
+    /**
+      * @brief  由平移、旋转和缩放合成节点的局部变换矩阵
+      * @author agent
+      * @param  node: 节点编号
+      * @retval 局部变换
+      */
+    QMatrix4x4 LocalMatrix(uint32_t node) const;
+
+    /**
+      * @brief  混合两个姿态：平移和缩放线性插值，旋转按最短路径归一化线性插值，支持时用SSE一次处理4个节点
+      * @author agent
+      * @param  a: 起始姿态
+      * @param  b: 目标姿态，节点数必须与a相同
+      * @param  weight: b的权重，0~1
+      * @param  out: 输出的姿态，可以与a或b相同
+      * @retval none
+      */
+    static void Blend(const Pose &a, const Pose &b, float weight, Pose &out);
+
+    float *Component(PoseComponent_t component) { return values.data() + component * stride; }
+    const float *Component(PoseComponent_t component) const { return values.data() + component * stride; }
+
+    uint32_t node_count = 0;
+    uint32_t stride = 0;        // 每个分量的长度（4的倍数）
+    vector<float> values;
+};
+
+class AnimationSampler
+{
+public:
+    /**
+      * @brief  在指定时间采样动画片段，写入被驱动节点的平移、旋转和缩放，其余节点不变
+      * @author agent
+      * @param  clip: 动画片段
+      * @param  time: 时间（tick），已折算到片段时长内
+      * @param  pose: 输出的姿态
+      * @retval none
+      */
+    void Sample(const AnimationClip &clip, float time, Pose &pose);
+
+private:
+    // 每个通道上一次所在的关键帧
+    struct Cursor {
+        uint32_t position;
+        uint32_t rotation;
+        uint32_t scaling;
+    };
+    vector<Cursor> cursors;
+    const AnimationClip *p_clip = nullptr;
+};
+
+#endif // ANIMATION_H
@@ -0,0 +1,83 @@
+#include "animator.h"
+#include "model.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Assimp约定：片段未给出帧率时按每秒25 tick播放
+const float kDefaultTicksPerSecond = 25.0f;
+
+} // namespace
+
+Animator::Animator(const Model &model)
+    : p_model(&model), fade_duration(0.0f), fade_elapsed(0.0f)
+{
+    const SceneGraph &graph = model.scene_graph;
+    bind_pose.Resize(graph.NodeCount());
+    for (uint32_t node = 0; node < graph.NodeCount(); node++)
+        bind_pose.SetFromMatrix(node, graph.locals[node]);
+    current_pose = bind_pose;
+    previous_pose = bind_pose;
+    current = Track{-1, 0.0f, true, AnimationSampler()};
+    previous = current;
+
+    node_worlds.resize(graph.NodeCount());
+    matrices.resize((graph.NodeCount() + model.bones.size()) * 16);
+    // 绑定姿态下的矩阵，首次Update前也可以直接上传
+    Update(0.0f);
+}
+
+void Animator::Play(int clip, float fade_seconds, bool loop)
+{
+    if (clip >= (int)p_model->animations.size())
+        clip = -1;
+    previous = current;
+    current = Track{clip, 0.0f, loop, AnimationSampler()};
+    fade_duration = fade_seconds;
+    fade_elapsed = 0.0f;
+}
+
+void Animator::SampleTrack(Track &track, float delta_seconds, Pose &pose)
+{
+    // 姿态整体复制绑定姿态，再覆盖被驱动的节点
+    pose.values = bind_pose.values;
+    track.time += delta_seconds;
+    if (track.clip < 0)
+        return;
+
+    const AnimationClip &clip = p_model->animations[track.clip];
+    const float ticks_per_second = clip.ticks_per_second > 0.0f ? clip.ticks_per_second : kDefaultTicksPerSecond;
+    float ticks = track.time * ticks_per_second;
+    if (clip.duration > 0.0f)
+        ticks = track.loop ? std::fmod(ticks, clip.duration) : std::min(ticks, clip.duration);
+    track.sampler.Sample(clip, ticks, pose);
+}
+
+void Animator::Update(float delta_seconds)
+{
+    SampleTrack(current, delta_seconds, current_pose);
+    if (fade_elapsed < fade_duration)
+    {
+        fade_elapsed += delta_seconds;
+        SampleTrack(previous, delta_seconds, previous_pose);
+        Pose::Blend(previous_pose, current_pose, std::min(fade_elapsed / fade_duration, 1.0f), current_pose);
+    }
+
+    // 场景图按先序存放，父节点的世界变换总是先算好
+    const SceneGraph &graph = p_model->scene_graph;
+    for (uint32_t node = 0; node < graph.NodeCount(); node++)
+    {
+        const int32_t parent = graph.parents[node];
+        node_worlds[node] = parent == SceneGraph::kNoParent ? current_pose.LocalMatrix(node) : node_worlds[parent] * current_pose.LocalMatrix(node);
+        std::memcpy(&matrices[node * 16], node_worlds[node].constData(), 16 * sizeof(float));
+    }
+    // 蒙皮矩阵把绑定姿态下网格空间的顶点变换到当前姿态的模型空间
+    const vector<Bone> &bones = p_model->bones;
+    for (size_t b = 0; b < bones.size(); b++)
+    {
+        QMatrix4x4 skin = node_worlds[bones[b].node] * bones[b].offset;
+        std::memcpy(&matrices[(graph.NodeCount() + b) * 16], skin.constData(), 16 * sizeof(float));
+    }
+}
@@ -0,0 +1,88 @@
+/**
+  ******************************************************************************
+  * @file           : animator.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了动画播放器类的定义。每个飞机实例一个播放器，共享模型的场景图、骨骼和
+  * 动画片段；每帧采样当前片段（淡入淡出时同时采样上一个片段并混合），沿场景图计算各节点的
+  * 世界变换和骨骼的蒙皮矩阵。CPU端只处理节点和骨骼，不处理任何顶点，刚体部件（螺旋桨、
+  * 起落架、舵面）在着色器中按节点编号取变换，蒙皮网格在着色器中按骨骼混合
+  ******************************************************************************
+  * @attention
+  *     matrices中前node_count个为节点的世界变换，之后为骨骼的蒙皮矩阵；
+  * 由InstanceBuffer把所有实例的矩阵拼接后一起上传到SSBO绑定点1
+  ******************************************************************************
+  */
+
+#ifndef ANIMATOR_H
+#define ANIMATOR_H
+
+#include "animation.h"
+
+class Model;
+
+class Animator
+{
+public:
+    /**
+      * @brief  构造函数，以模型的场景图为绑定姿态
+      * @author agent
+      * @param  model: 模型，生命周期必须长于播放器
+      * @retval none
+      */
+    explicit Animator(const Model &model);
+    Animator(const Animator &) = delete;
+    Animator &operator=(const Animator &) = delete;
+
+    /**
+      * @brief  播放动画片段
+      * @author agent
+      * @param  clip: 片段编号，-1为绑定姿态
+      * @param  fade_seconds: 从当前片段过渡的时间（秒），0为立即切换
+      * @param  loop: 是否循环
+      * @retval none
+      */
+    void Play(int clip, float fade_seconds = 0.0f, bool loop = true);
+
+    /**
+      * @brief  推进时间，采样并混合姿态，计算节点和骨骼矩阵
+      * @author agent
+      * @param  delta_seconds: 距上一次更新的时间（秒）
+      * @retval none
+      */
+    void Update(float delta_seconds);
+
+    // 各节点相对模型的世界变换，Update后有效
+    vector<QMatrix4x4> node_worlds;
+    // 上传用的列主序矩阵：节点的世界变换后接骨骼的蒙皮矩阵，Update后有效
+    vector<float> matrices;
+
+private:
+    // 一个播放中的片段
+    struct Track {
+        int clip;
+        float time;             // 秒
+        bool loop;
+        AnimationSampler sampler;
+    };
+
+    /**
+      * @brief  推进片段时间并采样到姿态
+      * @author agent
+      * @param  track: 片段
+      * @param  delta_seconds: 推进的时间（秒）
+      * @param  pose: 输出的姿态，先复制绑定姿态
+      * @retval none
+      */
+    void SampleTrack(Track &track, float delta_seconds, Pose &pose);
+
+    const Model *p_model;
+
+    Track current, previous;
+    float fade_duration, fade_elapsed;
+
+    Pose bind_pose, current_pose, previous_pose;
+};
+
+#endif // ANIMATOR_H
@@ -0,0 +1,311 @@
+#include "conflictdetector.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CONFLICT_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// 网格坐标的范围，超出的截断到边界
+const int32_t kCellCoordLimit = 1 << 24;
+// 每架飞机最多加入的网格数，扫掠包围盒覆盖更多网格的飞机（速度异常大或位置跳变）直接与所有飞机检测
+const int64_t kMaxCellsPerAircraft = 64;
+
+// 浮点的网格坐标转为整数：超出int32范围的转换是未定义行为，先截断到±kCellCoordLimit；
+// 截断是单调的，原本相交的包围盒截断后仍然相交，只会多出候选对
+inline int32_t CellCoord(float value)
+{
+    const float limit = (float)kCellCoordLimit;
+    // 比较写成这样使NaN也落到下边界
+    if (!(value > -limit))
+        return -kCellCoordLimit;
+    if (value > limit)
+        return kCellCoordLimit;
+    return (int32_t)std::floor(value);
+}
+
+// 网格坐标的哈希，哈希冲突只会增加候选对的数量，不影响结果正确性
+inline uint32_t HashCell(int32_t x, int32_t y, int32_t z)
+{
+    uint32_t h = (uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)z * 83492791u;
+    return h * 2654435761u;
+}
+
+// 一组（4对）CPA计算的输入与输出，dp为相对位置，dv为相对速度
+struct CpaBatch {
+    alignas(16) float dpx[4], dpy[4], dpz[4];
+    alignas(16) float dvx[4], dvy[4], dvz[4];
+    alignas(16) float t_cpa[4], d2_cpa[4];
+    uint32_t a[4], b[4];
+    int count = 0;
+};
+
+/**
+  * @brief  计算4对飞机在[0, lookahead]内的最近接近时间及最近距离的平方
+  *         t* = clamp(-(dp·dv) / (dv·dv), 0, lookahead)，d² = |dp + dv * t*|²
+  * @param  batch: 输入输出批次，未使用的通道填零即可
+  * @param  lookahead: 预测时间窗口
+  * @retval none
+  */
+void ComputeCpa4(CpaBatch &batch, float lookahead)
+{
+#ifdef CONFLICT_USE_SSE
+    const __m128 dpx = _mm_load_ps(batch.dpx), dpy = _mm_load_ps(batch.dpy), dpz = _mm_load_ps(batch.dpz);
+    const __m128 dvx = _mm_load_ps(batch.dvx), dvy = _mm_load_ps(batch.dvy), dvz = _mm_load_ps(batch.dvz);
+
+    __m128 pv = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dpx, dvx), _mm_mul_ps(dpy, dvy)), _mm_mul_ps(dpz, dvz));
+    __m128 vv = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dvx, dvx), _mm_mul_ps(dvy, dvy)), _mm_mul_ps(dvz, dvz));
+    vv = _mm_max_ps(vv, _mm_set1_ps(1e-12f));
+
+    __m128 t = _mm_div_ps(_mm_sub_ps(_mm_setzero_ps(), pv), vv);
+    t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), _mm_set1_ps(lookahead));
+
+    __m128 cx = _mm_add_ps(dpx, _mm_mul_ps(dvx, t));
+    __m128 cy = _mm_add_ps(dpy, _mm_mul_ps(dvy, t));
+    __m128 cz = _mm_add_ps(dpz, _mm_mul_ps(dvz, t));
+    __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy)), _mm_mul_ps(cz, cz));
+
+    _mm_store_ps(batch.t_cpa, t);
+    _mm_store_ps(batch.d2_cpa, d2);
+#else
+    for (int k = 0; k < 4; k++)
+    {
+        float pv = batch.dpx[k] * batch.dvx[k] + batch.dpy[k] * batch.dvy[k] + batch.dpz[k] * batch.dvz[k];
+        float vv = std::max(batch.dvx[k] * batch.dvx[k] + batch.dvy[k] * batch.dvy[k] + batch.dvz[k] * batch.dvz[k], 1e-12f);
+        float t = std::min(std::max(-pv / vv, 0.0f), lookahead);
+        float cx = batch.dpx[k] + batch.dvx[k] * t;
+        float cy = batch.dpy[k] + batch.dvy[k] * t;
+        float cz = batch.dpz[k] + batch.dvz[k] * t;
+        batch.t_cpa[k] = t;
+        batch.d2_cpa[k] = cx * cx + cy * cy + cz * cz;
+    }
+#endif
+}
+
+} // namespace
+
+ConflictDetector::ConflictDetector(float separation_min, float lookahead_seconds)
+    : separation_min(separation_min), lookahead_seconds(lookahead_seconds)
+{
+}
+
+void ConflictDetector::Resize(uint32_t count)
+{
+    pos_x.resize(count, 0.0f);
+    pos_y.resize(count, 0.0f);
+    pos_z.resize(count, 0.0f);
+    vel_x.resize(count, 0.0f);
+    vel_y.resize(count, 0.0f);
+    vel_z.resize(count, 0.0f);
+    last_timestamp.resize(count, -1.0);
+    conflict_flags.resize(count, 0);
+}
+
+void ConflictDetector::UpdatePose(uint32_t id, const QVector3D &position, double timestamp_s)
+{
+    if (id >= pos_x.size())
+        Resize(id + 1);
+
+    // 由相邻两次位置差分得到速度，同一时刻的重复更新只刷新位置
+    double dt = timestamp_s - last_timestamp[id];
+    if (last_timestamp[id] >= 0.0 && dt > 1e-6)
+    {
+        vel_x[id] = (float)((position.x() - pos_x[id]) / dt);
+        vel_y[id] = (float)((position.y() - pos_y[id]) / dt);
+        vel_z[id] = (float)((position.z() - pos_z[id]) / dt);
+    }
+    pos_x[id] = position.x();
+    pos_y[id] = position.y();
+    pos_z[id] = position.z();
+    last_timestamp[id] = timestamp_s;
+}
+
+void ConflictDetector::Detect(void)
+{
+    const size_t count = pos_x.size();
+    conflict_flags.assign(count, 0);
+    conflict_pairs.clear();
+    if (count < 2)
+        return;
+
+    // 网格边长取最小间隔与平均扫掠长度中的较大者，使每架飞机覆盖的网格数保持在常数级
+    double sweep_sum = 0.0;
+    for (size_t i = 0; i < count; i++)
+    {
+        float ex = std::fabs(vel_x[i]), ey = std::fabs(vel_y[i]), ez = std::fabs(vel_z[i]);
+        sweep_sum += std::max(ex, std::max(ey, ez)) * lookahead_seconds;
+    }
+    float cell_size = std::max(separation_min, (float)(sweep_sum / count));
+
+    BuildGrid(cell_size);
+
+    // 遍历每个网格（排序后高32位相同的连续条目），收集候选对后统一计算CPA
+    candidates.clear();
+    size_t begin = 0;
+    while (begin < cell_entries.size())
+    {
+        uint32_t key = (uint32_t)(cell_entries[begin] >> 32);
+        size_t end = begin + 1;
+        while (end < cell_entries.size() && (uint32_t)(cell_entries[end] >> 32) == key)
+            end++;
+        if (end - begin > 1)
+            TestCell(begin, end, key);
+        begin = end;
+    }
+    TestOversized();
+    TestCandidates();
+}
+
+bool ConflictDetector::IsInConflict(uint32_t id) const
+{
+    return id < conflict_flags.size() && conflict_flags[id] != 0;
+}
+
+void ConflictDetector::BuildGrid(float cell_size)
+{
+    const size_t count = pos_x.size();
+    const float half_sep = separation_min * 0.5f;
+    const float inv_cell = 1.0f / cell_size;
+
+    cell_min.resize(count * 3);
+    cell_max.resize(count * 3);
+    cell_entries.clear();
+    oversized.clear();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (last_timestamp[i] < 0.0)
+        {
+            // 尚未收到位置的飞机不参与检测
+            cell_min[i * 3 + 0] = 1;
+            cell_max[i * 3 + 0] = 0;
+            continue;
+        }
+        const float p[3] = {pos_x[i], pos_y[i], pos_z[i]};
+        const float v[3] = {vel_x[i], vel_y[i], vel_z[i]};
+        for (int k = 0; k < 3; k++)
+        {
+            // 扫掠包围盒：当前位置到预测终点，再向外扩展半个最小间隔
+            float end_p = p[k] + v[k] * lookahead_seconds;
+            float lo = std::min(p[k], end_p) - half_sep;
+            float hi = std::max(p[k], end_p) + half_sep;
+            cell_min[i * 3 + k] = CellCoord(lo * inv_cell);
+            cell_max[i * 3 + k] = CellCoord(hi * inv_cell);
+        }
+        int64_t cells = 1;
+        for (int k = 0; k < 3; k++)
+            cells *= (int64_t)cell_max[i * 3 + k] - cell_min[i * 3 + k] + 1;
+        if (cells > kMaxCellsPerAircraft)
+        {
+            oversized.push_back((uint32_t)i);
+            continue;
+        }
+        for (int32_t x = cell_min[i * 3 + 0]; x <= cell_max[i * 3 + 0]; x++)
+            for (int32_t y = cell_min[i * 3 + 1]; y <= cell_max[i * 3 + 1]; y++)
+                for (int32_t z = cell_min[i * 3 + 2]; z <= cell_max[i * 3 + 2]; z++)
+                    cell_entries.push_back(((uint64_t)HashCell(x, y, z) << 32) | (uint64_t)i);
+    }
+
+    // 按(网格键, 飞机编号)排序，同一网格的飞机相邻，同一网格内的重复条目也相邻
+    std::sort(cell_entries.begin(), cell_entries.end());
+    cell_entries.erase(std::unique(cell_entries.begin(), cell_entries.end()), cell_entries.end());
+}
+
+void ConflictDetector::TestCell(size_t begin, size_t end, uint32_t cell_key)
+{
+    for (size_t m = begin; m < end; m++)
+    {
+        const uint32_t i = (uint32_t)cell_entries[m];
+        for (size_t n = m + 1; n < end; n++)
+        {
+            const uint32_t j = (uint32_t)cell_entries[n];
+
+            // 包围盒在网格坐标下的交集，不相交则剔除；
+            // 一对飞机可能共享多个网格，只在交集最小角所在的网格中检测，保证每对只算一次
+            int32_t lo[3];
+            bool overlap = true;
+            for (int k = 0; k < 3; k++)
+            {
+                lo[k] = std::max(cell_min[i * 3 + k], cell_min[j * 3 + k]);
+                int32_t hi = std::min(cell_max[i * 3 + k], cell_max[j * 3 + k]);
+                overlap = overlap && lo[k] <= hi;
+            }
+            if (!overlap || HashCell(lo[0], lo[1], lo[2]) != cell_key)
+                continue;
+            candidates.push_back(((uint64_t)i << 32) | j);
+        }
+    }
+}
+
+void ConflictDetector::TestOversized(void)
+{
+    const size_t count = pos_x.size();
+    for (uint32_t i : oversized)
+    {
+        for (uint32_t j = 0; j < count; j++)
+        {
+            // 未参与检测的飞机x范围为空；两架都超限时只在编号较小的一架这里检测
+            if (j == i || cell_min[j * 3 + 0] > cell_max[j * 3 + 0])
+                continue;
+            if (j < i && std::binary_search(oversized.begin(), oversized.end(), j))
+                continue;
+            bool overlap = true;
+            for (int k = 0; k < 3; k++)
+            {
+                overlap = overlap && std::max(cell_min[i * 3 + k], cell_min[j * 3 + k]) <=
+                                     std::min(cell_max[i * 3 + k], cell_max[j * 3 + k]);
+            }
+            if (overlap)
+                candidates.push_back(((uint64_t)i << 32) | j);
+        }
+    }
+}
+
+void ConflictDetector::TestCandidates(void)
+{
+    const float sep2 = separation_min * separation_min;
+    CpaBatch batch;
+
+    auto flush = [&]() {
+        if (batch.count == 0)
+            return;
+        // 空余通道填零，计算结果不使用
+        for (int k = batch.count; k < 4; k++)
+        {
+            batch.dpx[k] = batch.dpy[k] = batch.dpz[k] = 0.0f;
+            batch.dvx[k] = batch.dvy[k] = batch.dvz[k] = 0.0f;
+        }
+        ComputeCpa4(batch, lookahead_seconds);
+        for (int k = 0; k < batch.count; k++)
+        {
+            if (batch.d2_cpa[k] < sep2)
+            {
+                conflict_flags[batch.a[k]] = 1;
+                conflict_flags[batch.b[k]] = 1;
+                conflict_pairs.push_back({batch.a[k], batch.b[k], batch.t_cpa[k], std::sqrt(batch.d2_cpa[k])});
+            }
+        }
+        batch.count = 0;
+    };
+
+    for (uint64_t candidate : candidates)
+    {
+        const uint32_t i = (uint32_t)(candidate >> 32);
+        const uint32_t j = (uint32_t)candidate;
+        int k = batch.count++;
+        batch.a[k] = i;
+        batch.b[k] = j;
+        batch.dpx[k] = pos_x[j] - pos_x[i];
+        batch.dpy[k] = pos_y[j] - pos_y[i];
+        batch.dpz[k] = pos_z[j] - pos_z[i];
+        batch.dvx[k] = vel_x[j] - vel_x[i];
+        batch.dvy[k] = vel_y[j] - vel_y[i];
+        batch.dvz[k] = vel_z[j] - vel_z[i];
+        if (batch.count == 4)
+            flush();
+    }
+    flush();
+}
@@ -0,0 +1,139 @@
+/**
+  ******************************************************************************
+  * @file           : conflictdetector.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了飞行冲突预测类的定义，根据连续的ObjectPose位置更新推算每架飞机的速度，
+  * 在预测时间窗口内计算两两之间的最近接近点（CPA），标记预计突破最小间隔的飞机对
+  * 位置与速度按SoA（分量数组）存储，先用均匀网格对扫掠包围盒做空间预筛选，再用SIMD批量计算CPA
+  ******************************************************************************
+  * @attention
+  *     预筛选的正确性：若两机在[0, T]内某时刻距离小于最小间隔d，则两机在该时刻分别位于
+  * 各自扫掠包围盒（外扩d/2）之内，故两个包围盒必然相交，不相交的飞机对可直接剔除；
+  * 包围盒覆盖网格过多的飞机（速度异常或位置跳变）不加入网格，直接与所有飞机检测，网格规模有上限
+  ******************************************************************************
+  */
+
+#ifndef CONFLICTDETECTOR_H
+#define CONFLICTDETECTOR_H
+
+#include <QVector3D>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+
+// 冲突飞机对，包括两架飞机的编号、到达最近接近点的时间和最近接近距离
+struct ConflictPair {
+    uint32_t a;
+    uint32_t b;
+    float time_to_cpa;
+    float distance_at_cpa;
+};
+
+class ConflictDetector
+{
+public:
+    // 冲突判定参数
+    float separation_min;       // 最小间隔距离
+    float lookahead_seconds;    // 预测时间窗口，单位：秒
+
+    // 检测结果，conflict_flags按飞机编号索引，非零表示需要高亮显示
+    vector<uint8_t> conflict_flags;
+    vector<ConflictPair> conflict_pairs;
+
+public:
+    /**
+      * @brief  构造函数，设置冲突判定参数
+      * @author agent
+      * @param  separation_min: 最小间隔距离
+      * @param  lookahead_seconds: 预测时间窗口，单位：秒
+      * @retval none
+      */
+    ConflictDetector(float separation_min, float lookahead_seconds);
+
+    /**
+      * @brief  设置参与检测的飞机数量，新增飞机的速度在收到两次位置更新之前视为零
+      * @author agent
+      * @param  count: 飞机数量，飞机编号为[0, count)
+      * @retval none
+      */
+    void Resize(uint32_t count);
+
+    /**
+      * @brief  输入一架飞机的位置更新，与上一次更新做差分得到速度
+      * @author agent
+      * @param  id: 飞机编号
+      * @param  position: 当前位置，即ObjectPose::position_vec
+      * @param  timestamp_s: 位置对应的时刻，单位：秒
+      * @retval none
+      */
+    void UpdatePose(uint32_t id, const QVector3D &position, double timestamp_s);
+
+    /**
+      * @brief  执行一次冲突检测，结果写入conflict_flags和conflict_pairs
+      * @author agent
+      * @param  none
+      * @retval none
+      */
+    void Detect(void);
+
+    /**
+      * @brief  查询飞机是否处于预测冲突中
+      * @author agent
+      * @param  id: 飞机编号
+      * @retval 是否冲突
+      */
+    bool IsInConflict(uint32_t id) const;
+
+private:
+    // SoA存储的位置、速度以及上一次更新的时刻
+    vector<float> pos_x, pos_y, pos_z;
+    vector<float> vel_x, vel_y, vel_z;
+    vector<double> last_timestamp;
+
+    // 空间网格：每架飞机扫掠包围盒覆盖的网格范围，以及(网格键, 飞机编号)条目
+    vector<int32_t> cell_min, cell_max;     // 每架飞机3个分量
+    vector<uint64_t> cell_entries;          // 高32位为网格键，低32位为飞机编号
+    vector<uint32_t> oversized;             // 覆盖网格过多、不加入网格的飞机，按编号递增
+    vector<uint64_t> candidates;            // 包围盒相交的候选对，高32位和低32位为两架飞机的编号
+
+    /**
+      * @brief  构建空间网格：计算每架飞机在预测窗口内的扫掠包围盒，并按网格键排序；
+      *         覆盖网格超过上限的飞机不加入网格，记入oversized
+      * @author agent
+      * @param  cell_size: 网格边长
+      * @retval none
+      */
+    void BuildGrid(float cell_size);
+
+    /**
+      * @brief  收集同一网格内包围盒相交的飞机对
+      * @author agent
+      * @param  begin: 网格内第一个条目的下标
+      * @param  end: 网格内最后一个条目的下一个下标
+      * @param  cell_key: 当前网格的哈希键
+      * @retval none
+      */
+    void TestCell(size_t begin, size_t end, uint32_t cell_key);
+
+    /**
+      * @brief  收集oversized中的飞机与其他所有飞机之间包围盒相交的飞机对
+      * @author agent
+      * @param  none
+      * @retval none
+      */
+    void TestOversized(void);
+
+    /**
+      * @brief  对所有候选对做CPA检测，按4对一组使用SIMD计算
+      * @author agent
+      * @param  none
+      * @retval none
+      */
+    void TestCandidates(void);
+};
+
+#endif // CONFLICTDETECTOR_H
@@ -0,0 +1,40 @@
+#include "frameuniforms.h"
+#include "glstatecache.h"
+#include <algorithm>
+#include <cstring>
+
+FrameUniforms::FrameUniforms(QOpenGLFunctions_4_5_Core *gl_funs, uint32_t view_count)
+    : p_gl_funs(gl_funs), p_gl_state(&GLStateCache::Current()), p_stream_buffer(&StreamBuffer::Current()),
+      view_count(std::max(view_count, 1u)), uploaded{nullptr, 0, 0, 0}
+{
+    const size_t alignment = p_stream_buffer->uniform_alignment;
+    stride = (sizeof(FrameData) + alignment - 1) / alignment * alignment;
+}
+
+void FrameUniforms::Begin(void)
+{
+    // 上一帧仍在读取的数据在流式缓冲的另一段中，不需要等待
+    uploaded = p_stream_buffer->Allocate(stride * view_count, p_stream_buffer->uniform_alignment);
+}
+
+void FrameUniforms::Set(uint32_t index, const QMatrix4x4 &projection, const QMatrix4x4 &view, const QVector3D &view_pos,
+                        const QVector3D &light_position, const QVector3D &light_color)
+{
+    // 映射内存只写不读，逐个字段写入
+    FrameData &frame = *reinterpret_cast<FrameData *>(uploaded.p_data + std::min(index, view_count - 1) * stride);
+    std::memcpy(frame.projection, projection.constData(), sizeof(frame.projection));
+    std::memcpy(frame.view, view.constData(), sizeof(frame.view));
+    for (int k = 0; k < 3; k++)
+    {
+        frame.view_pos[k] = view_pos[k];
+        frame.light_position[k] = light_position[k];
+        frame.light_color[k] = light_color[k];
+    }
+    frame.view_pos[3] = frame.light_position[3] = frame.light_color[3] = 1.0f;
+}
+
+void FrameUniforms::Bind(uint32_t index)
+{
+    p_gl_state->BindBufferRange(GL_UNIFORM_BUFFER, kFrameUniformBinding, uploaded.buffer,
+                                uploaded.offset + std::min(index, view_count - 1) * stride, sizeof(FrameData));
+}
@@ -0,0 +1,96 @@
+/**
+  ******************************************************************************
+  * @file           : frameuniforms.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了逐帧uniform缓冲的定义。投影、观察矩阵、相机位置和光源等每帧不变的数据
+  * 以std140布局写入一个UBO，所有着色器通过同一个绑定点的FrameBlock读取，每帧只上传一次，
+  * 不再在每个着色器程序上按名字逐个设置；一帧中有多个视图（如主相机和覆盖层、公告板烘焙的各个视角）
+  * 时每个视图占一段，绘制前绑定对应的区间；每帧在流式缓冲（见StreamBuffer）的当前帧分配一次，Set直接写入映射内存
+  ******************************************************************************
+  * @attention
+  *     FrameData须与各着色器中的FrameBlock一致，绑定点为kFrameUniformBinding；
+  * 分配只在当前帧有效，每帧绘制前须重新Begin并Set用到的所有视图；
+  * 需要在OpenGL上下文为当前时构造和使用
+  ******************************************************************************
+  */
+
+#ifndef FRAMEUNIFORMS_H
+#define FRAMEUNIFORMS_H
+
+#include <QMatrix4x4>
+#include <QOpenGLFunctions_4_5_Core>
+#include <QVector3D>
+#include "streambuffer.h"
+#include <cstdint>
+
+class GLStateCache;
+
+// 逐帧数据的UBO绑定点，与着色器中FrameBlock的binding一致
+const unsigned int kFrameUniformBinding = 0;
+
+// 一个视图的逐帧数据，与着色器中的FrameBlock（std140）一致，vec3补齐为vec4
+struct FrameData {
+    float projection[16];
+    float view[16];
+    float view_pos[4];
+    float light_position[4];
+    float light_color[4];
+};
+static_assert(sizeof(FrameData) == 176, "FrameData must match the std140 layout");
+
+class FrameUniforms
+{
+public:
+    /**
+      * @brief  构造函数，按view_count个视图计算每帧分配的大小
+      * @author agent
+      * @param  gl_funs: OpenGL函数指针
+      * @param  view_count: 一帧中的视图数量
+      * @retval none
+      */
+    FrameUniforms(QOpenGLFunctions_4_5_Core *gl_funs, uint32_t view_count = 1);
+    FrameUniforms(const FrameUniforms &) = delete;
+    FrameUniforms &operator=(const FrameUniforms &) = delete;
+
+    /**
+      * @brief  在流式缓冲的当前帧为所有视图分配空间，每帧Set之前调用
+      * @author agent
+      * @param  none
+      * @retval none
+      */
+    void Begin(void);
+
+    /**
+      * @brief  设置一个视图的数据，直接写入本帧分配的映射内存
+      * @author agent
+      * @param  index: 视图编号
+      * @param  projection: 投影矩阵
+      * @param  view: 观察矩阵
+      * @param  view_pos: 相机的世界坐标
+      * @param  light_position: 光源的世界坐标
+      * @param  light_color: 光源颜色
+      * @retval none
+      */
+    void Set(uint32_t index, const QMatrix4x4 &projection, const QMatrix4x4 &view, const QVector3D &view_pos,
+             const QVector3D &light_position = QVector3D(), const QVector3D &light_color = QVector3D(1.0f, 1.0f, 1.0f));
+
+    /**
+      * @brief  把一个视图的数据绑定到kFrameUniformBinding，之后的绘制都使用该视图
+      * @author agent
+      * @param  index: 视图编号
+      * @retval none
+      */
+    void Bind(uint32_t index = 0);
+
+private:
+    QOpenGLFunctions_4_5_Core *p_gl_funs;
+    GLStateCache *p_gl_state;
+    StreamBuffer *p_stream_buffer;
+    uint32_t view_count;
+    size_t stride;                      // 相邻视图的间隔，按GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT对齐
+    StreamAllocation uploaded;          // 本帧分配的位置，按stride排列各视图
+};
+
+#endif // FRAMEUNIFORMS_H
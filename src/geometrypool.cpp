@@ -0,0 +1,376 @@
+#include "geometrypool.h"
+#include "glstatecache.h"
+#include "mesh.h"
+#include "streambuffer.h"
+#include <QOpenGLContext>
+#include <algorithm>
+
+uint32_t RangeAllocator::Allocate(uint32_t count, bool &grown)
+{
+    grown = false;
+    if (count == 0)
+        return 0;
+    for (;;)
+    {
+        for (size_t i = 0; i < free_ranges.size(); i++)
+        {
+            Range &range = free_ranges[i];
+            if (range.count < count)
+                continue;
+            uint32_t offset = range.offset;
+            range.offset += count;
+            range.count -= count;
+            if (range.count == 0)
+                free_ranges.erase(free_ranges.begin() + i);
+            return offset;
+        }
+        // 没有足够大的空闲区间，扩容后把新增的尾部作为空闲区间（与末尾空闲区间合并）再分配
+        uint32_t old_capacity = capacity;
+        capacity = std::max(capacity * 2, capacity + count);
+        Free(old_capacity, capacity - old_capacity);
+        grown = true;
+    }
+}
+
+void RangeAllocator::Free(uint32_t offset, uint32_t count)
+{
+    if (count == 0)
+        return;
+    auto it = std::lower_bound(free_ranges.begin(), free_ranges.end(), offset,
+                               [](const Range &range, uint32_t value) { return range.offset < value; });
+    it = free_ranges.insert(it, Range{offset, count});
+    // 与后一个区间合并
+    auto next = it + 1;
+    if (next != free_ranges.end() && it->offset + it->count == next->offset)
+    {
+        it->count += next->count;
+        free_ranges.erase(next);
+    }
+    // 与前一个区间合并
+    if (it != free_ranges.begin())
+    {
+        auto prev = it - 1;
+        if (prev->offset + prev->count == it->offset)
+        {
+            prev->count += it->count;
+            free_ranges.erase(it);
+        }
+    }
+}
+
+GeometryPool::GeometryPool(QOpenGLFunctions_4_5_Core *gl_funs)
+    : p_gl_funs(gl_funs), p_gl_state(&GLStateCache::Current()),
+      VAO(0), VBO(0), EBO(0), indirect_buffer(0), draw_data_buffer(0), skin_buffer(0), draw_indirect_count(nullptr), located_program(0), draw_id_location(-1), dirty_first(0), dirty_end(0), uploaded_slots(0)
+{
+    QOpenGLContext *p_context = QOpenGLContext::currentContext();
+    has_draw_parameters = p_context->hasExtension("GL_ARB_shader_draw_parameters");
+    // 间接数量绘制在4.6进入核心，此前为扩展，都不在4.5核心函数中
+    const QSurfaceFormat surface_format = p_context->format();
+    if (surface_format.majorVersion() > 4 || (surface_format.majorVersion() == 4 && surface_format.minorVersion() >= 6))
+        draw_indirect_count = reinterpret_cast<MultiDrawElementsIndirectCountFunction>(p_context->getProcAddress("glMultiDrawElementsIndirectCount"));
+    else if (p_context->hasExtension("GL_ARB_indirect_parameters"))
+        draw_indirect_count = reinterpret_cast<MultiDrawElementsIndirectCountFunction>(p_context->getProcAddress("glMultiDrawElementsIndirectCountARB"));
+
+    p_gl_funs->glGenVertexArrays(1, &VAO);
+    p_gl_funs->glGenBuffers(1, &indirect_buffer);
+    p_gl_funs->glGenBuffers(1, &draw_data_buffer);
+
+    // 顶点格式与缓冲分离（GL 4.3顶点属性绑定），扩容换缓冲时只需重新绑定绑定点0
+    // 0号为量化位置，1号为八面体编码的法线，2号为半精度纹理坐标
+    p_gl_state->BindVertexArray(VAO);
+    p_gl_funs->glVertexAttribFormat(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(QuantizedVertex, position));
+    p_gl_funs->glVertexAttribFormat(1, 2, GL_SHORT, GL_TRUE, offsetof(QuantizedVertex, normal));
+    p_gl_funs->glVertexAttribFormat(2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(QuantizedVertex, tex_coords));
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        p_gl_funs->glVertexAttribBinding(i, 0);
+        p_gl_funs->glEnableVertexAttribArray(i);
+    }
+    p_gl_state->BindVertexArray(0);
+}
+
+GeometryPool::~GeometryPool()
+{
+    p_gl_state->DeleteVertexArrays(1, &VAO);
+    const unsigned int buffers[] = {VBO, EBO, indirect_buffer, draw_data_buffer, skin_buffer};
+    p_gl_state->DeleteBuffers(sizeof(buffers) / sizeof(buffers[0]), buffers);
+}
+
+uint32_t GeometryPool::AllocateDraws(uint32_t count)
+{
+    bool grown;
+    uint32_t first = draw_ranges.Allocate(count, grown);
+    if (grown)
+    {
+        commands.resize(draw_ranges.capacity, DrawElementsIndirectCommand{});
+        draw_data.resize(draw_ranges.capacity, DrawData{});
+    }
+    QMatrix4x4 identity;
+    for (uint32_t slot = first; slot < first + count; slot++)
+        SetDrawTransform(slot, 0, identity);
+    return first;
+}
+
+void GeometryPool::FreeDraws(uint32_t first, uint32_t count)
+{
+    draw_ranges.Free(first, count);
+}
+
+void GeometryPool::Upload(const QuantizedVertex *vertices, size_t vertex_count, const QVector3D &position_offset, const QVector3D &position_scale,
+                          const unsigned int *indices, size_t index_count, const VertexSkin *skin, GeometryAllocation &allocation)
+{
+    // 顶点在导入时已量化，这里只记录位置还原参数
+    allocation.position_offset = position_offset;
+    allocation.position_scale = position_scale;
+
+    // 子分配顶点和索引区间，扩容后重新绑定到VAO
+    uint32_t old_vertex_capacity = vertex_ranges.capacity;
+    uint32_t old_index_capacity = index_ranges.capacity;
+    bool vertex_grown, index_grown;
+    allocation.vertex_count = (uint32_t)vertex_count;
+    allocation.index_count = (uint32_t)index_count;
+    allocation.base_vertex = vertex_ranges.Allocate(allocation.vertex_count, vertex_grown);
+    allocation.first_index = index_ranges.Allocate(allocation.index_count, index_grown);
+    if (vertex_grown)
+        GrowBuffer(VBO, old_vertex_capacity * sizeof(QuantizedVertex), vertex_ranges.capacity * sizeof(QuantizedVertex));
+    if (index_grown)
+        GrowBuffer(EBO, old_index_capacity * sizeof(unsigned int), index_ranges.capacity * sizeof(unsigned int));
+    if (vertex_grown || index_grown)
+    {
+        p_gl_state->BindVertexArray(VAO);
+        p_gl_funs->glBindVertexBuffer(0, VBO, 0, (GLsizei)sizeof(QuantizedVertex));
+        p_gl_funs->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        p_gl_state->BindVertexArray(0);
+    }
+
+    // 通过拷贝目标上传，不影响VAO记录的索引缓冲绑定；索引保持网格内的相对值，由base_vertex偏移
+    if (vertex_count)
+    {
+        p_gl_state->BindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+        p_gl_funs->glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.base_vertex * sizeof(QuantizedVertex), vertex_count * sizeof(QuantizedVertex), vertices);
+    }
+    if (index_count)
+    {
+        p_gl_state->BindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+        p_gl_funs->glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.first_index * sizeof(unsigned int), index_count * sizeof(unsigned int), indices);
+    }
+
+    // 蒙皮数据只为带骨骼的网格分配，不增加静态网格的顶点带宽
+    allocation.skinned = skin != nullptr && vertex_count > 0;
+    allocation.skin_offset = 0;
+    if (allocation.skinned)
+    {
+        uint32_t old_skin_capacity = skin_ranges.capacity;
+        bool skin_grown;
+        allocation.skin_offset = skin_ranges.Allocate(allocation.vertex_count, skin_grown);
+        if (skin_grown)
+            GrowBuffer(skin_buffer, old_skin_capacity * sizeof(VertexSkin), skin_ranges.capacity * sizeof(VertexSkin));
+        p_gl_state->BindBuffer(GL_COPY_WRITE_BUFFER, skin_buffer);
+        p_gl_funs->glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.skin_offset * sizeof(VertexSkin), vertex_count * sizeof(VertexSkin), skin);
+    }
+}
+
+void GeometryPool::Free(const GeometryAllocation &allocation)
+{
+    vertex_ranges.Free(allocation.base_vertex, allocation.vertex_count);
+    index_ranges.Free(allocation.first_index, allocation.index_count);
+    if (allocation.skinned)
+        skin_ranges.Free(allocation.skin_offset, allocation.vertex_count);
+}
+
+void GeometryPool::SetDraw(uint32_t draw_slot, const GeometryAllocation &allocation, uint32_t first_index, uint32_t index_count)
+{
+    DrawElementsIndirectCommand &command = commands[draw_slot];
+    command.count = index_count;
+    command.instance_count = 1;
+    command.first_index = allocation.first_index + first_index;
+    command.base_vertex = (int32_t)allocation.base_vertex;
+    // 没有逐实例的顶点属性，base_instance只用于在着色器中取得槽位
+    command.base_instance = draw_slot;
+    DrawData &data = draw_data[draw_slot];
+    for (int k = 0; k < 3; k++)
+    {
+        data.position_offset[k] = allocation.position_offset[k];
+        data.position_scale[k] = allocation.position_scale[k];
+    }
+    // gl_VertexID已包含base_vertex
+    data.skin_base = allocation.skinned ? (int32_t)allocation.skin_offset - (int32_t)allocation.base_vertex : -1;
+    MarkDirty(draw_slot);
+}
+
+void GeometryPool::SetDrawTransform(uint32_t draw_slot, uint32_t node, const QMatrix4x4 &transform)
+{
+    std::copy(transform.constData(), transform.constData() + 16, draw_data[draw_slot].node_transform);
+    draw_data[draw_slot].node_index = (int32_t)node;
+    MarkDirty(draw_slot);
+}
+
+void GeometryPool::ClearDraw(uint32_t draw_slot)
+{
+    commands[draw_slot] = DrawElementsIndirectCommand{};
+    MarkDirty(draw_slot);
+}
+
+void GeometryPool::Draw(QOpenGLShaderProgram &shader, uint32_t first, uint32_t count, uint32_t instance_count)
+{
+    if (count == 0 || instance_count == 0)
+        return;
+    if (instance_count > 1)
+    {
+        // 槽位中的命令只画一个实例，改写实例数量后直接写入逐帧命令的空间提交
+        const StreamAllocation instanced = AllocateCommands(count);
+        DrawElementsIndirectCommand *p_commands = reinterpret_cast<DrawElementsIndirectCommand *>(instanced.p_data);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            DrawElementsIndirectCommand command = commands[first + i];
+            command.instance_count = instance_count;
+            p_commands[i] = command;
+        }
+        DrawCommands(shader, instanced, 0, count);
+        return;
+    }
+    BeginDraw(indirect_buffer);
+    if (has_draw_parameters)
+        p_gl_funs->glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                               (void *)(first * sizeof(DrawElementsIndirectCommand)), (GLsizei)count, 0);
+    else
+        DrawEach(shader, commands.data() + first, count);
+}
+
+StreamAllocation GeometryPool::AllocateCommands(uint32_t count)
+{
+    // 命令在流式缓冲的当前帧中，不等待上一次提交读完
+    if (has_draw_parameters)
+        return StreamBuffer::Current().Allocate(count * sizeof(DrawElementsIndirectCommand));
+    // 逐条提交时命令由CPU读取，不能放在只写的映射内存中
+    cpu_commands.resize(count);
+    return StreamAllocation{reinterpret_cast<unsigned char *>(cpu_commands.data()), 0, 0, count * sizeof(DrawElementsIndirectCommand)};
+}
+
+void GeometryPool::DrawCommands(QOpenGLShaderProgram &shader, const StreamAllocation &commands, uint32_t first, uint32_t count)
+{
+    if (count == 0)
+        return;
+    if (has_draw_parameters)
+    {
+        BeginDraw(commands.buffer);
+        p_gl_funs->glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void *)(commands.offset + first * sizeof(DrawElementsIndirectCommand)),
+                                               (GLsizei)count, 0);
+    }
+    else
+    {
+        BeginDraw(indirect_buffer);
+        DrawEach(shader, reinterpret_cast<const DrawElementsIndirectCommand *>(commands.p_data) + first, count);
+    }
+}
+
+void GeometryPool::BindCommands(unsigned int index)
+{
+    if (dirty_first < dirty_end)
+        SyncDraws();
+    p_gl_state->BindBufferBase(GL_SHADER_STORAGE_BUFFER, index, indirect_buffer);
+}
+
+void GeometryPool::DrawIndirectCount(unsigned int indirect, GLintptr offset, unsigned int parameter, GLintptr count_offset, uint32_t max_count)
+{
+    if (max_count == 0)
+        return;
+    BeginDraw(indirect);
+    if (draw_indirect_count != nullptr)
+    {
+        p_gl_state->BindBuffer(GL_PARAMETER_BUFFER, parameter);
+        draw_indirect_count(GL_TRIANGLES, GL_UNSIGNED_INT, (void *)offset, count_offset, (GLsizei)max_count, 0);
+    }
+    else
+    {
+        p_gl_funs->glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void *)offset, (GLsizei)max_count, 0);
+    }
+}
+
+bool GeometryPool::HasDrawParameters(void) const
+{
+    return has_draw_parameters;
+}
+
+void GeometryPool::BeginDraw(unsigned int indirect)
+{
+    if (dirty_first < dirty_end)
+        SyncDraws();
+    p_gl_state->BindVertexArray(VAO);
+    p_gl_state->BindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect);
+    p_gl_state->BindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, draw_data_buffer);
+    if (skin_buffer)
+        p_gl_state->BindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, skin_buffer);
+}
+
+void GeometryPool::DrawEach(QOpenGLShaderProgram &shader, const DrawElementsIndirectCommand *commands, uint32_t count)
+{
+    // 按名称查询位置较慢，只在换程序时查询一次
+    if (shader.programId() != located_program)
+    {
+        located_program = shader.programId();
+        draw_id_location = shader.uniformLocation("draw_id");
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const DrawElementsIndirectCommand &command = commands[i];
+        if (command.count == 0)
+            continue;
+        shader.setUniformValue(draw_id_location, (GLint)command.base_instance);
+        p_gl_funs->glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, command.count, GL_UNSIGNED_INT,
+                                                                 (void *)(command.first_index * sizeof(unsigned int)),
+                                                                 command.instance_count, command.base_vertex, command.base_instance);
+    }
+}
+
+void GeometryPool::GrowBuffer(unsigned int &buffer, size_t old_bytes, size_t new_bytes)
+{
+    unsigned int grown;
+    p_gl_funs->glGenBuffers(1, &grown);
+    p_gl_state->BindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    p_gl_funs->glBufferData(GL_COPY_WRITE_BUFFER, new_bytes, nullptr, GL_STATIC_DRAW);
+    if (buffer)
+    {
+        if (old_bytes)
+        {
+            p_gl_state->BindBuffer(GL_COPY_READ_BUFFER, buffer);
+            p_gl_funs->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, old_bytes);
+        }
+        p_gl_state->DeleteBuffers(1, &buffer);
+    }
+    buffer = grown;
+}
+
+void GeometryPool::SyncDraws()
+{
+    // 槽位扩容后整体重新分配，否则只更新修改过的区间（如动画节点所在网格的变换）
+    const bool reallocate = uploaded_slots != commands.size();
+    const uint32_t first = reallocate ? 0 : dirty_first;
+    const uint32_t count = reallocate ? (uint32_t)commands.size() : dirty_end - dirty_first;
+
+    p_gl_state->BindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer);
+    if (reallocate)
+        p_gl_funs->glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_DRAW);
+    p_gl_funs->glBufferSubData(GL_DRAW_INDIRECT_BUFFER, first * sizeof(DrawElementsIndirectCommand),
+                               count * sizeof(DrawElementsIndirectCommand), commands.data() + first);
+
+    p_gl_state->BindBuffer(GL_SHADER_STORAGE_BUFFER, draw_data_buffer);
+    if (reallocate)
+        p_gl_funs->glBufferData(GL_SHADER_STORAGE_BUFFER, draw_data.size() * sizeof(DrawData), nullptr, GL_DYNAMIC_DRAW);
+    p_gl_funs->glBufferSubData(GL_SHADER_STORAGE_BUFFER, first * sizeof(DrawData), count * sizeof(DrawData), draw_data.data() + first);
+
+    uploaded_slots = commands.size();
+    dirty_first = dirty_end = 0;
+}
+
+void GeometryPool::MarkDirty(uint32_t draw_slot)
+{
+    if (dirty_first == dirty_end)
+    {
+        dirty_first = draw_slot;
+        dirty_end = draw_slot + 1;
+        return;
+    }
+    dirty_first = std::min(dirty_first, draw_slot);
+    dirty_end = std::max(dirty_end, draw_slot + 1);
+}
@@ -0,0 +1,312 @@
+/**
+  ******************************************************************************
+  * @file           : geometrypool.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了共享几何池的定义。所有模型的所有网格（量化顶点格式）都子分配在
+  * 同一个顶点缓冲和索引缓冲中，共用一个VAO；网格的每一级LOD占用一个绘制槽位，槽位保存
+  * 间接绘制命令（DrawElementsIndirectCommand）和逐绘制数据（顶点位置还原参数），
+  * 一个模型的连续槽位用一次glMultiDrawElementsIndirect提交；逐帧生成的命令（如剔除后的网格簇）
+  * 写入流式缓冲（见StreamBuffer）后提交，仍按槽位取逐绘制数据
+  ******************************************************************************
+  * @attention
+  *     每条命令的base_instance为其槽位，着色器通过gl_BaseInstanceARB（GL_ARB_shader_draw_parameters）
+  * 索引逐绘制数据，gl_InstanceID不受base_instance影响，仍用于索引实例数据；驱动不支持该扩展时
+  * 退化为逐命令绘制并设置draw_id；逐绘制数据绑定在SSBO绑定点0，蒙皮数据绑定在SSBO绑定点2
+  * （绑定点1和3留给实例的动画矩阵和实例数据，见InstanceBuffer；4~7留给GPU剔除，见GpuCuller）
+  ******************************************************************************
+  */
+
+#ifndef GEOMETRYPOOL_H
+#define GEOMETRYPOOL_H
+
+#include <QMatrix4x4>
+#include <QOpenGLFunctions_4_5_Core>
+#include <QOpenGLShaderProgram>
+#include <QVector3D>
+#include "streambuffer.h"
+#include "vertexformat.h"
+#include <cstdint>
+#include <vector>
+
+class GLStateCache;
+
+// glMultiDrawElementsIndirect要求的命令布局
+struct DrawElementsIndirectCommand {
+    uint32_t count;
+    uint32_t instance_count;
+    uint32_t first_index;
+    int32_t base_vertex;
+    uint32_t base_instance;
+};
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand must be 20 bytes");
+
+// glMultiDrawElementsIndirectCount（GL 4.6）/ glMultiDrawElementsIndirectCountARB（GL_ARB_indirect_parameters）
+typedef void (APIENTRY *MultiDrawElementsIndirectCountFunction)(GLenum mode, GLenum type, const void *indirect,
+                                                                GLintptr draw_count, GLsizei max_draw_count, GLsizei stride);
+
+// 逐绘制数据，与着色器中的DrawData（std430）一致，node_transform为网格所在节点的世界变换（列主序）
+// node_index用于按实例的动画矩阵替换node_transform，skin_base加上gl_VertexID为顶点的蒙皮数据位置，无蒙皮时为-1
+struct DrawData {
+    float position_offset[4];
+    float position_scale[4];
+    float node_transform[16];
+    int32_t node_index;
+    int32_t skin_base;
+    int32_t padding[2];
+};
+static_assert(sizeof(DrawData) == 112, "DrawData must match the std430 layout");
+
+// 网格在几何池中的位置
+struct GeometryAllocation {
+    uint32_t base_vertex;
+    uint32_t vertex_count;
+    uint32_t first_index;
+    uint32_t index_count;
+    QVector3D position_offset;
+    QVector3D position_scale;
+    bool skinned;
+    uint32_t skin_offset;       // 蒙皮缓冲中的起点，只在skinned时有效
+};
+
+// 一维区间分配器，首次适配，释放时合并相邻空闲区间
+class RangeAllocator
+{
+public:
+    /**
+      * @brief  分配连续区间，空间不足时扩容（容量至少翻倍）
+      * @author agent
+      * @param  count: 区间长度
+      * @param  grown: 输出是否发生了扩容
+      * @retval 区间起点
+      */
+    uint32_t Allocate(uint32_t count, bool &grown);
+
+    /**
+      * @brief  释放区间
+      * @author agent
+      * @param  offset: 区间起点
+      * @param  count: 区间长度
+      * @retval none
+      */
+    void Free(uint32_t offset, uint32_t count);
+
+    uint32_t capacity = 0;
+
+private:
+    struct Range {
+        uint32_t offset;
+        uint32_t count;
+    };
+    std::vector<Range> free_ranges;     // 按起点排序
+};
+
+class GeometryPool
+{
+public:
+    /**
+      * @brief  构造函数，创建共享的VAO和缓冲，需要OpenGL上下文为当前
+      * @author agent
+      * @param  gl_funs: OpenGL函数指针
+      * @retval none
+      */
+    GeometryPool(QOpenGLFunctions_4_5_Core *gl_funs);
+    ~GeometryPool();
+    GeometryPool(const GeometryPool &) = delete;
+    GeometryPool &operator=(const GeometryPool &) = delete;
+
+    /**
+      * @brief  分配连续的绘制槽位，一个模型的网格使用连续槽位以便一次提交
+      * @author agent
+      * @param  count: 槽位数量
+      * @retval 第一个槽位
+      */
+    uint32_t AllocateDraws(uint32_t count);
+
+    /**
+      * @brief  释放绘制槽位
+      * @author agent
+      * @param  first: 第一个槽位
+      * @param  count: 槽位数量
+      * @retval none
+      */
+    void FreeDraws(uint32_t first, uint32_t count);
+
+    /**
+      * @brief  子分配并上传网格，顶点数据已量化，原样拷贝
+      * @author agent
+      * @param  vertices: 量化顶点首地址
+      * @param  vertex_count: 顶点数量
+      * @param  position_offset: 顶点位置还原偏移，即量化时的包围盒最小角
+      * @param  position_scale: 顶点位置还原比例，即量化时的包围盒尺寸
+      * @param  indices: 索引数据首地址
+      * @param  index_count: 索引数量
+      * @param  skin: 蒙皮数据首地址，与顶点一一对应，无骨骼的网格为nullptr
+      * @param  allocation: 输出的分配结果
+      * @retval none
+      */
+    void Upload(const QuantizedVertex *vertices, size_t vertex_count, const QVector3D &position_offset, const QVector3D &position_scale,
+                const unsigned int *indices, size_t index_count, const VertexSkin *skin, GeometryAllocation &allocation);
+
+    /**
+      * @brief  释放网格占用的顶点和索引区间
+      * @author agent
+      * @param  allocation: 分配结果
+      * @retval none
+      */
+    void Free(const GeometryAllocation &allocation);
+
+    /**
+      * @brief  写入槽位的绘制命令和逐绘制数据，绘制网格索引中的一段（如某一级LOD）
+      * @author agent
+      * @param  draw_slot: 槽位
+      * @param  allocation: 网格的分配结果
+      * @param  first_index: 起始索引，相对网格的索引区间
+      * @param  index_count: 索引数量
+      * @retval none
+      */
+    void SetDraw(uint32_t draw_slot, const GeometryAllocation &allocation, uint32_t first_index, uint32_t index_count);
+
+    /**
+      * @brief  写入槽位的节点变换，新分配的槽位为单位矩阵
+      * @author agent
+      * @param  draw_slot: 槽位
+      * @param  node: 网格所在节点的编号
+      * @param  transform: 网格所在节点相对模型的变换
+      * @retval none
+      */
+    void SetDrawTransform(uint32_t draw_slot, uint32_t node, const QMatrix4x4 &transform);
+
+    /**
+      * @brief  清空槽位的绘制命令，槽位仍然保留
+      * @author agent
+      * @param  draw_slot: 槽位
+      * @retval none
+      */
+    void ClearDraw(uint32_t draw_slot);
+
+    /**
+      * @brief  绘制连续的槽位，支持扩展时为一次glMultiDrawElementsIndirect
+      * @author agent
+      * @param  shader: 当前绑定的着色器程序
+      * @param  first: 第一个槽位
+      * @param  count: 槽位数量
+      * @param  instance_count: 每个槽位绘制的实例数量，着色器用gl_InstanceID区分实例
+      * @retval none
+      */
+    void Draw(QOpenGLShaderProgram &shader, uint32_t first, uint32_t count, uint32_t instance_count = 1);
+
+    /**
+      * @brief  为逐帧生成的命令分配空间，调用者直接写入p_data：支持GL_ARB_shader_draw_parameters时在流式缓冲的
+      *         当前帧中（映射内存只写不读），否则在CPU端的暂存区中，下一次AllocateCommands之前有效
+      * @author agent
+      * @param  count: 命令数量上限
+      * @retval 分配结果
+      */
+    StreamAllocation AllocateCommands(uint32_t count);
+
+    /**
+      * @brief  绘制AllocateCommands分配的命令中的一段，命令的base_instance须为其逐绘制数据所在的槽位
+      * @author agent
+      * @param  shader: 当前绑定的着色器程序
+      * @param  commands: AllocateCommands的分配结果，命令的first_index和base_vertex为池中的绝对位置
+      * @param  first: 第一条命令
+      * @param  count: 命令数量
+      * @retval none
+      */
+    void DrawCommands(QOpenGLShaderProgram &shader, const StreamAllocation &commands, uint32_t first, uint32_t count);
+
+    /**
+      * @brief  将槽位的绘制命令缓冲绑定为SSBO，供计算着色器读取（如GPU剔除时复制命令）
+      * @author agent
+      * @param  index: SSBO绑定点
+      * @retval none
+      */
+    void BindCommands(unsigned int index);
+
+    /**
+      * @brief  绘制GPU写入的命令，命令数量也由GPU写入；驱动不支持间接数量时提交全部max_count条，
+      *         多出的命令须为实例数量为0的空命令；需要支持GL_ARB_shader_draw_parameters
+      * @author agent
+      * @param  indirect: 命令缓冲
+      * @param  offset: 第一条命令在命令缓冲中的字节偏移
+      * @param  parameter: 命令数量所在的缓冲
+      * @param  count_offset: 命令数量（uint）在缓冲中的字节偏移，须4字节对齐
+      * @param  max_count: 命令数量上限
+      * @retval none
+      */
+    void DrawIndirectCount(unsigned int indirect, GLintptr offset, unsigned int parameter, GLintptr count_offset, uint32_t max_count);
+
+    /**
+      * @brief  是否支持GL_ARB_shader_draw_parameters，不支持时命令只能由CPU逐条提交
+      * @author agent
+      * @param  none
+      * @retval 是否支持
+      */
+    bool HasDrawParameters(void) const;
+
+    QOpenGLFunctions_4_5_Core *p_gl_funs;
+    GLStateCache *p_gl_state;
+
+private:
+    /**
+      * @brief  缓冲扩容，旧内容在GPU上拷贝到新缓冲
+      * @author agent
+      * @param  buffer: 缓冲对象，扩容后为新缓冲
+      * @param  old_bytes: 旧缓冲大小
+      * @param  new_bytes: 新缓冲大小
+      * @retval none
+      */
+    void GrowBuffer(unsigned int &buffer, size_t old_bytes, size_t new_bytes);
+
+    /**
+      * @brief  将槽位数据的CPU镜像同步到间接命令缓冲和逐绘制数据缓冲，只上传修改过的槽位区间
+      * @author agent
+      * @param  none
+      * @retval none
+      */
+    void SyncDraws(void);
+
+    /**
+      * @brief  标记修改过的槽位
+      * @author agent
+      * @param  draw_slot: 槽位
+      * @retval none
+      */
+    void MarkDirty(uint32_t draw_slot);
+
+    /**
+      * @brief  绑定VAO和绘制用的缓冲，必要时先同步槽位数据
+      * @author agent
+      * @param  indirect: 间接命令缓冲
+      * @retval none
+      */
+    void BeginDraw(unsigned int indirect);
+
+    /**
+      * @brief  不支持GL_ARB_shader_draw_parameters时逐条提交命令
+      * @author agent
+      * @param  shader: 当前绑定的着色器程序
+      * @param  commands: 命令
+      * @param  count: 命令数量
+      * @retval none
+      */
+    void DrawEach(QOpenGLShaderProgram &shader, const DrawElementsIndirectCommand *commands, uint32_t count);
+
+    unsigned int VAO, VBO, EBO;
+    unsigned int indirect_buffer, draw_data_buffer, skin_buffer;
+    std::vector<DrawElementsIndirectCommand> cpu_commands;         // 逐条提交时逐帧命令的CPU端暂存区
+    bool has_draw_parameters;
+    MultiDrawElementsIndirectCountFunction draw_indirect_count;    // 不支持时为nullptr
+    unsigned int located_program;       // DrawEach最近一次查询draw_id位置的程序
+    int draw_id_location;
+
+    RangeAllocator vertex_ranges, index_ranges, draw_ranges, skin_ranges;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<DrawData> draw_data;
+    uint32_t dirty_first, dirty_end;    // 待上传的槽位区间[dirty_first, dirty_end)
+    size_t uploaded_slots;              // GPU缓冲当前容纳的槽位数
+};
+
+#endif // GEOMETRYPOOL_H
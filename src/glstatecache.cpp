@@ -0,0 +1,274 @@
+#include "glstatecache.h"
+#include <QOpenGLContext>
+#include <memory>
+#include <unordered_map>
+
+namespace {
+
+// 未知状态，任何目标值都与之不同
+const GLuint kUnknownName = ~0u;
+const GLint kUnknownFlag = -1;
+
+// 每个上下文一个缓存；绘制时几乎总是同一个上下文，先比较上一次的结果
+std::unordered_map<QOpenGLContext *, std::unique_ptr<GLStateCache>> caches;
+QOpenGLContext *p_last_context = nullptr;
+GLStateCache *p_last_cache = nullptr;
+
+} // namespace
+
+GLStateCache &GLStateCache::Current(void)
+{
+    QOpenGLContext *p_context = QOpenGLContext::currentContext();
+    if (p_context == p_last_context)
+        return *p_last_cache;
+
+    std::unique_ptr<GLStateCache> &cache = caches[p_context];
+    if (!cache)
+    {
+        cache.reset(new GLStateCache(p_context->versionFunctions<QOpenGLFunctions_4_5_Core>()));
+        QObject::connect(p_context, &QOpenGLContext::aboutToBeDestroyed, [p_context]() {
+            if (p_last_context == p_context)
+            {
+                p_last_context = nullptr;
+                p_last_cache = nullptr;
+            }
+            caches.erase(p_context);
+        });
+    }
+    p_last_context = p_context;
+    p_last_cache = cache.get();
+    return *cache;
+}
+
+GLStateCache::GLStateCache(QOpenGLFunctions_4_5_Core *gl_funs)
+    : issued_calls(0), saved_calls(0), p_gl_funs(gl_funs)
+{
+    Invalidate();
+}
+
+void GLStateCache::BeginFrame(void)
+{
+    issued_calls = saved_calls = 0;
+    Invalidate();
+}
+
+void GLStateCache::Invalidate(void)
+{
+    program = vertex_array = kUnknownName;
+    for (GLuint &buffer : buffers)
+        buffer = kUnknownName;
+    for (auto &bindings : indexed)
+    {
+        for (IndexedBinding &binding : bindings)
+            binding = IndexedBinding{kUnknownName, 0, 0};
+    }
+    for (GLuint &texture : texture_units)
+        texture = kUnknownName;
+    for (GLint &capability : capabilities)
+        capability = kUnknownFlag;
+    depth_mask = kUnknownFlag;
+    depth_func = blend_source = blend_destination = GL_NONE;
+}
+
+void GLStateCache::UseProgram(GLuint program)
+{
+    if (Change(this->program, program))
+        p_gl_funs->glUseProgram(program);
+}
+
+void GLStateCache::BindVertexArray(GLuint vao)
+{
+    if (Change(vertex_array, vao))
+        p_gl_funs->glBindVertexArray(vao);
+}
+
+void GLStateCache::BindBuffer(GLenum target, GLuint buffer)
+{
+    const int slot = BufferSlot(target);
+    if (slot < 0)
+    {
+        issued_calls++;
+        p_gl_funs->glBindBuffer(target, buffer);
+    }
+    else if (Change(buffers[slot], buffer))
+    {
+        p_gl_funs->glBindBuffer(target, buffer);
+    }
+}
+
+void GLStateCache::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    const int slot = IndexedSlot(target);
+    if (slot < 0 || index >= kGLStateIndexedBindings)
+    {
+        issued_calls++;
+        p_gl_funs->glBindBufferBase(target, index, buffer);
+        return;
+    }
+    IndexedBinding &binding = indexed[slot][index];
+    if (binding.buffer == buffer && binding.size == -1)
+    {
+        saved_calls++;
+        return;
+    }
+    issued_calls++;
+    p_gl_funs->glBindBufferBase(target, index, buffer);
+    binding = IndexedBinding{buffer, 0, -1};
+    // 带索引的绑定同时改变通用绑定点
+    buffers[BufferSlot(target)] = buffer;
+}
+
+void GLStateCache::BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    const int slot = IndexedSlot(target);
+    if (slot < 0 || index >= kGLStateIndexedBindings)
+    {
+        issued_calls++;
+        p_gl_funs->glBindBufferRange(target, index, buffer, offset, size);
+        return;
+    }
+    IndexedBinding &binding = indexed[slot][index];
+    if (binding.buffer == buffer && binding.offset == offset && binding.size == size)
+    {
+        saved_calls++;
+        return;
+    }
+    issued_calls++;
+    p_gl_funs->glBindBufferRange(target, index, buffer, offset, size);
+    binding = IndexedBinding{buffer, offset, size};
+    buffers[BufferSlot(target)] = buffer;
+}
+
+void GLStateCache::BindTextureUnit(GLuint unit, GLuint texture)
+{
+    if (unit >= kGLStateTextureUnits)
+    {
+        issued_calls++;
+        p_gl_funs->glBindTextureUnit(unit, texture);
+    }
+    else if (Change(texture_units[unit], texture))
+    {
+        p_gl_funs->glBindTextureUnit(unit, texture);
+    }
+}
+
+void GLStateCache::SetCapability(GLenum capability, bool enabled)
+{
+    const int slot = CapabilitySlot(capability);
+    if (slot >= 0 && !Change(capabilities[slot], (GLint)enabled))
+        return;
+    if (slot < 0)
+        issued_calls++;
+    if (enabled)
+        p_gl_funs->glEnable(capability);
+    else
+        p_gl_funs->glDisable(capability);
+}
+
+void GLStateCache::DepthMask(GLboolean flag)
+{
+    if (Change(depth_mask, (GLint)flag))
+        p_gl_funs->glDepthMask(flag);
+}
+
+void GLStateCache::DepthFunc(GLenum func)
+{
+    if (Change(depth_func, func))
+        p_gl_funs->glDepthFunc(func);
+}
+
+void GLStateCache::BlendFunc(GLenum source, GLenum destination)
+{
+    if (blend_source == source && blend_destination == destination)
+    {
+        saved_calls++;
+        return;
+    }
+    issued_calls++;
+    blend_source = source;
+    blend_destination = destination;
+    p_gl_funs->glBlendFunc(source, destination);
+}
+
+void GLStateCache::DeleteBuffers(GLsizei count, const GLuint *names)
+{
+    for (GLsizei i = 0; i < count; i++)
+    {
+        if (names[i] == 0)
+            continue;
+        for (GLuint &buffer : buffers)
+        {
+            if (buffer == names[i])
+                buffer = 0;
+        }
+        for (auto &bindings : indexed)
+        {
+            for (IndexedBinding &binding : bindings)
+            {
+                if (binding.buffer == names[i])
+                    binding = IndexedBinding{0, 0, -1};
+            }
+        }
+    }
+    p_gl_funs->glDeleteBuffers(count, names);
+}
+
+void GLStateCache::DeleteVertexArrays(GLsizei count, const GLuint *names)
+{
+    for (GLsizei i = 0; i < count; i++)
+    {
+        if (names[i] != 0 && vertex_array == names[i])
+            vertex_array = 0;
+    }
+    p_gl_funs->glDeleteVertexArrays(count, names);
+}
+
+void GLStateCache::DeleteTextures(GLsizei count, const GLuint *names)
+{
+    for (GLsizei i = 0; i < count; i++)
+    {
+        for (GLuint &texture : texture_units)
+        {
+            if (names[i] != 0 && texture == names[i])
+                texture = 0;
+        }
+    }
+    p_gl_funs->glDeleteTextures(count, names);
+}
+
+int GLStateCache::BufferSlot(GLenum target)
+{
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER:               return 0;
+    case GL_COPY_READ_BUFFER:           return 1;
+    case GL_COPY_WRITE_BUFFER:          return 2;
+    case GL_DRAW_INDIRECT_BUFFER:       return 3;
+    case GL_DISPATCH_INDIRECT_BUFFER:   return 4;
+    case GL_UNIFORM_BUFFER:             return 5;
+    case GL_SHADER_STORAGE_BUFFER:      return 6;
+    case GL_PARAMETER_BUFFER:           return 7;
+    default:                            return -1;
+    }
+}
+
+int GLStateCache::IndexedSlot(GLenum target)
+{
+    switch (target)
+    {
+    case GL_UNIFORM_BUFFER:         return 0;
+    case GL_SHADER_STORAGE_BUFFER:  return 1;
+    default:                        return -1;
+    }
+}
+
+int GLStateCache::CapabilitySlot(GLenum capability)
+{
+    switch (capability)
+    {
+    case GL_DEPTH_TEST: return 0;
+    case GL_BLEND:      return 1;
+    case GL_CULL_FACE:  return 2;
+    default:            return -1;
+    }
+}
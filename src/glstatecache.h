@@ -0,0 +1,150 @@
+/**
+  ******************************************************************************
+  * @file           : glstatecache.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了OpenGL状态缓存的定义。缓存记录当前上下文中绑定的着色器程序、VAO、
+  * 通用与带索引的缓冲绑定点、纹理单元以及深度和混合状态，目标状态与记录相同时不再调用OpenGL，
+  * 绘制之后也不必再解绑到0；每帧统计实际发出和省下的调用数量
+  ******************************************************************************
+  * @attention
+  *     所有逐帧路径上的绑定都必须经过缓存；Qt内部或其它代码绕过缓存修改了这些状态后须调用Invalidate，
+  * 被缓存记录的对象须通过这里的Delete函数删除，以免名字被复用后误判为已绑定；
+  * GL_ELEMENT_ARRAY_BUFFER属于VAO状态，不缓存，直接转发；
+  * 只能在OpenGL上下文所在线程、上下文为当前时使用
+  ******************************************************************************
+  */
+
+#ifndef GLSTATECACHE_H
+#define GLSTATECACHE_H
+
+#include <QOpenGLFunctions_4_5_Core>
+#include <cstdint>
+
+// 缓存的纹理单元和每种带索引缓冲的绑定点数量，超出的调用直接转发
+const unsigned int kGLStateTextureUnits = 16;
+const unsigned int kGLStateIndexedBindings = 8;
+
+// GL 4.6 / GL_ARB_indirect_parameters的间接绘制数量缓冲，Qt的4.5核心头文件中没有
+#ifndef GL_PARAMETER_BUFFER
+#define GL_PARAMETER_BUFFER 0x80EE
+#endif
+
+class GLStateCache
+{
+public:
+    /**
+      * @brief  获取当前OpenGL上下文的状态缓存，首次获取时创建，上下文销毁时随之释放
+      * @author agent
+      * @param  none
+      * @retval 状态缓存
+      */
+    static GLStateCache &Current(void);
+
+    /**
+      * @brief  构造函数，所有状态为未知
+      * @author agent
+      * @param  gl_funs: OpenGL函数指针
+      * @retval none
+      */
+    explicit GLStateCache(QOpenGLFunctions_4_5_Core *gl_funs);
+
+    /**
+      * @brief  开始新的一帧：计数清零，并把所有状态置为未知（Qt在两帧之间可能修改状态）
+      * @author agent
+      * @param  none
+      * @retval none
+      */
+    void BeginFrame(void);
+
+    /**
+      * @brief  把所有状态置为未知，绕过缓存修改状态后调用
+      * @author agent
+      * @param  none
+      * @retval none
+      */
+    void Invalidate(void);
+
+    void UseProgram(GLuint program);
+    void BindVertexArray(GLuint vao);
+    void BindBuffer(GLenum target, GLuint buffer);
+    void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+    void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+    void BindTextureUnit(GLuint unit, GLuint texture);
+
+    /**
+      * @brief  开启或关闭功能，缓存GL_DEPTH_TEST、GL_BLEND和GL_CULL_FACE，其它直接转发
+      * @author agent
+      * @param  capability: 功能
+      * @param  enabled: 是否开启
+      * @retval none
+      */
+    void SetCapability(GLenum capability, bool enabled);
+    void DepthMask(GLboolean flag);
+    void DepthFunc(GLenum func);
+    void BlendFunc(GLenum source, GLenum destination);
+
+    /**
+      * @brief  删除对象，并清除缓存中对它们的记录（OpenGL删除已绑定的对象时会解绑）
+      * @author agent
+      * @param  count: 数量
+      * @param  names: 对象名字，0被忽略
+      * @retval none
+      */
+    void DeleteBuffers(GLsizei count, const GLuint *names);
+    void DeleteVertexArrays(GLsizei count, const GLuint *names);
+    void DeleteTextures(GLsizei count, const GLuint *names);
+
+    // 本帧到目前为止发出和省下的调用数量
+    uint32_t issued_calls;
+    uint32_t saved_calls;
+
+private:
+    // 带索引的缓冲绑定：size为-1表示整个缓冲（glBindBufferBase）
+    struct IndexedBinding {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;
+    };
+
+    // 通用缓冲绑定点在buffers中的位置，不缓存的目标返回-1
+    static int BufferSlot(GLenum target);
+    // 带索引缓冲绑定点类型在indexed中的位置，不缓存的目标返回-1
+    static int IndexedSlot(GLenum target);
+    // 功能在capabilities中的位置，不缓存的功能返回-1
+    static int CapabilitySlot(GLenum capability);
+
+    /**
+      * @brief  比较并更新一个记录
+      * @author agent
+      * @param  cached: 记录
+      * @param  value: 目标值
+      * @retval 是否需要调用OpenGL
+      */
+    template <typename T>
+    bool Change(T &cached, T value)
+    {
+        if (cached == value)
+        {
+            saved_calls++;
+            return false;
+        }
+        cached = value;
+        issued_calls++;
+        return true;
+    }
+
+    QOpenGLFunctions_4_5_Core *p_gl_funs;
+    GLuint program;
+    GLuint vertex_array;
+    GLuint buffers[8];
+    IndexedBinding indexed[2][kGLStateIndexedBindings];
+    GLuint texture_units[kGLStateTextureUnits];
+    GLint capabilities[3];
+    GLint depth_mask;
+    GLenum depth_func;
+    GLenum blend_source, blend_destination;
+};
+
+#endif // GLSTATECACHE_H
@@ -0,0 +1,123 @@
+#include "gpuculler.h"
+#include "glstatecache.h"
+#include "instancebuffer.h"
+#include "model.h"
+#include "programcache.h"
+#include <algorithm>
+
+GpuCuller::GpuCuller(QOpenGLFunctions_4_5_Core *gl_funs, Model &model)
+    : ready(false), p_gl_funs(gl_funs), p_gl_state(&GLStateCache::Current()), model(model),
+      visible_buffer(0), counter_buffer(0), command_buffer(0), capacity(0)
+{
+    ProgramCache program_cache(p_gl_funs);
+    program_cache.AddCompute(&cull_program, ":/shader/cull.comp");
+    program_cache.AddCompute(&command_program, ":/shader/cull.comp", {"CULL_BUILD_COMMANDS"});
+    ready = program_cache.Build();
+
+    const QVector3D center = (model.aabb_min + model.aabb_max) * 0.5f;
+    bounds = QVector4D(center, (model.aabb_max - model.aabb_min).length() * 0.5f);
+    command_count = model.lod_count * (uint32_t)model.meshes.size();
+
+    p_gl_funs->glCreateBuffers(1, &visible_buffer);
+    p_gl_funs->glCreateBuffers(1, &counter_buffer);
+    p_gl_funs->glCreateBuffers(1, &command_buffer);
+    p_gl_funs->glNamedBufferData(counter_buffer, (kMaxCullLods + model.batches.size()) * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+    p_gl_funs->glNamedBufferData(command_buffer, std::max(command_count, 1u) * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_DRAW);
+}
+
+GpuCuller::~GpuCuller()
+{
+    const unsigned int buffers[] = {visible_buffer, counter_buffer, command_buffer};
+    p_gl_state->DeleteBuffers(3, buffers);
+}
+
+bool GpuCuller::Supported(const Model &model)
+{
+    return model.p_geometry_pool->HasDrawParameters() && !model.meshes.empty() &&
+           model.lod_count <= kMaxCullLods && model.batches.size() <= kMaxCullBatches;
+}
+
+void GpuCuller::Cull(InstanceBuffer &instances, const QMatrix4x4 &view_projection, const QVector3D &camera_position,
+                     float pixel_scale, float near_clip)
+{
+    const uint32_t instance_count = instances.Size();
+    Reserve(instance_count);
+    // 计数每帧清零；命令缓冲也清零，不支持间接数量绘制时未写入的命令为空命令
+    const uint32_t zero = 0;
+    p_gl_funs->glClearNamedBufferData(counter_buffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    p_gl_funs->glClearNamedBufferData(command_buffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    if (instance_count == 0)
+        return;
+
+    // Gribb-Hartmann：裁剪空间的六个半空间 w ± x、w ± y、w ± z >= 0，与MeshletCuller相同
+    const QVector4D row_x = view_projection.row(0), row_y = view_projection.row(1);
+    const QVector4D row_z = view_projection.row(2), row_w = view_projection.row(3);
+    QVector4D planes[6] = {row_w + row_x, row_w - row_x, row_w + row_y, row_w - row_y, row_w + row_z, row_w - row_z};
+    for (QVector4D &plane : planes)
+    {
+        const float length = plane.toVector3D().length();
+        if (length > 0.0f)
+            plane /= length;
+    }
+    float lod_errors[kMaxCullLods] = {};
+    std::copy(model.lod_errors.begin(), model.lod_errors.begin() + model.lod_count, lod_errors);
+
+    p_gl_state->UseProgram(cull_program.programId());
+    instances.Bind(cull_program);
+    p_gl_state->BindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, visible_buffer);
+    p_gl_state->BindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, counter_buffer);
+    cull_program.setUniformValue("instance_count", (GLuint)instance_count);
+    cull_program.setUniformValue("capacity", (GLuint)capacity);
+    cull_program.setUniformValueArray("frustum_planes", planes, 6);
+    cull_program.setUniformValue("bounds", bounds);
+    cull_program.setUniformValue("camera_position", camera_position);
+    cull_program.setUniformValue("pixel_scale", pixel_scale);
+    cull_program.setUniformValue("near_clip", near_clip);
+    cull_program.setUniformValue("lod_count", (GLuint)model.lod_count);
+    cull_program.setUniformValueArray("lod_errors", lod_errors, kMaxCullLods, 1);
+    cull_program.setUniformValue("max_pixel_error", 1.0f);
+    p_gl_funs->glDispatchCompute((instance_count + kCullGroupSize - 1) / kCullGroupSize, 1, 1);
+    // 第二次调度读取各级LOD的可见数量
+    p_gl_funs->glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    GLuint batch_first_meshes[kMaxCullBatches] = {};
+    for (size_t b = 0; b < model.batches.size(); b++)
+        batch_first_meshes[b] = model.batches[b].first_mesh;
+    p_gl_state->UseProgram(command_program.programId());
+    model.UpdateTransforms();
+    model.p_geometry_pool->BindCommands(5);
+    p_gl_state->BindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, command_buffer);
+    command_program.setUniformValue("first_slot", (GLuint)model.first_draw_slot);
+    command_program.setUniformValue("mesh_count", (GLuint)model.meshes.size());
+    command_program.setUniformValue("lod_count", (GLuint)model.lod_count);
+    command_program.setUniformValue("batch_count", (GLuint)model.batches.size());
+    command_program.setUniformValueArray("batch_first_meshes", batch_first_meshes, kMaxCullBatches);
+    p_gl_funs->glDispatchCompute((command_count + kCullGroupSize - 1) / kCullGroupSize, 1, 1);
+}
+
+void GpuCuller::Draw(QOpenGLShaderProgram &shader)
+{
+    p_gl_state->BindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, visible_buffer);
+    shader.setUniformValue("cull_first_slot", (GLint)model.first_draw_slot);
+    shader.setUniformValue("cull_mesh_count", (GLint)model.meshes.size());
+    shader.setUniformValue("cull_capacity", (GLint)capacity);
+    for (size_t b = 0; b < model.batches.size(); b++)
+    {
+        const Model::DrawBatch &batch = model.batches[b];
+        model.meshes[batch.first_mesh].p_material->Bind();
+        model.p_geometry_pool->DrawIndirectCount(command_buffer, model.lod_count * batch.first_mesh * sizeof(DrawElementsIndirectCommand),
+                                                 counter_buffer, (kMaxCullLods + b) * sizeof(uint32_t),
+                                                 model.lod_count * batch.mesh_count);
+    }
+}
+
+void GpuCuller::Reserve(uint32_t instance_count)
+{
+    if (instance_count <= capacity)
+        return;
+    // 容量只增不减，按2的幂增长，不随实例数量波动反复分配
+    capacity = std::max(capacity, 64u);
+    while (capacity < instance_count)
+        capacity *= 2;
+    p_gl_funs->glNamedBufferData(visible_buffer, (GLsizeiptr)model.lod_count * capacity * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+}
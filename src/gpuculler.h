@@ -0,0 +1,110 @@
+/**
+  ******************************************************************************
+  * @file           : gpuculler.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了GPU实例剔除类的定义。一个模型的所有实例写入实例缓冲后，
+  * 计算着色器逐实例用包围球与视锥求交并按投影尺寸选择LOD，把可见实例编号按LOD紧凑写入
+  * 可见列表；第二次调度逐命令复制几何池中各LOD的槽位命令，填入该LOD的可见实例数量，
+  * 按批次紧凑写入命令缓冲并累计命令数量。绘制时每个批次一次glMultiDrawElementsIndirectCount，
+  * 提交次数只取决于模型的批次数，与场景中的实例数量无关，CPU不读回剔除结果
+  ******************************************************************************
+  * @attention
+  *     可见列表绑定在SSBO绑定点4，计数绑定在6，生成的命令绑定在7，计算时几何池的槽位命令绑定在5；
+  * 绘制须使用带SHADER_FEATURE_GPU_CULLED的plane.vert变体，布局须与cull.comp一致；
+  * 需要GL_ARB_shader_draw_parameters，不支持间接数量绘制时提交全部命令，多出的为空命令；
+  * 需要在模型加载完成且OpenGL上下文为当前时构造
+  ******************************************************************************
+  */
+
+#ifndef GPUCULLER_H
+#define GPUCULLER_H
+
+#include <QMatrix4x4>
+#include <QOpenGLFunctions_4_5_Core>
+#include <QOpenGLShaderProgram>
+#include <QVector3D>
+#include <QVector4D>
+#include <cstdint>
+
+class GLStateCache;
+class InstanceBuffer;
+class Model;
+
+// cull.comp中数组的长度：LOD级数和批次数的上限，超出的模型在CPU上选择LOD
+const uint32_t kMaxCullLods = 8;
+const uint32_t kMaxCullBatches = 32;
+// cull.comp的工作组大小
+const uint32_t kCullGroupSize = 64;
+// 剔除结果被绘制读取前需要的屏障：间接命令和计数、顶点着色器读取可见列表
+const GLbitfield kCullDrawBarriers = GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT;
+
+class GpuCuller
+{
+public:
+    /**
+      * @brief  构造函数，构建剔除程序并创建缓冲
+      * @author agent
+      * @param  gl_funs: OpenGL函数指针
+      * @param  model: 被剔除的模型，须满足Supported
+      * @retval none
+      */
+    GpuCuller(QOpenGLFunctions_4_5_Core *gl_funs, Model &model);
+    ~GpuCuller();
+    GpuCuller(const GpuCuller &) = delete;
+    GpuCuller &operator=(const GpuCuller &) = delete;
+
+    /**
+      * @brief  模型能否在GPU上剔除：驱动支持GL_ARB_shader_draw_parameters，LOD级数和批次数不超过上限
+      * @author agent
+      * @param  model: 模型
+      * @retval 是否支持
+      */
+    static bool Supported(const Model &model);
+
+    /**
+      * @brief  剔除实例缓冲中的所有实例并生成绘制命令，在绘制之前调用，绘制前须由调用者（渲染图）插入kCullDrawBarriers屏障
+      * @author agent
+      * @param  instances: 已上传的实例缓冲，全部为本模型的实例
+      * @param  view_projection: 投影矩阵 * 观察矩阵
+      * @param  camera_position: 相机的世界坐标
+      * @param  pixel_scale: 距离为1处单位长度的像素数，即projection(1,1) * 视口高度 / 2
+      * @param  near_clip: 近裁剪面距离，距离小于它时按它计算像素数
+      * @retval none
+      */
+    void Cull(InstanceBuffer &instances, const QMatrix4x4 &view_projection, const QVector3D &camera_position,
+              float pixel_scale, float near_clip);
+
+    /**
+      * @brief  绘制最近一次剔除的结果，每个批次一次间接数量绘制
+      * @author agent
+      * @param  shader: 当前绑定的着色器程序（带SHADER_FEATURE_GPU_CULLED的plane.vert），已绑定实例数据
+      * @retval none
+      */
+    void Draw(QOpenGLShaderProgram &shader);
+
+    // 剔除程序是否构建成功，失败时不应使用
+    bool ready;
+
+private:
+    /**
+      * @brief  按需扩大可见列表，每级LOD都能容纳全部实例
+      * @author agent
+      * @param  instance_count: 实例数量
+      * @retval none
+      */
+    void Reserve(uint32_t instance_count);
+
+    QOpenGLFunctions_4_5_Core *p_gl_funs;
+    GLStateCache *p_gl_state;
+    Model &model;
+    QOpenGLShaderProgram cull_program;      // 逐实例剔除和选择LOD
+    QOpenGLShaderProgram command_program;   // 逐命令生成绘制命令
+    unsigned int visible_buffer, counter_buffer, command_buffer;
+    uint32_t capacity;          // 可见列表中每级LOD的容量
+    QVector4D bounds;           // 模型空间包围球
+    uint32_t command_count;     // 命令缓冲中的命令数，即LOD级数 * 网格数
+};
+
+#endif // GPUCULLER_H
@@ -0,0 +1,252 @@
+#include "impostor.h"
+#include "frameuniforms.h"
+#include "glstatecache.h"
+#include "instancebuffer.h"
+#include "model.h"
+#include "programcache.h"
+#include "rendergraph.h"
+#include "streambuffer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+inline float SignNotZero(float value)
+{
+    return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+// 与impostor.vert中的FrameBasis一致：视角的屏幕右方向和上方向
+void FrameBasis(const QVector3D &direction, QVector3D &right, QVector3D &up)
+{
+    QVector3D reference = std::fabs(direction.y()) < 0.999f ? QVector3D(0.0f, 1.0f, 0.0f) : QVector3D(0.0f, 0.0f, 1.0f);
+    right = QVector3D::crossProduct(reference, direction).normalized();
+    up = QVector3D::crossProduct(direction, right);
+}
+
+// 烘焙通道：逐个视角把模型画进图集中对应的格子
+class BakePass : public RenderGraphPass
+{
+public:
+    BakePass(QOpenGLFunctions_4_5_Core *gl_funs, GLStateCache *gl_state, QOpenGLShaderProgram &program,
+             InstanceBuffer &instance, FrameUniforms &frames, Model &model, int frames_per_side, int frame_resolution)
+        : p_gl_funs(gl_funs), p_gl_state(gl_state), program(program), instance(instance), frames(frames), model(model),
+          frames_per_side(frames_per_side), frame_resolution(frame_resolution)
+    {
+    }
+
+    virtual void ExecutePass(uint32_t id, uint32_t param) override
+    {
+        Q_UNUSED(id);
+        Q_UNUSED(param);
+        // 空白处覆盖度为0，法线为0，深度为最远
+        const GLfloat clear_color[] = {0.0f, 0.0f, 0.0f, 0.0f};
+        const GLfloat clear_normal_depth[] = {0.5f, 0.5f, 0.5f, 1.0f};
+        const GLfloat clear_depth = 1.0f;
+        p_gl_funs->glClearBufferfv(GL_COLOR, 0, clear_color);
+        p_gl_funs->glClearBufferfv(GL_COLOR, 1, clear_normal_depth);
+        p_gl_funs->glClearBufferfv(GL_DEPTH, 0, &clear_depth);
+
+        p_gl_state->UseProgram(program.programId());
+        instance.Bind(program);
+        for (int j = 0; j < frames_per_side; j++)
+        {
+            for (int i = 0; i < frames_per_side; i++)
+            {
+                frames.Bind(j * frames_per_side + i);
+                p_gl_funs->glViewport(i * frame_resolution, j * frame_resolution, frame_resolution, frame_resolution);
+                model.Draw(program);
+            }
+        }
+        p_gl_state->UseProgram(0);
+    }
+
+private:
+    QOpenGLFunctions_4_5_Core *p_gl_funs;
+    GLStateCache *p_gl_state;
+    QOpenGLShaderProgram &program;
+    InstanceBuffer &instance;
+    FrameUniforms &frames;
+    Model &model;
+    int frames_per_side, frame_resolution;
+};
+
+} // namespace
+
+Impostor::Impostor(QOpenGLFunctions_4_5_Core *gl_funs, Model &model, ImpostorMapping_t mapping, int frames_per_side, int frame_resolution)
+    : p_gl_funs(gl_funs), p_gl_state(&GLStateCache::Current()), mapping(mapping), frames_per_side(std::max(frames_per_side, 2)), frame_resolution(frame_resolution),
+      atlas_color(0), atlas_normal_depth(0), VAO(0), located_program(0)
+{
+    // 包围球取模型包围盒的外接球
+    center = (model.aabb_min + model.aabb_max) * 0.5f;
+    radius = std::max((model.aabb_max - model.aabb_min).length() * 0.5f, 1e-6f);
+
+    Bake(model);
+
+    // 公告板四边形的顶点由gl_VertexID生成，VAO只包含逐实例属性：0~2号为模型矩阵的三行，3号为颜色，4号为漫反射系数；
+    // 属性格式与缓冲分离，绘制时只把绑定点0指向流式缓冲中本帧的实例数据
+    p_gl_funs->glCreateVertexArrays(1, &VAO);
+    for (unsigned int i = 0; i < 3; i++)
+        p_gl_funs->glVertexArrayAttribFormat(VAO, i, 4, GL_FLOAT, GL_FALSE, offsetof(ImpostorInstance, model_rows) + i * 4 * sizeof(float));
+    p_gl_funs->glVertexArrayAttribFormat(VAO, 3, 4, GL_FLOAT, GL_FALSE, offsetof(ImpostorInstance, color));
+    p_gl_funs->glVertexArrayAttribFormat(VAO, 4, 4, GL_FLOAT, GL_FALSE, offsetof(ImpostorInstance, diffuse));
+    for (unsigned int i = 0; i < 5; i++)
+    {
+        p_gl_funs->glVertexArrayAttribBinding(VAO, i, 0);
+        p_gl_funs->glEnableVertexArrayAttrib(VAO, i);
+    }
+    p_gl_funs->glVertexArrayBindingDivisor(VAO, 0, 1);
+}
+
+Impostor::~Impostor()
+{
+    p_gl_state->DeleteVertexArrays(1, &VAO);
+    const unsigned int textures[] = {atlas_color, atlas_normal_depth};
+    p_gl_state->DeleteTextures(2, textures);
+}
+
+void Impostor::Draw(QOpenGLShaderProgram &shader, const StreamAllocation &instances, uint32_t instance_count)
+{
+    if (instance_count == 0)
+        return;
+
+    // uniform位置只在着色器程序变化时查找一次；图集的纹理单元由impostor.frag中的binding固定
+    if (shader.programId() != located_program)
+    {
+        located_program = shader.programId();
+        uniform_locations[0] = shader.uniformLocation("impostor_center");
+        uniform_locations[1] = shader.uniformLocation("impostor_radius");
+        uniform_locations[2] = shader.uniformLocation("frames_per_side");
+        uniform_locations[3] = shader.uniformLocation("hemisphere");
+    }
+    shader.setUniformValue(uniform_locations[0], center);
+    shader.setUniformValue(uniform_locations[1], radius);
+    shader.setUniformValue(uniform_locations[2], frames_per_side);
+    shader.setUniformValue(uniform_locations[3], mapping == IMPOSTOR_HEMISPHERE ? 1 : 0);
+    p_gl_state->BindTextureUnit(0, atlas_color);
+    p_gl_state->BindTextureUnit(1, atlas_normal_depth);
+
+    // 实例数据已由调用者写入流式缓冲的当前帧，只需把绑定点0指向它
+    p_gl_funs->glVertexArrayVertexBuffer(VAO, 0, instances.buffer, (GLintptr)instances.offset, sizeof(ImpostorInstance));
+
+    p_gl_state->BindVertexArray(VAO);
+    p_gl_funs->glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)instance_count);
+}
+
+void Impostor::PackInstance(const QMatrix4x4 &model, const QVector3D &color, const QVector3D &diffuse, ImpostorInstance &out)
+{
+    for (int r = 0; r < 3; r++)
+    {
+        for (int c = 0; c < 4; c++)
+            out.model_rows[r][c] = model(r, c);
+    }
+    out.color[0] = color.x();
+    out.color[1] = color.y();
+    out.color[2] = color.z();
+    out.color[3] = 1.0f;
+    out.diffuse[0] = diffuse.x();
+    out.diffuse[1] = diffuse.y();
+    out.diffuse[2] = diffuse.z();
+    out.diffuse[3] = 0.0f;
+}
+
+void Impostor::Bake(Model &model)
+{
+    const int atlas_size = frames_per_side * frame_resolution;
+    // mip层数受限，避免最小几级在相邻视角之间串色
+    const int levels = std::max(1, (int)std::log2((float)frame_resolution) - 3);
+
+    // 颜色和覆盖度、模型空间法线和深度两张图集，用直接状态访问创建，不改变纹理单元的绑定
+    unsigned int textures[2];
+    p_gl_funs->glCreateTextures(GL_TEXTURE_2D, 2, textures);
+    atlas_color = textures[0];
+    atlas_normal_depth = textures[1];
+    for (unsigned int texture : textures)
+    {
+        p_gl_funs->glTextureStorage2D(texture, levels, GL_RGBA8, atlas_size, atlas_size);
+        p_gl_funs->glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        p_gl_funs->glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        p_gl_funs->glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        p_gl_funs->glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    // 保存当前帧缓冲和视口（QOpenGLWidget的默认帧缓冲不是0）
+    GLint previous_fbo, previous_viewport[4];
+    p_gl_funs->glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_fbo);
+    p_gl_funs->glGetIntegerv(GL_VIEWPORT, previous_viewport);
+
+    QOpenGLShaderProgram bake_program;
+    ProgramCache program_cache(p_gl_funs);
+    program_cache.Add(&bake_program, ":/shader/plane.vert", ":/shader/impostor_bake.frag");
+    program_cache.Build();
+    // 在模型空间烘焙：一个单位矩阵的静态实例
+    InstanceBuffer bake_instance(p_gl_funs);
+    bake_instance.Begin(1);
+    bake_instance.Add(QMatrix4x4(), QVector3D(1.0f, 1.0f, 1.0f), QVector3D(1.0f, 1.0f, 1.0f));
+    bake_instance.End();
+
+    // 正交投影恰好包住包围球，相机放在两倍半径处，深度0~1对应朝向相机的球面到背面；
+    // 每个视角一段逐帧数据，一次分配后逐个绑定
+    QMatrix4x4 projection;
+    projection.ortho(-radius, radius, -radius, radius, radius, 3.0f * radius);
+    FrameUniforms bake_frames(p_gl_funs, frames_per_side * frames_per_side);
+    bake_frames.Begin();
+    for (int j = 0; j < frames_per_side; j++)
+    {
+        for (int i = 0; i < frames_per_side; i++)
+        {
+            QVector3D direction = FrameDirection(i, j);
+            QVector3D right, up;
+            FrameBasis(direction, right, up);
+            QMatrix4x4 view;
+            view.lookAt(center + direction * 2.0f * radius, center, up);
+            bake_frames.Set(j * frames_per_side + i, projection, view, center + direction * 2.0f * radius);
+        }
+    }
+
+    // 图集作为外部纹理写入，深度只在烘焙期间需要，是渲染图的临时纹理；
+    // 渲染图按附件组合创建帧缓冲，随bake_graph一起删除
+    RenderGraph bake_graph(p_gl_funs);
+    const uint32_t color = bake_graph.ImportTexture("impostor_color", atlas_color, atlas_size, atlas_size);
+    const uint32_t normal_depth = bake_graph.ImportTexture("impostor_normal_depth", atlas_normal_depth, atlas_size, atlas_size);
+    const uint32_t depth = bake_graph.CreateTexture("impostor_depth", atlas_size, atlas_size, GL_DEPTH_COMPONENT24);
+    BakePass bake(p_gl_funs, p_gl_state, bake_program, bake_instance, bake_frames, model, frames_per_side, frame_resolution);
+    const uint32_t bake_pass = bake_graph.AddPass("impostor_bake", &bake, 0);
+    // 0号附件为颜色和覆盖度，1号附件为模型空间法线（映射到0~1）和深度
+    bake_graph.Write(bake_pass, color, GL_COLOR_ATTACHMENT0);
+    bake_graph.Write(bake_pass, normal_depth, GL_COLOR_ATTACHMENT1);
+    bake_graph.Write(bake_pass, depth, GL_DEPTH_ATTACHMENT);
+    bake_graph.Execute();
+
+    p_gl_funs->glBindFramebuffer(GL_FRAMEBUFFER, previous_fbo);
+    p_gl_funs->glViewport(previous_viewport[0], previous_viewport[1], previous_viewport[2], previous_viewport[3]);
+
+    for (unsigned int texture : textures)
+        p_gl_funs->glGenerateTextureMipmap(texture);
+}
+
+QVector3D Impostor::FrameDirection(int i, int j) const
+{
+    // 网格坐标映射到[-1, 1]，四角的视角恰好位于八面体的顶点/边上
+    float ox = (float)i / (frames_per_side - 1) * 2.0f - 1.0f;
+    float oy = (float)j / (frames_per_side - 1) * 2.0f - 1.0f;
+    QVector3D direction;
+    if (mapping == IMPOSTOR_HEMISPHERE)
+    {
+        float x = (ox + oy) * 0.5f;
+        float z = (ox - oy) * 0.5f;
+        direction = QVector3D(x, std::max(1.0f - std::fabs(x) - std::fabs(z), 0.0f), z);
+    }
+    else
+    {
+        float y = 1.0f - std::fabs(ox) - std::fabs(oy);
+        float x = ox, z = oy;
+        if (y < 0.0f)
+        {
+            x = (1.0f - std::fabs(oy)) * SignNotZero(ox);
+            z = (1.0f - std::fabs(ox)) * SignNotZero(oy);
+        }
+        direction = QVector3D(x, y, z);
+    }
+    return direction.normalized();
+}
@@ -0,0 +1,72 @@
+#version 450 core
+
+out vec4 FragColor;
+
+in vec2 AtlasUV[4];
+in vec2 FrameUV[4];
+in vec4 FrameWeights;
+in vec3 FragPos;
+in vec3 ViewPos;
+flat in mat3 NormalMatrix;
+flat in vec3 InstanceColor;
+flat in vec3 InstanceDiffuse;
+flat in float WorldRadius;
+
+layout (binding = 0) uniform sampler2D atlas_color;
+layout (binding = 1) uniform sampler2D atlas_normal_depth;
+// 逐帧数据，由FrameUniforms每帧上传一次，布局须与FrameData一致
+layout (std140, binding = 0) uniform FrameBlock
+{
+    mat4 projection;
+    mat4 view;
+    vec4 view_pos;
+    vec4 light_position;
+    vec4 light_color;
+};
+// 材质参数，由Material在加载时写入，绘制时切换绑定
+layout (std140, binding = 1) uniform MaterialBlock
+{
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+    float shininess;
+} material;
+
+void main()
+{
+    // 按覆盖度加权混合四个视角，落在视角范围外的采样不参与
+    float coverage = 0.0;
+    float weight_sum = 0.0;
+    vec4 normal_depth = vec4(0.0);
+    for (int k = 0; k < 4; k++)
+    {
+        if (any(lessThan(FrameUV[k], vec2(0.0))) || any(greaterThan(FrameUV[k], vec2(1.0))))
+            continue;
+        float w = FrameWeights[k] * texture(atlas_color, AtlasUV[k]).a;
+        coverage += w;
+        normal_depth += w * texture(atlas_normal_depth, AtlasUV[k]);
+        weight_sum += FrameWeights[k];
+    }
+    if (weight_sum <= 0.0 || coverage < 0.5 * weight_sum)
+        discard;
+    normal_depth /= coverage;
+
+    // 烘焙深度0~1对应包围球朝向相机一侧到背面，把片元沿视线推到实际表面
+    float offset = (0.5 - normal_depth.w) * 2.0 * WorldRadius;
+    vec3 to_camera = normalize(view_pos.xyz - FragPos);
+    vec3 surface_pos = FragPos + to_camera * offset;
+    vec4 clip = projection * vec4(ViewPos + normalize(-ViewPos) * offset, 1.0);
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+
+    // 与plane.frag相同的光照
+    vec3 norm = normalize(NormalMatrix * (normal_depth.xyz * 2.0 - 1.0));
+    vec3 ambient = material.ambient.rgb * light_color.rgb;
+    vec3 light_dir = normalize(light_position.xyz - surface_pos);
+    float diff = max(dot(norm, light_dir), 0.0);
+    vec3 diffuse = diff * light_color.rgb * material.diffuse.rgb * InstanceDiffuse;
+    vec3 reflect_dir = reflect(-light_dir, norm);
+    float spec = pow(max(dot(to_camera, reflect_dir), 0.0), material.shininess);
+    vec3 specular = spec * light_color.rgb * material.specular.rgb;
+
+    FragColor = vec4((ambient + diffuse + specular) * InstanceColor, 1.0);
+}
@@ -0,0 +1,121 @@
+/**
+  ******************************************************************************
+  * @file           : impostor.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了八面体公告板（octahedral impostor）类的定义。初始化时把模型从
+  * 八面体（或半八面体）网格上的各个方向正交渲染到图集中，图集包括颜色（含覆盖度）和
+  * 法线加深度两张纹理；运行时远处的飞机只画一个朝向相机的四边形，片元着色器在相邻的
+  * 四个视角之间混合，并用法线重新光照、用深度修正片元深度
+  ******************************************************************************
+  * @attention
+  *     视角网格的编码必须与impostor.vert中的Encode/Decode/FrameBasis一致；
+  * 烘焙使用plane.vert，需要在模型加载完成且OpenGL上下文为当前时构造
+  ******************************************************************************
+  */
+
+#ifndef IMPOSTOR_H
+#define IMPOSTOR_H
+
+#include <QMatrix4x4>
+#include <QOpenGLFunctions_4_5_Core>
+#include <QOpenGLShaderProgram>
+#include <QVector3D>
+#include "streambuffer.h"
+#include <cstdint>
+
+class GLStateCache;
+class Model;
+
+// 视角分布
+typedef enum
+{
+    IMPOSTOR_HEMISPHERE,    // 只覆盖上半球，适合只从上方观察的物体
+    IMPOSTOR_SPHERE,        // 覆盖整个球面，飞机会被从下方看到
+} ImpostorMapping_t;
+
+// 每个公告板实例：模型矩阵的前三行（仿射变换）、颜色和漫反射系数（与网格飞机的InstanceData一致）
+struct ImpostorInstance {
+    float model_rows[3][4];
+    float color[4];
+    float diffuse[4];
+};
+static_assert(sizeof(ImpostorInstance) == 80, "ImpostorInstance must be 80 bytes");
+
+class Impostor
+{
+public:
+    /**
+      * @brief  构造函数，创建图集并烘焙模型的各个视角
+      * @author agent
+      * @param  gl_funs: OpenGL函数指针
+      * @param  model: 要烘焙的模型
+      * @param  mapping: 视角分布
+      * @param  frames_per_side: 图集每边的视角数，共frames_per_side^2个视角
+      * @param  frame_resolution: 每个视角的分辨率（像素）
+      * @retval none
+      */
+    Impostor(QOpenGLFunctions_4_5_Core *gl_funs, Model &model, ImpostorMapping_t mapping = IMPOSTOR_SPHERE,
+             int frames_per_side = 12, int frame_resolution = 128);
+    ~Impostor();
+    Impostor(const Impostor &) = delete;
+    Impostor &operator=(const Impostor &) = delete;
+
+    /**
+      * @brief  实例化绘制公告板，调用前需绑定公告板着色器并设置相机、光照和材质
+      * @author agent
+      * @param  shader: 公告板着色器程序（impostor.vert/impostor.frag）
+      * @param  instances: 流式缓冲当前帧中的实例数据，由PackInstance直接写入
+      * @param  instance_count: 实例数量
+      * @retval none
+      */
+    void Draw(QOpenGLShaderProgram &shader, const StreamAllocation &instances, uint32_t instance_count);
+
+    /**
+      * @brief  由模型矩阵、颜色和漫反射系数填写实例数据
+      * @author agent
+      * @param  model: 模型矩阵（仿射，均匀缩放）
+      * @param  color: 实例颜色
+      * @param  diffuse: 漫反射系数
+      * @param  out: 输出的实例数据
+      * @retval none
+      */
+    static void PackInstance(const QMatrix4x4 &model, const QVector3D &color, const QVector3D &diffuse, ImpostorInstance &out);
+
+    // 模型空间的包围球
+    QVector3D center;
+    float radius;
+
+private:
+    /**
+      * @brief  逐个视角正交渲染模型到图集
+      * @author agent
+      * @param  model: 要烘焙的模型
+      * @retval none
+      */
+    void Bake(Model &model);
+
+    /**
+      * @brief  视角网格坐标对应的观察方向（从模型指向相机）
+      * @author agent
+      * @param  i: 列
+      * @param  j: 行
+      * @retval 单位方向
+      */
+    QVector3D FrameDirection(int i, int j) const;
+
+    QOpenGLFunctions_4_5_Core *p_gl_funs;
+    GLStateCache *p_gl_state;
+    ImpostorMapping_t mapping;
+    int frames_per_side;
+    int frame_resolution;
+
+    unsigned int atlas_color, atlas_normal_depth;
+    unsigned int VAO;     // 只包含逐实例属性，实例数据每次绘制时写入流式缓冲
+    // 上一次绘制所用着色器程序中的uniform位置：impostor_center、impostor_radius、frames_per_side、hemisphere
+    unsigned int located_program;
+    int uniform_locations[4];
+};
+
+#endif // IMPOSTOR_H
@@ -0,0 +1,113 @@
+#version 450 core
+
+// 逐实例属性：模型矩阵的前三行、颜色和漫反射系数
+layout (location = 0) in vec4 aModelRow0;
+layout (location = 1) in vec4 aModelRow1;
+layout (location = 2) in vec4 aModelRow2;
+layout (location = 3) in vec4 aColor;
+layout (location = 4) in vec4 aDiffuse;
+
+// 相邻四个视角在图集中的纹理坐标、各自视角内的坐标（用于裁剪）和混合权重
+out vec2 AtlasUV[4];
+out vec2 FrameUV[4];
+out vec4 FrameWeights;
+out vec3 FragPos;
+out vec3 ViewPos;
+flat out mat3 NormalMatrix;
+flat out vec3 InstanceColor;
+flat out vec3 InstanceDiffuse;
+flat out float WorldRadius;
+
+// 逐帧数据，由FrameUniforms每帧上传一次，布局须与FrameData一致
+layout (std140, binding = 0) uniform FrameBlock
+{
+    mat4 projection;
+    mat4 view;
+    vec4 view_pos;
+    vec4 light_position;
+    vec4 light_color;
+};
+
+uniform vec3 impostor_center;
+uniform float impostor_radius;
+uniform int frames_per_side;
+uniform int hemisphere;
+
+float SignNotZero(float v)
+{
+    return v >= 0.0 ? 1.0 : -1.0;
+}
+
+// 观察方向 -> 视角网格坐标（[-1, 1]），与Impostor::FrameDirection互逆
+vec2 Encode(vec3 d)
+{
+    d /= abs(d.x) + abs(d.y) + abs(d.z);
+    if (hemisphere != 0)
+        return vec2(d.x + d.z, d.x - d.z);
+    if (d.y < 0.0)
+        return vec2((1.0 - abs(d.z)) * SignNotZero(d.x), (1.0 - abs(d.x)) * SignNotZero(d.z));
+    return d.xz;
+}
+
+vec3 Decode(vec2 o)
+{
+    if (hemisphere != 0)
+    {
+        float x = (o.x + o.y) * 0.5;
+        float z = (o.x - o.y) * 0.5;
+        return normalize(vec3(x, max(1.0 - abs(x) - abs(z), 0.0), z));
+    }
+    vec3 d = vec3(o.x, 1.0 - abs(o.x) - abs(o.y), o.y);
+    if (d.y < 0.0)
+        d.xz = vec2((1.0 - abs(o.y)) * SignNotZero(o.x), (1.0 - abs(o.x)) * SignNotZero(o.y));
+    return normalize(d);
+}
+
+// 视角的屏幕右方向和上方向，与烘焙时的相机一致
+void FrameBasis(vec3 d, out vec3 right, out vec3 up)
+{
+    vec3 reference = abs(d.y) < 0.999 ? vec3(0.0, 1.0, 0.0) : vec3(0.0, 0.0, 1.0);
+    right = normalize(cross(reference, d));
+    up = cross(d, right);
+}
+
+void main()
+{
+    mat4 model = transpose(mat4(aModelRow0, aModelRow1, aModelRow2, vec4(0.0, 0.0, 0.0, 1.0)));
+    mat3 linear = mat3(model);
+    mat3 inverse_linear = inverse(linear);
+    vec3 world_center = vec3(model * vec4(impostor_center, 1.0));
+    WorldRadius = impostor_radius * length(linear[0]);
+
+    // 朝向相机的四边形，四个顶点由gl_VertexID生成（三角形带）
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    vec3 camera_right = vec3(view[0][0], view[1][0], view[2][0]);
+    vec3 camera_up = vec3(view[0][1], view[1][1], view[2][1]);
+    vec3 world_pos = world_center + (camera_right * corner.x + camera_up * corner.y) * WorldRadius;
+
+    // 模型空间的观察方向落在视角网格的某个格子里，取格子四角的视角双线性混合
+    vec3 view_dir = normalize(inverse_linear * (view_pos.xyz - world_center));
+    float last = float(frames_per_side - 1);
+    vec2 grid = (Encode(view_dir) * 0.5 + 0.5) * last;
+    vec2 base = clamp(floor(grid), vec2(0.0), vec2(last - 1.0));
+    vec2 f = clamp(grid - base, 0.0, 1.0);
+    FrameWeights = vec4((1.0 - f.x) * (1.0 - f.y), f.x * (1.0 - f.y), (1.0 - f.x) * f.y, f.x * f.y);
+
+    // 四边形顶点沿各视角方向平行投影到该视角的成像平面上
+    vec3 local = inverse_linear * (world_pos - world_center);
+    for (int k = 0; k < 4; k++)
+    {
+        vec2 cell = base + vec2(k & 1, k >> 1);
+        vec3 right, up;
+        FrameBasis(Decode(cell / last * 2.0 - 1.0), right, up);
+        FrameUV[k] = vec2(dot(local, right), dot(local, up)) / (2.0 * impostor_radius) + 0.5;
+        AtlasUV[k] = (cell + FrameUV[k]) / float(frames_per_side);
+    }
+
+    NormalMatrix = mat3(normalize(linear[0]), normalize(linear[1]), normalize(linear[2]));
+    InstanceColor = aColor.rgb;
+    InstanceDiffuse = aDiffuse.rgb;
+    FragPos = world_pos;
+    ViewPos = vec3(view * vec4(world_pos, 1.0));
+    gl_Position = projection * vec4(ViewPos, 1.0);
+}
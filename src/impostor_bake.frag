@@ -0,0 +1,16 @@
+#version 450 core
+
+// 公告板烘焙：0号输出为颜色和覆盖度，1号输出为模型空间法线（映射到0~1）和深度
+// 颜色在绘制公告板时乘以实例颜色，这里只记录覆盖度
+layout (location = 0) out vec4 ColorOut;
+layout (location = 1) out vec4 NormalDepthOut;
+
+in vec2 TexCoords;
+in vec3 Normal;
+in vec3 FragPos;
+
+void main()
+{
+    ColorOut = vec4(1.0);
+    NormalDepthOut = vec4(normalize(Normal) * 0.5 + 0.5, gl_FragCoord.z);
+}
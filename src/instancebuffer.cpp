@@ -0,0 +1,98 @@
+#include "instancebuffer.h"
+#include "animator.h"
+#include "glstatecache.h"
+#include <algorithm>
+#include <cstring>
+
+InstanceBuffer::InstanceBuffer(QOpenGLFunctions_4_5_Core *gl_funs)
+    : p_gl_funs(gl_funs), p_gl_state(&GLStateCache::Current()), p_stream_buffer(&StreamBuffer::Current()),
+      instance_count(0), instance_capacity(0), animation_matrix_count(0), animation_matrix_capacity(0),
+      uploaded_instances{nullptr, 0, 0, 0}, uploaded_animations{nullptr, 0, 0, 0}, located_program(0), instance_base_location(-1)
+{
+}
+
+void InstanceBuffer::Begin(uint32_t capacity, uint32_t animation_matrix_capacity)
+{
+    // 上一帧仍在读取的数据在流式缓冲的另一段中；没有动画的帧也要绑定非空的动画矩阵缓冲，至少分配一个矩阵
+    const size_t alignment = p_stream_buffer->storage_alignment;
+    instance_count = 0;
+    instance_capacity = capacity;
+    animation_matrix_count = 0;
+    this->animation_matrix_capacity = std::max(animation_matrix_capacity, 1u);
+    uploaded_instances = p_stream_buffer->Allocate(capacity * sizeof(ModelInstance), alignment);
+    uploaded_animations = p_stream_buffer->Allocate(this->animation_matrix_capacity * 16 * sizeof(float), alignment);
+}
+
+uint32_t InstanceBuffer::Add(const QMatrix4x4 &model, const QVector3D &color, const QVector3D &diffuse, const Animator *p_animator)
+{
+    if (instance_count == instance_capacity)
+        return instance_count;
+
+    // 映射内存只写不读，逐个字段写入
+    ModelInstance &instance = reinterpret_cast<ModelInstance *>(uploaded_instances.p_data)[instance_count];
+    std::memcpy(instance.model, model.constData(), sizeof(instance.model));
+    const QMatrix3x3 normal_matrix = model.normalMatrix();
+    for (int c = 0; c < 3; c++)
+    {
+        for (int r = 0; r < 3; r++)
+            instance.normal_matrix[c][r] = normal_matrix(r, c);
+        instance.normal_matrix[c][3] = 0.0f;
+    }
+    for (int k = 0; k < 3; k++)
+    {
+        instance.color[k] = color[k];
+        instance.diffuse[k] = diffuse[k];
+    }
+    instance.color[3] = 1.0f;
+    instance.diffuse[3] = 0.0f;
+    instance.padding[0] = instance.padding[1] = 0;
+
+    const uint32_t matrix_count = p_animator != nullptr ? (uint32_t)(p_animator->matrices.size() / 16) : 0;
+    if (matrix_count != 0 && animation_matrix_count + matrix_count <= animation_matrix_capacity)
+    {
+        const int32_t base = (int32_t)animation_matrix_count;
+        instance.animation_base = base;
+        instance.bone_base = base + (int32_t)p_animator->node_worlds.size();
+        std::memcpy(uploaded_animations.p_data + animation_matrix_count * 16 * sizeof(float), p_animator->matrices.data(),
+                    matrix_count * 16 * sizeof(float));
+        animation_matrix_count += matrix_count;
+    }
+    else
+    {
+        instance.animation_base = -1;
+        instance.bone_base = -1;
+    }
+    return instance_count++;
+}
+
+void InstanceBuffer::End(void)
+{
+    uploaded_instances.size = instance_count * sizeof(ModelInstance);
+    if (animation_matrix_count == 0)
+    {
+        const float identity[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+        std::memcpy(uploaded_animations.p_data, identity, sizeof(identity));
+        animation_matrix_count = 1;
+    }
+    uploaded_animations.size = animation_matrix_count * 16 * sizeof(float);
+}
+
+void InstanceBuffer::Bind(QOpenGLShaderProgram &shader, uint32_t first_instance)
+{
+    p_gl_state->BindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, uploaded_animations.buffer, uploaded_animations.offset, uploaded_animations.size);
+    // 没有实例时不会有绘制读取实例数据，不绑定空区间
+    if (uploaded_instances.size != 0)
+        p_gl_state->BindBufferRange(GL_SHADER_STORAGE_BUFFER, 3, uploaded_instances.buffer, uploaded_instances.offset, uploaded_instances.size);
+    // 每组实例绘制前都要设置，位置只在换程序时按名称查询一次
+    if (shader.programId() != located_program)
+    {
+        located_program = shader.programId();
+        instance_base_location = shader.uniformLocation("instance_base");
+    }
+    shader.setUniformValue(instance_base_location, (GLint)first_instance);
+}
+
+uint32_t InstanceBuffer::Size(void) const
+{
+    return instance_count;
+}
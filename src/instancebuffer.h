@@ -0,0 +1,115 @@
+/**
+  ******************************************************************************
+  * @file           : instancebuffer.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了模型实例缓冲的定义。每帧把所有要绘制的实例（模型矩阵、法线矩阵、
+  * 颜色和动画矩阵位置）写入一个SSBO，所有实例的动画矩阵拼接后写入另一个SSBO；
+  * 同一模型同一LOD的实例在缓冲中连续存放，一次实例化的间接绘制画完，
+  * 着色器用instance_base + gl_InstanceID取实例数据；两者每帧在流式缓冲（见StreamBuffer）的当前帧按上限分配一次，
+  * 追加实例时直接写入映射内存，不经CPU端数组
+  ******************************************************************************
+  * @attention
+  *     实例数据绑定在SSBO绑定点3，动画矩阵绑定在SSBO绑定点1，布局须与plane.vert一致；
+  * 法线矩阵在CPU上按模型矩阵计算，着色器中再乘以节点变换的线性部分，假定节点变换不含非均匀缩放
+  ******************************************************************************
+  */
+
+#ifndef INSTANCEBUFFER_H
+#define INSTANCEBUFFER_H
+
+#include <QMatrix4x4>
+#include <QOpenGLFunctions_4_5_Core>
+#include <QOpenGLShaderProgram>
+#include <QVector3D>
+#include "streambuffer.h"
+#include <cstdint>
+
+class Animator;
+class GLStateCache;
+
+// 每个实例的数据，与着色器中的ModelInstance（std430）一致
+// normal_matrix为模型矩阵线性部分的逆转置（按列，每列补齐为4个float）
+// animation_base为该实例动画矩阵的起点，无动画时为-1；bone_base为其中骨骼蒙皮矩阵的起点
+struct ModelInstance {
+    float model[16];
+    float normal_matrix[3][4];
+    float color[4];
+    float diffuse[4];
+    int32_t animation_base;
+    int32_t bone_base;
+    int32_t padding[2];
+};
+static_assert(sizeof(ModelInstance) == 160, "ModelInstance must match the std430 layout");
+
+class InstanceBuffer
+{
+public:
+    /**
+      * @brief  构造函数，需要OpenGL上下文为当前
+      * @author agent
+      * @param  gl_funs: OpenGL函数指针
+      * @retval none
+      */
+    explicit InstanceBuffer(QOpenGLFunctions_4_5_Core *gl_funs);
+    InstanceBuffer(const InstanceBuffer &) = delete;
+    InstanceBuffer &operator=(const InstanceBuffer &) = delete;
+
+    /**
+      * @brief  清空实例，并在流式缓冲的当前帧为实例和动画矩阵按上限分配空间，每帧Add之前调用
+      * @author agent
+      * @param  capacity: 本帧最多追加的实例数量
+      * @param  animation_matrix_capacity: 本帧所有实例的动画矩阵总数上限（每个Animator为matrices.size() / 16个）
+      * @retval none
+      */
+    void Begin(uint32_t capacity, uint32_t animation_matrix_capacity = 0);
+
+    /**
+      * @brief  追加实例，直接写入映射内存，需要连续绘制的实例应连续追加；超出Begin时的容量则不追加
+      * @author agent
+      * @param  model: 模型矩阵
+      * @param  color: 材质颜色
+      * @param  diffuse: 漫反射系数
+      * @param  p_animator: 实例的动画播放器，已Update；为nullptr或动画矩阵超出容量时使用模型的静态节点变换
+      * @retval 实例编号，超出容量时为Size()
+      */
+    uint32_t Add(const QMatrix4x4 &model, const QVector3D &color, const QVector3D &diffuse, const Animator *p_animator = nullptr);
+
+    /**
+      * @brief  结束本帧的追加，实例和动画矩阵的区间收缩到实际写入的大小，每帧绘制前调用
+      * @author agent
+      * @param  none
+      * @retval none
+      */
+    void End(void);
+
+    /**
+      * @brief  绑定实例缓冲和动画矩阵缓冲，并设置之后绘制的第一个实例
+      * @author agent
+      * @param  shader: 当前绑定的着色器程序（plane.vert）
+      * @param  first_instance: 之后绘制的第一个实例编号
+      * @retval none
+      */
+    void Bind(QOpenGLShaderProgram &shader, uint32_t first_instance = 0);
+
+    /**
+      * @brief  实例数量
+      * @author agent
+      * @param  none
+      * @retval 实例数量
+      */
+    uint32_t Size(void) const;
+
+private:
+    QOpenGLFunctions_4_5_Core *p_gl_funs;
+    GLStateCache *p_gl_state;
+    StreamBuffer *p_stream_buffer;
+    uint32_t instance_count, instance_capacity;
+    uint32_t animation_matrix_count, animation_matrix_capacity;
+    StreamAllocation uploaded_instances, uploaded_animations;    // 本帧分配的位置，End后为实际写入的区间
+    unsigned int located_program;       // 最近一次查询instance_base位置的程序
+    int instance_base_location;
+};
+
+#endif // INSTANCEBUFFER_H
@@ -1,5 +1,11 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "modelloader.h"
+#include "myopenglwidget.h"
+#include <QAction>
+#include <QFileDialog>
+#include <QLabel>
+#include <QMenu>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -7,6 +13,42 @@ MainWindow::MainWindow(QWidget *parent)
 {
     ui->setupUi(this);
     setCentralWidget(ui->openGLWidget);
+
+    // 文件菜单：切换飞机模型，加载中的上一个模型会被取消
+    QMenu *p_file_menu = ui->menubar->addMenu("文件");
+    QAction *p_open_action = p_file_menu->addAction("打开模型...");
+    connect(p_open_action, &QAction::triggered, this, [this]() {
+        const QString path = QFileDialog::getOpenFileName(this, "打开模型", QString(),
+                                                          "模型文件 (*.stl *.obj *.fbx *.dae *.3ds *.ply *.gltf *.glb);;所有文件 (*)");
+        if (!path.isEmpty())
+            ui->openGLWidget->LoadPlaneModel(path);
+    });
+
+    // 模型加载进度显示在状态栏
+    ModelLoader *p_loader = ui->openGLWidget->p_model_loader;
+    connect(p_loader, &ModelLoader::Progress, this, [this](int request, float fraction) {
+        Q_UNUSED(request);
+        ui->statusbar->showMessage(QString("正在加载模型 %1%").arg((int)(fraction * 100.0f)));
+    });
+    connect(p_loader, &ModelLoader::Loaded, this, [this]() {
+        ui->statusbar->clearMessage();
+    });
+    connect(p_loader, &ModelLoader::Failed, this, [this]() {
+        ui->statusbar->showMessage("模型加载失败");
+    });
+
+    // 每帧的OpenGL调用统计常驻在状态栏右侧
+    QLabel *p_state_label = new QLabel(this);
+    ui->statusbar->addPermanentWidget(p_state_label);
+    connect(ui->openGLWidget, &MyOpenGLWidget::StateCallsCounted, p_state_label, [p_state_label](uint issued, uint saved) {
+        p_state_label->setText(QString("GL调用 %1，省去 %2").arg(issued).arg(saved));
+    });
+    // 渲染图临时纹理的显存：别名后实际占用和不别名时所需
+    QLabel *p_transient_label = new QLabel(this);
+    ui->statusbar->addPermanentWidget(p_transient_label);
+    connect(ui->openGLWidget, &MyOpenGLWidget::TransientMemoryCounted, p_transient_label, [p_transient_label](qulonglong peak, qulonglong unaliased) {
+        p_transient_label->setText(QString("临时纹理 %1 KiB，不别名 %2 KiB").arg(peak / 1024).arg(unaliased / 1024));
+    });
 }
 
 MainWindow::~MainWindow()
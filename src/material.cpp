@@ -0,0 +1,88 @@
+#include "material.h"
+#include "glstatecache.h"
+#include <cstring>
+
+namespace {
+
+// 下一个材质的排序编号，材质只在OpenGL线程中构造
+uint32_t next_sort_id = 1;
+
+} // namespace
+
+Material::Material(QOpenGLFunctions_4_5_Core *gl_funs, const vector<Texture> &textures,
+                   const QVector3D &ambient, const QVector3D &diffuse, const QVector3D &specular, float shininess)
+    : parameters(MakeParameters(ambient, diffuse, specular, shininess)), sort_id(next_sort_id++), p_gl_funs(gl_funs), p_gl_state(&GLStateCache::Current()), uniform_buffer(0)
+{
+    binding_count = AssignUnits(textures, bindings);
+
+    // 参数在材质的生命周期内不变，上传一次
+    p_gl_funs->glGenBuffers(1, &uniform_buffer);
+    p_gl_state->BindBuffer(GL_UNIFORM_BUFFER, uniform_buffer);
+    p_gl_funs->glBufferData(GL_UNIFORM_BUFFER, sizeof(parameters), &parameters, GL_STATIC_DRAW);
+}
+
+Material::~Material()
+{
+    p_gl_state->DeleteBuffers(1, &uniform_buffer);
+}
+
+void Material::Bind(void) const
+{
+    p_gl_state->BindBufferBase(GL_UNIFORM_BUFFER, kMaterialUniformBinding, uniform_buffer);
+    for (unsigned int i = 0; i < binding_count; i++)
+        p_gl_state->BindTextureUnit(bindings[i].unit, bindings[i].id);
+}
+
+bool Material::HasDiffuseTexture(void) const
+{
+    for (unsigned int i = 0; i < binding_count; i++)
+    {
+        if (bindings[i].unit == kMaterialDiffuseUnit)
+            return true;
+    }
+    return false;
+}
+
+bool Material::Matches(const vector<Texture> &textures, const MaterialParameters &other) const
+{
+    if (std::memcmp(&parameters, &other, sizeof(parameters)) != 0)
+        return false;
+    TextureBinding other_bindings[kMaterialMaxTextures];
+    const unsigned int other_count = AssignUnits(textures, other_bindings);
+    if (other_count != binding_count)
+        return false;
+    for (unsigned int i = 0; i < binding_count; i++)
+    {
+        if (bindings[i].unit != other_bindings[i].unit || bindings[i].id != other_bindings[i].id)
+            return false;
+    }
+    return true;
+}
+
+MaterialParameters Material::MakeParameters(const QVector3D &ambient, const QVector3D &diffuse, const QVector3D &specular, float shininess)
+{
+    MaterialParameters out;
+    for (int k = 0; k < 3; k++)
+    {
+        out.ambient[k] = ambient[k];
+        out.diffuse[k] = diffuse[k];
+        out.specular[k] = specular[k];
+    }
+    out.ambient[3] = out.diffuse[3] = out.specular[3] = 0.0f;
+    out.shininess = shininess;
+    out.padding[0] = out.padding[1] = out.padding[2] = 0.0f;
+    return out;
+}
+
+unsigned int Material::AssignUnits(const vector<Texture> &textures, TextureBinding *out)
+{
+    unsigned int diffuse_count = 0, specular_count = 0, count = 0;
+    for (const Texture &texture : textures)
+    {
+        if (texture.type == "texture_diffuse" && diffuse_count < kMaterialTexturesPerType)
+            out[count++] = TextureBinding{kMaterialDiffuseUnit + diffuse_count++, texture.id};
+        else if (texture.type == "texture_specular" && specular_count < kMaterialTexturesPerType)
+            out[count++] = TextureBinding{kMaterialSpecularUnit + specular_count++, texture.id};
+    }
+    return count;
+}
@@ -0,0 +1,129 @@
+/**
+  ******************************************************************************
+  * @file           : material.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了材质类的定义。材质在模型加载时构造一次：纹理按类型和序号分配固定的纹理单元，
+  * 光照参数以std140布局写入材质自己的UBO；绘制时只需绑定一个UBO和若干纹理单元，
+  * 不再拼接采样器名字、查找uniform位置，也不分配任何内存
+  ******************************************************************************
+  * @attention
+  *     着色器用layout(binding)声明采样器和MaterialBlock，单元编号和绑定点须与这里的常量一致；
+  * 需要在OpenGL上下文为当前时构造、绑定和析构
+  ******************************************************************************
+  */
+
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include "mesh.h"
+#include <QOpenGLFunctions_4_5_Core>
+#include <QVector3D>
+
+class GLStateCache;
+
+// 材质参数的UBO绑定点，绑定点0为逐帧数据
+const unsigned int kMaterialUniformBinding = 1;
+// 纹理单元分配：网格纹理列表中第i个（从0起，按出现顺序计数）漫反射纹理在kMaterialDiffuseUnit + i，
+// 第i个镜面纹理在kMaterialSpecularUnit + i，与纹理名中的编号无关，每类超过kMaterialTexturesPerType个的忽略
+const unsigned int kMaterialTexturesPerType = 4;
+const unsigned int kMaterialDiffuseUnit = 0;
+const unsigned int kMaterialSpecularUnit = kMaterialDiffuseUnit + kMaterialTexturesPerType;
+const unsigned int kMaterialMaxTextures = 2 * kMaterialTexturesPerType;
+
+// 材质参数，与着色器中的MaterialBlock（std140）一致
+struct MaterialParameters {
+    float ambient[4];
+    float diffuse[4];
+    float specular[4];
+    float shininess;
+    float padding[3];
+};
+static_assert(sizeof(MaterialParameters) == 64, "MaterialParameters must match the std140 layout");
+
+class Material
+{
+public:
+    /**
+      * @brief  构造函数，分配纹理单元并创建参数UBO
+      * @author agent
+      * @param  gl_funs: OpenGL函数指针
+      * @param  textures: 纹理，id须已解析；超出每种类型单元数量或类型未知的纹理被忽略
+      * @param  ambient: 环境光系数
+      * @param  diffuse: 漫反射系数
+      * @param  specular: 镜面反射系数
+      * @param  shininess: 镜面反射指数
+      * @retval none
+      */
+    Material(QOpenGLFunctions_4_5_Core *gl_funs, const vector<Texture> &textures,
+             const QVector3D &ambient = QVector3D(0.1f, 0.1f, 0.1f), const QVector3D &diffuse = QVector3D(1.0f, 1.0f, 1.0f),
+             const QVector3D &specular = QVector3D(1.0f, 1.0f, 1.0f), float shininess = 1.0f);
+    ~Material();
+    Material(const Material &) = delete;
+    Material &operator=(const Material &) = delete;
+
+    /**
+      * @brief  绑定参数UBO和纹理
+      * @author agent
+      * @param  none
+      * @retval none
+      */
+    void Bind(void) const;
+
+    /**
+      * @brief  是否带漫反射纹理
+      * @author agent
+      * @param  none
+      * @retval 第一个漫反射纹理单元上是否有纹理
+      */
+    bool HasDiffuseTexture(void) const;
+
+    /**
+      * @brief  是否与给定的纹理和参数构造出的材质相同，用于加载时合并重复的材质
+      * @author agent
+      * @param  textures: 纹理
+      * @param  other: 参数
+      * @retval 是否相同
+      */
+    bool Matches(const vector<Texture> &textures, const MaterialParameters &other) const;
+
+    /**
+      * @brief  由颜色和指数填写材质参数
+      * @author agent
+      * @param  ambient: 环境光系数
+      * @param  diffuse: 漫反射系数
+      * @param  specular: 镜面反射系数
+      * @param  shininess: 镜面反射指数
+      * @retval 材质参数
+      */
+    static MaterialParameters MakeParameters(const QVector3D &ambient, const QVector3D &diffuse, const QVector3D &specular, float shininess);
+
+    MaterialParameters parameters;
+    // 渲染队列排序键中的材质编号，按构造顺序分配，从1开始（0表示没有材质）
+    uint32_t sort_id;
+
+private:
+    // 一个纹理绑定：纹理单元和纹理对象
+    struct TextureBinding {
+        unsigned int unit;
+        unsigned int id;
+    };
+
+    /**
+      * @brief  按类型和序号为纹理分配纹理单元
+      * @author agent
+      * @param  textures: 纹理
+      * @param  out: 输出的纹理绑定，至少kMaterialMaxTextures个
+      * @retval 纹理绑定数量
+      */
+    static unsigned int AssignUnits(const vector<Texture> &textures, TextureBinding *out);
+
+    QOpenGLFunctions_4_5_Core *p_gl_funs;
+    GLStateCache *p_gl_state;
+    TextureBinding bindings[kMaterialMaxTextures];
+    unsigned int binding_count;
+    unsigned int uniform_buffer;
+};
+
+#endif // MATERIAL_H
@@ -1,65 +1,115 @@
 #include "mesh.h"
+#include "material.h"
+#include <algorithm>
 
-Mesh::Mesh(QOpenGLFunctions_4_5_Core *gl_funs, vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
-    : p_gl_funs(gl_funs)
+Mesh::Mesh(GeometryPool *pool, uint32_t first_draw_slot, uint32_t draw_slot_stride, uint32_t draw_slot_count, MeshData &&data, bool keep_cpu_data)
+    : vertices(std::move(data.vertices)), indices(std::move(data.indices)), textures(std::move(data.textures)), lods(std::move(data.lods)), skin(std::move(data.skin)),
+      meshlets(std::move(data.meshlets)), aabb_min(data.aabb_min), aabb_max(data.aabb_max),
+      first_draw_slot(first_draw_slot), draw_slot_stride(draw_slot_stride), draw_slot_count(draw_slot_count), p_pool(pool)
 {
-    this->vertices = vertices;
-    this->indices = indices;
-    this->textures = textures;
-    Setup();
+    Setup(data.quantized.data(), data.quantized.size(), indices.data(), indices.size(), skin.empty() ? nullptr : skin.data());
+    if (!keep_cpu_data)
+        ReleaseCpuData();
 }
 
-void Mesh::Draw(QOpenGLShaderProgram &shader)
+Mesh::Mesh(GeometryPool *pool, uint32_t first_draw_slot, uint32_t draw_slot_stride, uint32_t draw_slot_count,
+           const QuantizedVertex *vertices, size_t vertex_count, const QVector3D &aabb_min, const QVector3D &aabb_max,
+           const unsigned int *indices, size_t index_count,
+           const VertexSkin *skin, vector<MeshLod> lods, vector<Meshlet> meshlets, vector<Texture> textures, bool keep_cpu_data)
+    : textures(std::move(textures)), lods(std::move(lods)), meshlets(std::move(meshlets)), aabb_min(aabb_min), aabb_max(aabb_max),
+      first_draw_slot(first_draw_slot), draw_slot_stride(draw_slot_stride), draw_slot_count(draw_slot_count), p_pool(pool)
 {
-    unsigned int diffuseNr = 1;
-    unsigned int specularNr = 1;
-    for (unsigned int i = 0; i < textures.size(); i++)
+    if (keep_cpu_data)
     {
-        p_gl_funs->glActiveTexture(GL_TEXTURE0 + i);
-        string number;
-        string name = textures[i].type;
-        if (name == "texture_diffuse")
-            number = std::to_string(diffuseNr++);
-        else if (name == "texture_specular")
-            number = std::to_string(specularNr++);
+        DequantizeVertices(vertices, vertex_count, aabb_min, aabb_max, this->vertices);
+        this->indices.assign(indices, indices + index_count);
+        if (skin)
+            this->skin.assign(skin, skin + vertex_count);
+    }
+    Setup(vertices, vertex_count, indices, index_count, skin);
+}
+
+Mesh::Mesh(Mesh &&other) noexcept
+{
+    Take(other);
+}
 
-        shader.setUniformValue(("material." + name + number).c_str(), i);
-        p_gl_funs->glBindTexture(GL_TEXTURE_2D, textures[i].id);
+Mesh &Mesh::operator=(Mesh &&other) noexcept
+{
+    if (this != &other)
+    {
+        Destroy();
+        Take(other);
     }
-    p_gl_funs->glBindVertexArray(VAO);
-    p_gl_funs->glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-    p_gl_funs->glBindVertexArray(0);
+    return *this;
 }
 
-void Mesh::Setup()
+Mesh::~Mesh()
 {
-    // 创建VAO、VBO和EBO
-    p_gl_funs->glGenVertexArrays(1, &VAO);
-    p_gl_funs->glGenBuffers(1, &VBO);
-    p_gl_funs->glGenBuffers(1, &EBO);
+    Destroy();
+}
 
-    // 绑定VAO，记录配置
-    p_gl_funs->glBindVertexArray(VAO);
+void Mesh::Draw(QOpenGLShaderProgram &shader, uint32_t lod)
+{
+    if (p_material)
+        p_material->Bind();
+    p_pool->Draw(shader, first_draw_slot + std::min(lod, draw_slot_count - 1) * draw_slot_stride, 1);
+}
 
-    // 绑定VBO，将顶点数据复制到缓冲中，然后传递给OpenGL
-    p_gl_funs->glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    p_gl_funs->glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+void Mesh::SetTransform(uint32_t node, const QMatrix4x4 &transform)
+{
+    for (uint32_t k = 0; k < draw_slot_count; k++)
+        p_pool->SetDrawTransform(first_draw_slot + k * draw_slot_stride, node, transform);
+}
 
-    // 绑定EBO，将索引数据复制到缓冲中，然后传递给OpenGL
-    p_gl_funs->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    p_gl_funs->glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+void Mesh::ReleaseCpuData()
+{
+    // swap释放容量，clear只会清空元素
+    vector<Vertex>().swap(vertices);
+    vector<unsigned int>().swap(indices);
+    vector<VertexSkin>().swap(skin);
+}
 
-    // 设置顶点位置属性指针，告诉OpenGL如何解析顶点数据
-    // 顶点位置属性，配置在0号顶点属性上
-    p_gl_funs->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), nullptr);
-    p_gl_funs->glEnableVertexAttribArray(0);
-    // 顶点法线属性，配置在1号顶点属性上
-    p_gl_funs->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Normal));
-    p_gl_funs->glEnableVertexAttribArray(1);
-    // 顶点纹理坐标属性，配置在2号顶点属性上
-    p_gl_funs->glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, TexCoords));
-    p_gl_funs->glEnableVertexAttribArray(2);
+void Mesh::Setup(const QuantizedVertex *vertex_data, size_t vertex_count, const unsigned int *index_data, size_t index_count, const VertexSkin *skin_data)
+{
+    // 量化顶点原样上传，与所有LOD的索引一起子分配
+    p_pool->Upload(vertex_data, vertex_count, aabb_min, aabb_max - aabb_min, index_data, index_count, skin_data, allocation);
+    if (lods.empty())
+        lods.push_back(MeshLod{0, (uint32_t)index_count, 0.0f});
 
-    // 解绑VAO
-    p_gl_funs->glBindVertexArray(0);
+    // 槽位多于LOD数时重复最粗一级，保证模型按LOD绘制时每个网格都有命令
+    for (uint32_t k = 0; k < draw_slot_count; k++)
+    {
+        const MeshLod &lod = lods[std::min<size_t>(k, lods.size() - 1)];
+        p_pool->SetDraw(first_draw_slot + k * draw_slot_stride, allocation, lod.first_index, lod.index_count);
+    }
+}
+
+void Mesh::Destroy()
+{
+    if (!p_pool)
+        return;
+    for (uint32_t k = 0; k < draw_slot_count; k++)
+        p_pool->ClearDraw(first_draw_slot + k * draw_slot_stride);
+    p_pool->Free(allocation);
+    p_pool = nullptr;
+}
+
+void Mesh::Take(Mesh &other)
+{
+    vertices = std::move(other.vertices);
+    indices = std::move(other.indices);
+    textures = std::move(other.textures);
+    lods = std::move(other.lods);
+    skin = std::move(other.skin);
+    meshlets = std::move(other.meshlets);
+    p_material = std::move(other.p_material);
+    allocation = other.allocation;
+    aabb_min = other.aabb_min;
+    aabb_max = other.aabb_max;
+    first_draw_slot = other.first_draw_slot;
+    draw_slot_stride = other.draw_slot_stride;
+    draw_slot_count = other.draw_slot_count;
+    p_pool = other.p_pool;
+    other.p_pool = nullptr;
 }
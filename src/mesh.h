@@ -19,9 +19,15 @@
 
 #include <QOpenGLShaderProgram>
 #include <QOpenGLFunctions_4_5_Core>
+#include "geometrypool.h"
+#include "vertexformat.h"
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
+class QOpenGLTexture;
+
 using std::string;
 using std::vector;
 
@@ -32,54 +38,175 @@ struct Vertex {
     QVector2D TexCoords;
 };
 
-// 纹理结构体，包括纹理ID、纹理类型和纹理路径
+// 纹理结构体，包括纹理ID、纹理类型和纹理路径，handle持有纹理对象的引用，由ResourceManager发放
 struct Texture {
     unsigned int id;
     string type;
     string path;
+    std::shared_ptr<QOpenGLTexture> handle;
+};
+
+// 一级LOD：索引数组中的一段，所有级别共用网格的顶点，error为模型空间下的最大几何误差
+struct MeshLod {
+    uint32_t first_index;
+    uint32_t index_count;
+    float error;
+};
+
+// 网格簇：原网格（LOD 0）索引中连续的一段三角形，带包围球和法线锥，用于逐簇的视锥剔除和背面剔除
+// cone_cutoff为1时法线锥过宽，不做背面剔除
+struct Meshlet {
+    uint32_t first_index;
+    uint32_t index_count;
+    float center[3];
+    float radius;
+    float cone_axis[3];
+    float cone_cutoff;
 };
 
+// 网格的CPU端数据，由模型导入（Assimp或网格缓存）得到，纹理只记录类型和路径，id在上传时才解析
+// indices依次存放各级LOD的索引，lods为空时整个索引数组即为唯一一级；skin为空表示网格没有骨骼
+// quantized为导入最后一步按包围盒量化的顶点，与vertices一一对应，缓存和上传都直接使用
+struct MeshData {
+    vector<Vertex> vertices;
+    vector<QuantizedVertex> quantized;
+    QVector3D aabb_min, aabb_max;
+    vector<unsigned int> indices;
+    vector<Texture> textures;
+    vector<MeshLod> lods;
+    vector<VertexSkin> skin;
+    vector<Meshlet> meshlets;
+};
+
+class Material;
+
 class Mesh
 {
 public:
-    // 网格数据，包括Vertex、索引以及Texture，眼红vector容器存储
+    // 网格的CPU端数据，包括Vertex、索引以及Texture，用vector容器存储；调用ReleaseCpuData后顶点和索引为空
     vector<Vertex> vertices;
     vector<unsigned int> indices;
     vector<Texture> textures;
+    // 各级LOD在索引数组中的位置，至少一级
+    vector<MeshLod> lods;
+    // 蒙皮数据，与顶点一一对应，无骨骼时为空；随ReleaseCpuData释放
+    vector<VertexSkin> skin;
+    // 原网格的簇划分，逐帧剔除需要，不随ReleaseCpuData释放
+    vector<Meshlet> meshlets;
+    // 由textures构造的材质，模型加载时设置，纹理和参数相同的网格共用
+    std::shared_ptr<Material> p_material;
 
-    // 绘制用到的OpenGL对象
-    unsigned int VAO, VBO, EBO;
+    // 网格在共享几何池中的顶点、索引区间（含顶点位置还原参数），析构时归还
+    GeometryAllocation allocation;
+    // 模型空间包围盒，释放CPU数据后仍然有效
+    QVector3D aabb_min, aabb_max;
+    // 网格占用的绘制槽位：第k个为first_draw_slot + k * draw_slot_stride，绘制第min(k, LOD数 - 1)级
+    uint32_t first_draw_slot;
+    uint32_t draw_slot_stride;
+    uint32_t draw_slot_count;
 
 public:
     /**
-      * @brief  构造函数，初始化网格数据，包括顶点、索引和纹理，以及OpenGL函数指针，用于绘制网格
+      * @brief  构造函数，接管网格数据（顶点、索引、纹理和LOD）并把量化顶点上传到共享几何池，不做任何拷贝
       * @author Xiang Guo
-      * @param  gl_funs: OpenGL函数指针，将初始化好的OpenGL函数指针传入网格对象，用于绘制网格
-      * @param  vertices: 网格顶点数据
-      * @param  indices: 网格索引数据
+      * @param  pool: 共享几何池，生命周期必须长于网格
+      * @param  first_draw_slot: 第一个绘制槽位，由pool->AllocateDraws分配
+      * @param  draw_slot_stride: 相邻LOD槽位的间隔
+      * @param  draw_slot_count: 槽位数量，多于网格LOD数时多出的槽位绘制最粗一级
+      * @param  data: 网格数据，须已量化，构造后被移走
+      * @param  keep_cpu_data: 上传后是否保留CPU端的顶点和索引
+      * @retval none
+      */
+    Mesh(GeometryPool *pool, uint32_t first_draw_slot, uint32_t draw_slot_stride, uint32_t draw_slot_count, MeshData &&data, bool keep_cpu_data = true);
+
+    /**
+      * @brief  构造函数，直接从外部内存（如内存映射的网格缓存）上传量化顶点和索引数据
+      * @author agent
+      * @param  pool: 共享几何池，生命周期必须长于网格
+      * @param  first_draw_slot: 第一个绘制槽位
+      * @param  draw_slot_stride: 相邻LOD槽位的间隔
+      * @param  draw_slot_count: 槽位数量
+      * @param  vertices: 量化顶点首地址
+      * @param  vertex_count: 顶点数量
+      * @param  aabb_min: 量化时的包围盒最小角
+      * @param  aabb_max: 量化时的包围盒最大角
+      * @param  indices: 索引数据首地址
+      * @param  index_count: 索引数量
+      * @param  skin: 蒙皮数据首地址，无骨骼时为nullptr
+      * @param  lods: 各级LOD在索引中的位置，为空时只有一级
+      * @param  meshlets: 原网格的簇划分，可以为空
       * @param  textures: 网格纹理数据
+      * @param  keep_cpu_data: 是否在CPU端保留一份顶点、索引和蒙皮数据的拷贝，顶点由量化数据还原
       * @retval none
       */
-    Mesh(QOpenGLFunctions_4_5_Core *gl_funs, vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures);
+    Mesh(GeometryPool *pool, uint32_t first_draw_slot, uint32_t draw_slot_stride, uint32_t draw_slot_count,
+         const QuantizedVertex *vertices, size_t vertex_count, const QVector3D &aabb_min, const QVector3D &aabb_max,
+         const unsigned int *indices, size_t index_count,
+         const VertexSkin *skin, vector<MeshLod> lods, vector<Meshlet> meshlets, vector<Texture> textures, bool keep_cpu_data = true);
+
+    // 网格独占几何池中的区间，只能移动不能拷贝
+    Mesh(const Mesh &) = delete;
+    Mesh &operator=(const Mesh &) = delete;
+    Mesh(Mesh &&other) noexcept;
+    Mesh &operator=(Mesh &&other) noexcept;
+    ~Mesh();
 
     /**
-      * @brief  绘制网格，使用传入的着色器程序进行绘制，绘制时会绑定网格的纹理，以及设置网格的材质属性，包括漫反射、镜面反射、高光反射和折射率等属性
+      * @brief  单独绘制网格，绑定网格的材质后提交网格指定LOD的绘制槽位
       * @author Xiang Guo
       * @param  shader: 着色器程序，用于绘制网格
+      * @param  lod: LOD级别，0为原网格
       * @retval none
       */
-    void Draw(QOpenGLShaderProgram &shader);
+    void Draw(QOpenGLShaderProgram &shader, uint32_t lod = 0);
 
     /**
-      * @brief  构建绘制网格所需要的OpenGL对象，包括VAO、VBO和EBO，以及绑定顶点属性指针，用于绘制网格
-      * @author Xiang Guo
+      * @brief  设置网格所在节点及其变换，写入网格所有绘制槽位
+      * @author agent
+      * @param  node: 网格所在节点的编号
+      * @param  transform: 节点相对模型的世界变换
+      * @retval none
+      */
+    void SetTransform(uint32_t node, const QMatrix4x4 &transform);
+
+    /**
+      * @brief  释放CPU端的顶点、索引和蒙皮数据（包括容量），GPU端数据不受影响
+      * @author agent
       * @param  none
       * @retval none
       */
-    void Setup(void);
+    void ReleaseCpuData(void);
 
 private:
-    QOpenGLFunctions_4_5_Core *p_gl_funs;
+    /**
+      * @brief  上传到几何池，并为每个槽位写入对应LOD的绘制命令，包围盒须已设置
+      * @author agent
+      * @param  vertex_data: 量化顶点首地址
+      * @param  vertex_count: 顶点数量
+      * @param  index_data: 索引数据首地址
+      * @param  index_count: 索引数量
+      * @param  skin_data: 蒙皮数据首地址，无骨骼时为nullptr
+      * @retval none
+      */
+    void Setup(const QuantizedVertex *vertex_data, size_t vertex_count, const unsigned int *index_data, size_t index_count, const VertexSkin *skin_data);
+
+    /**
+      * @brief  清空绘制槽位并归还几何池中的区间
+      * @author agent
+      * @param  none
+      * @retval none
+      */
+    void Destroy(void);
+
+    /**
+      * @brief  从另一个网格接管数据和区间
+      * @author agent
+      * @param  other: 被移动的网格
+      * @retval none
+      */
+    void Take(Mesh &other);
+
+    GeometryPool *p_pool;
 };
 
 #endif // MESH_H
@@ -0,0 +1,352 @@
+#include "meshcache.h"
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <cstring>
+
+namespace {
+
+const char kMeshCacheMagic[8] = {'P', 'G', 'M', 'E', 'S', 'H', '\0', '\0'};
+
+inline size_t Align4(size_t size)
+{
+    return (size + 3) & ~(size_t)3;
+}
+
+// 写入数据块并补齐到4字节对齐
+void WritePadded(QSaveFile &file, const void *data, size_t size)
+{
+    static const char zeros[4] = {0, 0, 0, 0};
+    file.write(reinterpret_cast<const char *>(data), size);
+    file.write(zeros, Align4(size) - size);
+}
+
+// 从映射内存读取定长记录并前移偏移，越界时返回false
+template <typename T>
+bool ReadRecord(const uchar *mapped, size_t size, size_t &offset, T &record)
+{
+    if (offset + sizeof(T) > size)
+        return false;
+    std::memcpy(&record, mapped + offset, sizeof(T));
+    offset += sizeof(T);
+    return true;
+}
+
+// 从映射内存拷贝count个关键帧
+template <typename Key>
+bool ReadKeys(const uchar *mapped, size_t size, size_t &offset, uint32_t count, vector<Key> &keys)
+{
+    if (offset + (size_t)count * sizeof(Key) > size)
+        return false;
+    const Key *first = reinterpret_cast<const Key *>(mapped + offset);
+    keys.assign(first, first + count);
+    offset += (size_t)count * sizeof(Key);
+    return true;
+}
+
+} // namespace
+
+MeshCache::MeshCache(const string &source_path, uint64_t source_hash, uint32_t import_flags)
+    : import_flags(import_flags), source_hash(source_hash), p_mapped(nullptr)
+{
+    // 缓存文件名包含源文件名、内容哈希和导入标志，不同版本的源文件互不覆盖
+    QString cache_dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/meshcache";
+    QDir().mkpath(cache_dir);
+    cache_path = QString("%1/%2-%3-%4.pgmesh")
+                     .arg(cache_dir)
+                     .arg(QFileInfo(QString::fromStdString(source_path)).fileName())
+                     .arg(QString::number((qulonglong)source_hash, 16))
+                     .arg(QString::number(import_flags, 16));
+}
+
+MeshCache::~MeshCache()
+{
+    if (p_mapped != nullptr)
+        cache_file.unmap(p_mapped);
+}
+
+bool MeshCache::Map(void)
+{
+    cache_file.setFileName(cache_path);
+    if (!cache_file.open(QIODevice::ReadOnly))
+        return false;
+    const size_t size = (size_t)cache_file.size();
+    if (size >= sizeof(MeshCacheHeader))
+        p_mapped = cache_file.map(0, size);
+    if (p_mapped == nullptr)
+    {
+        cache_file.close();
+        return false;
+    }
+    if (!ParseMapped(size))
+    {
+        // 解析失败时释放映射，之后Store才能覆盖该文件
+        views.clear();
+        cache_file.unmap(p_mapped);
+        cache_file.close();
+        p_mapped = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool MeshCache::ParseMapped(size_t size)
+{
+    // 校验文件头，任何不一致都按未命中处理，由调用者重新导入并覆盖缓存
+    const MeshCacheHeader *header = reinterpret_cast<const MeshCacheHeader *>(p_mapped);
+    if (std::memcmp(header->magic, kMeshCacheMagic, sizeof(kMeshCacheMagic)) != 0 ||
+        header->version != kMeshCacheVersion ||
+        header->import_flags != import_flags ||
+        header->source_hash != source_hash)
+    {
+        qDebug() << "MeshCache: stale cache" << cache_path;
+        return false;
+    }
+
+    size_t offset = sizeof(MeshCacheHeader);
+    views.clear();
+    views.reserve(header->mesh_count);
+    for (uint32_t i = 0; i < header->mesh_count; i++)
+    {
+        if (offset + sizeof(MeshCacheEntry) > size)
+            return false;
+        MeshCacheEntry entry;
+        std::memcpy(&entry, p_mapped + offset, sizeof(entry));
+        offset += sizeof(MeshCacheEntry);
+
+        MeshCacheView view;
+        for (uint32_t t = 0; t < entry.texture_count; t++)
+        {
+            uint32_t lengths[2];
+            if (offset + sizeof(lengths) > size)
+                return false;
+            std::memcpy(lengths, p_mapped + offset, sizeof(lengths));
+            offset += sizeof(lengths);
+            if (offset + Align4(lengths[0] + lengths[1]) > size)
+                return false;
+            const char *text = reinterpret_cast<const char *>(p_mapped + offset);
+            Texture texture;
+            texture.id = 0;
+            texture.type.assign(text, lengths[0]);
+            texture.path.assign(text + lengths[0], lengths[1]);
+            view.textures.push_back(texture);
+            offset += Align4(lengths[0] + lengths[1]);
+        }
+
+        size_t vertex_bytes = (size_t)entry.vertex_count * sizeof(QuantizedVertex);
+        size_t index_bytes = (size_t)entry.index_count * sizeof(unsigned int);
+        size_t lod_bytes = (size_t)entry.lod_count * sizeof(MeshLod);
+        size_t skin_bytes = Align4((size_t)entry.skin_count * sizeof(VertexSkin));
+        size_t meshlet_bytes = (size_t)entry.meshlet_count * sizeof(Meshlet);
+        if ((entry.skin_count != 0 && entry.skin_count != entry.vertex_count) ||
+            offset + vertex_bytes + index_bytes + lod_bytes + skin_bytes + meshlet_bytes > size)
+            return false;
+        view.vertices = reinterpret_cast<const QuantizedVertex *>(p_mapped + offset);
+        view.vertex_count = entry.vertex_count;
+        view.aabb_min = QVector3D(entry.aabb_min[0], entry.aabb_min[1], entry.aabb_min[2]);
+        view.aabb_max = QVector3D(entry.aabb_max[0], entry.aabb_max[1], entry.aabb_max[2]);
+        offset += vertex_bytes;
+        view.indices = reinterpret_cast<const unsigned int *>(p_mapped + offset);
+        view.index_count = entry.index_count;
+        offset += index_bytes;
+        const MeshLod *lods = reinterpret_cast<const MeshLod *>(p_mapped + offset);
+        view.lods.assign(lods, lods + entry.lod_count);
+        offset += lod_bytes;
+        view.skin = entry.skin_count != 0 ? reinterpret_cast<const VertexSkin *>(p_mapped + offset) : nullptr;
+        offset += skin_bytes;
+        const Meshlet *meshlets = reinterpret_cast<const Meshlet *>(p_mapped + offset);
+        view.meshlets.assign(meshlets, meshlets + entry.meshlet_count);
+        offset += meshlet_bytes;
+        views.push_back(view);
+    }
+
+    scene_graph = SceneGraph();
+    for (uint32_t i = 0; i < header->node_count; i++)
+    {
+        MeshCacheNode node;
+        if (offset + sizeof(MeshCacheNode) > size)
+            return false;
+        std::memcpy(&node, p_mapped + offset, sizeof(node));
+        offset += sizeof(MeshCacheNode);
+        if (offset + Align4(node.name_length) > size || node.parent >= (int32_t)i ||
+            node.first_mesh + node.mesh_count > header->mesh_count)
+            return false;
+        string name(reinterpret_cast<const char *>(p_mapped + offset), node.name_length);
+        offset += Align4(node.name_length);
+        scene_graph.AddNode(node.parent, QMatrix4x4(node.local).transposed(), name, node.first_mesh, node.mesh_count);
+    }
+
+    bones.clear();
+    for (uint32_t i = 0; i < header->bone_count; i++)
+    {
+        MeshCacheBone bone;
+        if (!ReadRecord(p_mapped, size, offset, bone) || bone.node >= header->node_count ||
+            offset + Align4(bone.name_length) > size)
+            return false;
+        string name(reinterpret_cast<const char *>(p_mapped + offset), bone.name_length);
+        offset += Align4(bone.name_length);
+        bones.push_back(Bone{name, bone.node, QMatrix4x4(bone.offset).transposed()});
+    }
+
+    // 关键帧数组不大，拷贝出来，解除映射后仍然有效
+    animations.clear();
+    for (uint32_t i = 0; i < header->clip_count; i++)
+    {
+        MeshCacheClip entry;
+        if (!ReadRecord(p_mapped, size, offset, entry) || offset + Align4(entry.name_length) > size)
+            return false;
+        AnimationClip clip;
+        clip.name.assign(reinterpret_cast<const char *>(p_mapped + offset), entry.name_length);
+        offset += Align4(entry.name_length);
+        clip.duration = entry.duration;
+        clip.ticks_per_second = entry.ticks_per_second;
+        clip.channels.resize(entry.channel_count);
+        for (AnimationChannel &channel : clip.channels)
+        {
+            MeshCacheChannel record;
+            if (!ReadRecord(p_mapped, size, offset, record) || record.node >= header->node_count ||
+                !ReadKeys(p_mapped, size, offset, record.position_count, channel.positions) ||
+                !ReadKeys(p_mapped, size, offset, record.rotation_count, channel.rotations) ||
+                !ReadKeys(p_mapped, size, offset, record.scaling_count, channel.scalings))
+                return false;
+            channel.node = record.node;
+        }
+        animations.push_back(std::move(clip));
+    }
+    return true;
+}
+
+bool MeshCache::Store(const vector<MeshData> &meshes, const SceneGraph &scene_graph,
+                      const vector<Bone> &bones, const vector<AnimationClip> &animations)
+{
+    // QSaveFile先写临时文件再原子替换，中途失败不会留下损坏的缓存
+    QSaveFile file(cache_path);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qDebug() << "MeshCache: cannot write" << cache_path;
+        return false;
+    }
+
+    MeshCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMeshCacheMagic, sizeof(kMeshCacheMagic));
+    header.version = kMeshCacheVersion;
+    header.import_flags = import_flags;
+    header.source_hash = source_hash;
+    header.mesh_count = (uint32_t)meshes.size();
+    header.node_count = scene_graph.NodeCount();
+    header.bone_count = (uint32_t)bones.size();
+    header.clip_count = (uint32_t)animations.size();
+    WritePadded(file, &header, sizeof(header));
+
+    for (const MeshData &mesh : meshes)
+    {
+        MeshCacheEntry entry;
+        entry.vertex_count = (uint32_t)mesh.quantized.size();
+        entry.index_count = (uint32_t)mesh.indices.size();
+        entry.texture_count = (uint32_t)mesh.textures.size();
+        entry.lod_count = (uint32_t)mesh.lods.size();
+        entry.skin_count = (uint32_t)mesh.skin.size();
+        entry.meshlet_count = (uint32_t)mesh.meshlets.size();
+        for (int k = 0; k < 3; k++)
+        {
+            entry.aabb_min[k] = mesh.aabb_min[k];
+            entry.aabb_max[k] = mesh.aabb_max[k];
+        }
+        WritePadded(file, &entry, sizeof(entry));
+
+        for (const Texture &texture : mesh.textures)
+        {
+            uint32_t lengths[2] = {(uint32_t)texture.type.size(), (uint32_t)texture.path.size()};
+            file.write(reinterpret_cast<const char *>(lengths), sizeof(lengths));
+            string text = texture.type + texture.path;
+            WritePadded(file, text.data(), text.size());
+        }
+
+        WritePadded(file, mesh.quantized.data(), mesh.quantized.size() * sizeof(QuantizedVertex));
+        WritePadded(file, mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+        WritePadded(file, mesh.lods.data(), mesh.lods.size() * sizeof(MeshLod));
+        WritePadded(file, mesh.skin.data(), mesh.skin.size() * sizeof(VertexSkin));
+        WritePadded(file, mesh.meshlets.data(), mesh.meshlets.size() * sizeof(Meshlet));
+    }
+
+    for (uint32_t i = 0; i < scene_graph.NodeCount(); i++)
+    {
+        MeshCacheNode node;
+        node.parent = scene_graph.parents[i];
+        node.first_mesh = scene_graph.first_meshes[i];
+        node.mesh_count = scene_graph.mesh_counts[i];
+        node.name_length = (uint32_t)scene_graph.names[i].size();
+        std::memcpy(node.local, scene_graph.locals[i].constData(), sizeof(node.local));
+        file.write(reinterpret_cast<const char *>(&node), sizeof(node));
+        WritePadded(file, scene_graph.names[i].data(), scene_graph.names[i].size());
+    }
+
+    for (const Bone &bone : bones)
+    {
+        MeshCacheBone record;
+        record.node = bone.node;
+        record.name_length = (uint32_t)bone.name.size();
+        std::memcpy(record.offset, bone.offset.constData(), sizeof(record.offset));
+        file.write(reinterpret_cast<const char *>(&record), sizeof(record));
+        WritePadded(file, bone.name.data(), bone.name.size());
+    }
+
+    for (const AnimationClip &clip : animations)
+    {
+        MeshCacheClip record;
+        record.duration = clip.duration;
+        record.ticks_per_second = clip.ticks_per_second;
+        record.channel_count = (uint32_t)clip.channels.size();
+        record.name_length = (uint32_t)clip.name.size();
+        file.write(reinterpret_cast<const char *>(&record), sizeof(record));
+        WritePadded(file, clip.name.data(), clip.name.size());
+        for (const AnimationChannel &channel : clip.channels)
+        {
+            MeshCacheChannel channel_record;
+            channel_record.node = channel.node;
+            channel_record.position_count = (uint32_t)channel.positions.size();
+            channel_record.rotation_count = (uint32_t)channel.rotations.size();
+            channel_record.scaling_count = (uint32_t)channel.scalings.size();
+            file.write(reinterpret_cast<const char *>(&channel_record), sizeof(channel_record));
+            file.write(reinterpret_cast<const char *>(channel.positions.data()), channel.positions.size() * sizeof(VectorKey));
+            file.write(reinterpret_cast<const char *>(channel.rotations.data()), channel.rotations.size() * sizeof(QuatKey));
+            file.write(reinterpret_cast<const char *>(channel.scalings.data()), channel.scalings.size() * sizeof(VectorKey));
+        }
+    }
+    return file.commit();
+}
+
+uint64_t MeshCache::Hash(const void *data, size_t size, uint64_t seed)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool MeshCache::HashFile(const QString &path, uint64_t &hash)
+{
+    QFile source(path);
+    if (!source.open(QIODevice::ReadOnly))
+        return false;
+    const qint64 size = source.size();
+    uchar *data = source.map(0, size);
+    if (data != nullptr)
+    {
+        hash = Hash(data, (size_t)size);
+        source.unmap(data);
+    }
+    else
+    {
+        QByteArray bytes = source.readAll();
+        hash = Hash(bytes.constData(), (size_t)bytes.size());
+    }
+    return true;
+}
@@ -0,0 +1,184 @@
+/**
+  ******************************************************************************
+  * @file           : meshcache.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了网格缓存类的定义，把模型导入处理后的网格数据（MeshData）保存为带版本号的二进制文件，
+  * 以源文件内容的哈希和导入标志作为键。再次启动时直接内存映射缓存文件，顶点和索引数据不经拷贝即可上传，
+  * 只有缓存未命中时才需要运行Assimp导入器
+  ******************************************************************************
+  * @attention
+  *     缓存文件格式（小端，所有数据块按4字节对齐）：
+  *     MeshCacheHeader | 每个网格：MeshCacheEntry | 纹理类型与路径字符串 | 量化顶点数组 | 索引数组（含各级LOD） | MeshLod数组
+  *     | VertexSkin数组 | Meshlet数组 | 每个场景图节点（先序）：MeshCacheNode | 节点名称 | 每根骨骼：MeshCacheBone | 骨骼名称
+  *     | 每个动画片段：MeshCacheClip | 片段名称 | 每个通道：MeshCacheChannel | 位置、旋转、缩放关键帧数组
+  *     修改QuantizedVertex结构或处理流程时必须增加kMeshCacheVersion，使旧缓存失效
+  ******************************************************************************
+  */
+
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include "animation.h"
+#include "mesh.h"
+#include "scenegraph.h"
+#include <QFile>
+#include <QString>
+#include <cstdint>
+
+// 缓存格式版本号
+const uint32_t kMeshCacheVersion = 7;
+
+// 缓存文件头
+struct MeshCacheHeader {
+    char magic[8];              // "PGMESH\0\0"
+    uint32_t version;           // 缓存格式版本号
+    uint32_t import_flags;      // 导入标志
+    uint64_t source_hash;       // 源文件内容哈希
+    uint32_t mesh_count;        // 网格数量
+    uint32_t node_count;        // 场景图节点数量
+    uint32_t bone_count;        // 骨骼数量
+    uint32_t clip_count;        // 动画片段数量
+};
+
+// 缓存中每个网格的描述
+struct MeshCacheEntry {
+    uint32_t vertex_count;
+    uint32_t index_count;
+    uint32_t texture_count;
+    uint32_t lod_count;
+    uint32_t skin_count;        // 蒙皮数据数量，无骨骼时为0，否则等于vertex_count
+    uint32_t meshlet_count;
+    float aabb_min[3];          // 量化顶点的包围盒
+    float aabb_max[3];
+};
+
+// 缓存中的场景图节点，local为列主序的局部变换
+struct MeshCacheNode {
+    int32_t parent;
+    uint32_t first_mesh;
+    uint32_t mesh_count;
+    uint32_t name_length;
+    float local[16];
+};
+
+// 缓存中的骨骼，offset为列主序的逆绑定矩阵
+struct MeshCacheBone {
+    uint32_t node;
+    uint32_t name_length;
+    float offset[16];
+};
+
+// 缓存中的动画片段
+struct MeshCacheClip {
+    float duration;
+    float ticks_per_second;
+    uint32_t channel_count;
+    uint32_t name_length;
+};
+
+// 缓存中的动画通道
+struct MeshCacheChannel {
+    uint32_t node;
+    uint32_t position_count;
+    uint32_t rotation_count;
+    uint32_t scaling_count;
+};
+
+// 映射后的网格视图，量化顶点和索引直接指向映射内存
+struct MeshCacheView {
+    const QuantizedVertex *vertices;
+    size_t vertex_count;
+    QVector3D aabb_min, aabb_max;
+    const unsigned int *indices;
+    size_t index_count;
+    const VertexSkin *skin;     // 无骨骼时为nullptr
+    vector<Texture> textures;
+    vector<MeshLod> lods;
+    vector<Meshlet> meshlets;
+};
+
+class MeshCache
+{
+public:
+    // 映射成功后的网格视图，映射在MeshCache析构前有效
+    vector<MeshCacheView> views;
+    // 映射成功后的场景图
+    SceneGraph scene_graph;
+    // 映射成功后的骨骼和动画片段
+    vector<Bone> bones;
+    vector<AnimationClip> animations;
+
+public:
+    /**
+      * @brief  构造函数，由源文件内容哈希确定缓存文件路径
+      * @author agent
+      * @param  source_path: 模型源文件路径
+      * @param  source_hash: 源文件内容哈希，即HashFile的结果
+      * @param  import_flags: 导入标志，不同的导入标志对应不同的缓存
+      * @retval none
+      */
+    MeshCache(const string &source_path, uint64_t source_hash, uint32_t import_flags);
+    ~MeshCache();
+
+    MeshCache(const MeshCache &) = delete;
+    MeshCache &operator=(const MeshCache &) = delete;
+
+    /**
+      * @brief  映射缓存文件并校验文件头，成功后填充views
+      * @author agent
+      * @param  none
+      * @retval 缓存是否命中
+      */
+    bool Map(void);
+
+    /**
+      * @brief  将导入处理后的网格数据、场景图、骨骼和动画片段写入缓存文件
+      * @author agent
+      * @param  meshes: 网格数据
+      * @param  scene_graph: 场景图，写入节点的局部变换
+      * @param  bones: 骨骼
+      * @param  animations: 动画片段
+      * @retval 是否写入成功
+      */
+    bool Store(const vector<MeshData> &meshes, const SceneGraph &scene_graph,
+               const vector<Bone> &bones, const vector<AnimationClip> &animations);
+
+    /**
+      * @brief  计算一段数据的64位FNV-1a哈希
+      * @author agent
+      * @param  data: 数据首地址
+      * @param  size: 数据长度
+      * @param  seed: 初始哈希值，可用于串联多段数据
+      * @retval 哈希值
+      */
+    static uint64_t Hash(const void *data, size_t size, uint64_t seed = 14695981039346656037ull);
+
+    /**
+      * @brief  计算文件内容的哈希，内存映射读取，文件可以是磁盘文件或Qt资源
+      * @author agent
+      * @param  path: 文件路径
+      * @param  hash: 输出的哈希值
+      * @retval 文件是否可读
+      */
+    static bool HashFile(const QString &path, uint64_t &hash);
+
+private:
+    uint32_t import_flags;
+    uint64_t source_hash;
+    QString cache_path;
+
+    QFile cache_file;
+    uchar *p_mapped;
+
+    /**
+      * @brief  校验映射内存中的文件头并解析各网格视图
+      * @author agent
+      * @param  size: 映射的字节数
+      * @retval 缓存文件是否有效
+      */
+    bool ParseMapped(size_t size);
+};
+
+#endif // MESHCACHE_H
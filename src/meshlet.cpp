@@ -0,0 +1,153 @@
+#include "meshlet.h"
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// 法线锥与轴的最小夹角余弦不超过该值时认为锥过宽，不做背面剔除
+const float kMeshletMinConeDot = 0.1f;
+
+} // namespace
+
+void MeshletBuilder::Build(vector<MeshData> &meshes)
+{
+    QtConcurrent::blockingMap(meshes, [](MeshData &mesh) {
+        mesh.meshlets.clear();
+        const uint32_t index_count = mesh.lods.empty() ? (uint32_t)mesh.indices.size() : mesh.lods[0].index_count;
+        const uint32_t first_index = mesh.lods.empty() ? 0 : mesh.lods[0].first_index;
+        BuildMeshlets(mesh.vertices, mesh.indices, first_index, index_count, mesh.meshlets);
+    });
+}
+
+void MeshletBuilder::BuildMeshlets(const vector<Vertex> &vertices, const vector<unsigned int> &indices,
+                                   uint32_t first_index, uint32_t index_count, vector<Meshlet> &meshlets)
+{
+    // 顶点缓存优化后相邻三角形共享顶点，按顺序切分即可得到紧凑的簇；stamp记录顶点最后所属的簇
+    vector<uint32_t> stamp(vertices.size(), ~0u);
+    Meshlet current = {first_index, 0, {0.0f, 0.0f, 0.0f}, 0.0f, {0.0f, 0.0f, 0.0f}, 1.0f};
+    uint32_t vertex_count = 0;
+    const uint32_t end = first_index + index_count;
+    for (uint32_t i = first_index; i + 3 <= end; i += 3)
+    {
+        // 退化三角形中重复的顶点会被多算一次，只会让切分更保守
+        uint32_t new_vertices = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            if (stamp[indices[i + k]] != (uint32_t)meshlets.size())
+                new_vertices++;
+        }
+        if (current.index_count > 0 &&
+            (vertex_count + new_vertices > kMeshletMaxVertices || current.index_count / 3 >= kMeshletMaxTriangles))
+        {
+            ComputeBounds(vertices, indices, current);
+            meshlets.push_back(current);
+            current.first_index = i;
+            current.index_count = 0;
+            vertex_count = 0;
+        }
+
+        const uint32_t owner = (uint32_t)meshlets.size();
+        for (int k = 0; k < 3; k++)
+        {
+            if (stamp[indices[i + k]] != owner)
+            {
+                stamp[indices[i + k]] = owner;
+                vertex_count++;
+            }
+        }
+        current.index_count += 3;
+    }
+    if (current.index_count > 0)
+    {
+        ComputeBounds(vertices, indices, current);
+        meshlets.push_back(current);
+    }
+}
+
+void MeshletBuilder::ComputeBounds(const vector<Vertex> &vertices, const vector<unsigned int> &indices, Meshlet &meshlet)
+{
+    const uint32_t end = meshlet.first_index + meshlet.index_count;
+
+    // 包围球：以包围盒中心为球心
+    QVector3D lower = vertices[indices[meshlet.first_index]].Position, upper = lower;
+    for (uint32_t i = meshlet.first_index; i < end; i++)
+    {
+        const QVector3D &p = vertices[indices[i]].Position;
+        lower = QVector3D(std::min(lower.x(), p.x()), std::min(lower.y(), p.y()), std::min(lower.z(), p.z()));
+        upper = QVector3D(std::max(upper.x(), p.x()), std::max(upper.y(), p.y()), std::max(upper.z(), p.z()));
+    }
+    const QVector3D center = (lower + upper) * 0.5f;
+    float radius = 0.0f;
+    for (uint32_t i = meshlet.first_index; i < end; i++)
+        radius = std::max(radius, (vertices[indices[i]].Position - center).length());
+
+    // 法线锥：轴为三角形面法线的平均，半角由与轴夹角最大的面法线决定
+    vector<QVector3D> normals;
+    normals.reserve(meshlet.index_count / 3);
+    QVector3D axis(0.0f, 0.0f, 0.0f);
+    for (uint32_t i = meshlet.first_index; i + 2 < end; i += 3)
+    {
+        const QVector3D &p0 = vertices[indices[i]].Position;
+        QVector3D n = QVector3D::crossProduct(vertices[indices[i + 1]].Position - p0, vertices[indices[i + 2]].Position - p0);
+        if (n.lengthSquared() == 0.0f)
+            continue;
+        n.normalize();
+        normals.push_back(n);
+        axis += n;
+    }
+    float min_dot = 1.0f;
+    if (axis.lengthSquared() > 0.0f)
+    {
+        axis.normalize();
+        for (const QVector3D &n : normals)
+            min_dot = std::min(min_dot, QVector3D::dotProduct(n, axis));
+    }
+    else
+    {
+        min_dot = -1.0f;
+    }
+
+    for (int k = 0; k < 3; k++)
+    {
+        meshlet.center[k] = center[k];
+        meshlet.cone_axis[k] = axis[k];
+    }
+    meshlet.radius = radius;
+    // 法线锥半角为a时，背向相机的视线方向构成半角为90° - a的锥，cutoff取sin(a)
+    meshlet.cone_cutoff = min_dot <= kMeshletMinConeDot ? 1.0f : std::sqrt(1.0f - min_dot * min_dot);
+}
+
+MeshletCuller::MeshletCuller(const QMatrix4x4 &view_projection_local, const QVector3D &camera_local)
+    : camera(camera_local)
+{
+    // Gribb-Hartmann：裁剪空间的六个半空间 w ± x、w ± y、w ± z >= 0
+    const QVector4D row_x = view_projection_local.row(0), row_y = view_projection_local.row(1);
+    const QVector4D row_z = view_projection_local.row(2), row_w = view_projection_local.row(3);
+    planes[0] = row_w + row_x;
+    planes[1] = row_w - row_x;
+    planes[2] = row_w + row_y;
+    planes[3] = row_w - row_y;
+    planes[4] = row_w + row_z;
+    planes[5] = row_w - row_z;
+    for (QVector4D &plane : planes)
+    {
+        const float length = plane.toVector3D().length();
+        if (length > 0.0f)
+            plane /= length;
+    }
+}
+
+bool MeshletCuller::IsVisible(const Meshlet &meshlet) const
+{
+    const QVector3D center(meshlet.center[0], meshlet.center[1], meshlet.center[2]);
+    for (const QVector4D &plane : planes)
+    {
+        if (QVector3D::dotProduct(plane.toVector3D(), center) + plane.w() < -meshlet.radius)
+            return false;
+    }
+    // 从相机到球心的方向落在背向锥内时，簇中所有三角形都背向相机
+    const QVector3D axis(meshlet.cone_axis[0], meshlet.cone_axis[1], meshlet.cone_axis[2]);
+    const QVector3D view = center - camera;
+    return QVector3D::dotProduct(view, axis) < meshlet.cone_cutoff * view.length() + meshlet.radius;
+}
@@ -0,0 +1,89 @@
+/**
+  ******************************************************************************
+  * @file           : meshlet.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了网格簇的生成和剔除。导入时沿顶点缓存优化后的三角形顺序把原网格贪心地切成
+  * 不超过64个顶点、124个三角形的小簇，每个簇是索引中连续的一段，计算包围球和法线锥；
+  * 绘制近处的精细模型时逐帧在CPU上剔除视锥外和整体背向相机的簇，只为可见簇生成间接绘制命令
+  ******************************************************************************
+  * @attention
+  *     簇只在原网格（LOD 0）上生成，远处使用简化的LOD，不需要逐簇剔除；
+  * 剔除在网格所在节点的局部空间中进行，假定节点变换和模型矩阵不含非均匀缩放；蒙皮网格不做逐簇剔除
+  ******************************************************************************
+  */
+
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include "mesh.h"
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <QVector4D>
+
+// 每个簇的顶点和三角形上限
+const uint32_t kMeshletMaxVertices = 64;
+const uint32_t kMeshletMaxTriangles = 124;
+
+class MeshletBuilder
+{
+public:
+    /**
+      * @brief  为所有网格的原网格生成簇，各网格并行处理
+      * @author agent
+      * @param  meshes: 网格数据，须已完成顶点缓存优化，lods[0]为原网格
+      * @retval none
+      */
+    static void Build(vector<MeshData> &meshes);
+
+    /**
+      * @brief  按三角形顺序把索引的一段切成簇，不改变索引
+      * @author agent
+      * @param  vertices: 顶点
+      * @param  indices: 索引
+      * @param  first_index: 起始索引
+      * @param  index_count: 索引数量
+      * @param  meshlets: 输出的簇
+      * @retval none
+      */
+    static void BuildMeshlets(const vector<Vertex> &vertices, const vector<unsigned int> &indices,
+                              uint32_t first_index, uint32_t index_count, vector<Meshlet> &meshlets);
+
+    /**
+      * @brief  计算簇的包围球和法线锥
+      * @author agent
+      * @param  vertices: 顶点
+      * @param  indices: 索引
+      * @param  meshlet: 簇，first_index和index_count已填好
+      * @retval none
+      */
+    static void ComputeBounds(const vector<Vertex> &vertices, const vector<unsigned int> &indices, Meshlet &meshlet);
+};
+
+class MeshletCuller
+{
+public:
+    /**
+      * @brief  构造函数，把视锥平面和相机位置变换到网格的局部空间
+      * @author agent
+      * @param  view_projection_local: 投影 * 观察 * 模型 * 节点变换，网格局部空间到裁剪空间
+      * @param  camera_local: 相机在网格局部空间中的位置
+      * @retval none
+      */
+    MeshletCuller(const QMatrix4x4 &view_projection_local, const QVector3D &camera_local);
+
+    /**
+      * @brief  判断簇是否可能可见：包围球与视锥相交，且法线锥不完全背向相机
+      * @author agent
+      * @param  meshlet: 簇
+      * @retval 是否可见
+      */
+    bool IsVisible(const Meshlet &meshlet) const;
+
+private:
+    QVector4D planes[6];        // 归一化的视锥平面，内侧为正
+    QVector3D camera;
+};
+
+#endif // MESHLET_H
@@ -0,0 +1,436 @@
+#include "meshoptimizer.h"
+#ifdef MESH_OPTIMIZER_REPORT
+#include <QDebug>
+#endif
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+// Forsyth算法评分用的缓存大小及参数，取自原文推荐值
+const int kScoreCacheSize = 32;
+const float kCacheDecayPower = 1.5f;
+const float kLastTriangleScore = 0.75f;
+const float kValenceBoostScale = 2.0f;
+const float kValenceBoostPower = 0.5f;
+
+const uint32_t kInvalid = ~0u;
+
+// 焊接用的顶点键，-0.0与0.0视为相同，无蒙皮时蒙皮部分为0
+struct VertexKey {
+    uint32_t bits[10];
+
+    VertexKey(const Vertex &v, const VertexSkin *skin)
+    {
+        const float values[8] = {v.Position.x() + 0.0f, v.Position.y() + 0.0f, v.Position.z() + 0.0f,
+                                 v.Normal.x() + 0.0f, v.Normal.y() + 0.0f, v.Normal.z() + 0.0f,
+                                 v.TexCoords.x() + 0.0f, v.TexCoords.y() + 0.0f};
+        std::memcpy(bits, values, sizeof(values));
+        bits[8] = bits[9] = 0;
+        if (skin)
+            std::memcpy(bits + 8, skin, sizeof(VertexSkin));
+    }
+    bool operator==(const VertexKey &other) const
+    {
+        return std::memcmp(bits, other.bits, sizeof(bits)) == 0;
+    }
+};
+
+struct VertexKeyHash {
+    size_t operator()(const VertexKey &key) const
+    {
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ull;
+        for (uint32_t b : key.bits)
+        {
+            hash ^= b;
+            hash *= 1099511628211ull;
+        }
+        return (size_t)hash;
+    }
+};
+
+// 固定大小的FIFO顶点缓存：用时间戳判断顶点是否还在缓存中，只有未命中时时间才前进
+class FifoCache
+{
+public:
+    explicit FifoCache(size_t vertex_count)
+        : timestamps(vertex_count, 0), timestamp(kVertexCacheSize + 1) {}
+
+    // 返回三角形的未命中次数
+    unsigned int Triangle(const unsigned int *tri)
+    {
+        unsigned int misses = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            if (timestamp - timestamps[tri[k]] > kVertexCacheSize)
+            {
+                timestamps[tri[k]] = timestamp++;
+                misses++;
+            }
+        }
+        return misses;
+    }
+
+    void Reset(void)
+    {
+        timestamp += kVertexCacheSize + 1;
+    }
+
+private:
+    vector<uint32_t> timestamps;
+    uint32_t timestamp;
+};
+
+float VertexScore(int cache_position, uint32_t live_triangles)
+{
+    // 没有剩余三角形的顶点不再影响评分
+    if (live_triangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cache_position >= 0)
+    {
+        // 刚用过的三个顶点得分固定，避免总是沿着同一条带前进
+        if (cache_position < 3)
+            score = kLastTriangleScore;
+        else
+            score = std::pow(1.0f - (float)(cache_position - 3) / (kScoreCacheSize - 3), kCacheDecayPower);
+    }
+    // 剩余三角形少的顶点优先处理掉，减少以后再回来的代价
+    score += kValenceBoostScale * std::pow((float)live_triangles, -kValenceBoostPower);
+    return score;
+}
+
+} // namespace
+
+void MeshOptimizer::Optimize(vector<MeshData> &meshes)
+{
+#ifdef MESH_OPTIMIZER_REPORT
+    vector<MeshOptimizerStats> before(meshes.size()), after(meshes.size());
+#endif
+    vector<size_t> mesh_indices(meshes.size());
+    for (size_t i = 0; i < meshes.size(); i++)
+        mesh_indices[i] = i;
+    QtConcurrent::blockingMap(mesh_indices, [&](size_t i) {
+        MeshData &mesh = meshes[i];
+#ifdef MESH_OPTIMIZER_REPORT
+        before[i] = Analyze(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+#endif
+        WeldVertices(mesh.vertices, mesh.indices, mesh.skin);
+        OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+        OptimizeOverdraw(mesh.indices, mesh.vertices);
+        OptimizeVertexFetch(mesh.vertices, mesh.indices, mesh.skin);
+#ifdef MESH_OPTIMIZER_REPORT
+        after[i] = Analyze(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+#endif
+    });
+
+#ifdef MESH_OPTIMIZER_REPORT
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        qDebug().nospace() << "MeshOptimizer: mesh " << i << ", " << before[i].triangle_count << " triangles"
+                           << ", vertices " << before[i].vertex_count << " -> " << after[i].vertex_count
+                           << ", ACMR " << before[i].acmr << " -> " << after[i].acmr
+                           << ", ATVR " << before[i].atvr << " -> " << after[i].atvr;
+    }
+#endif
+}
+
+void MeshOptimizer::WeldVertices(vector<Vertex> &vertices, vector<unsigned int> &indices, vector<VertexSkin> &skin)
+{
+    const bool has_skin = !skin.empty();
+    std::unordered_map<VertexKey, uint32_t, VertexKeyHash> unique;
+    unique.reserve(vertices.size());
+    vector<uint32_t> remap(vertices.size());
+    size_t unique_count = 0;
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        auto result = unique.emplace(VertexKey(vertices[i], has_skin ? &skin[i] : nullptr), (uint32_t)unique_count);
+        if (result.second)
+        {
+            if (has_skin)
+                skin[unique_count] = skin[i];
+            vertices[unique_count++] = vertices[i];
+        }
+        remap[i] = result.first->second;
+    }
+    vertices.resize(unique_count);
+    vertices.shrink_to_fit();
+    if (has_skin)
+    {
+        skin.resize(unique_count);
+        skin.shrink_to_fit();
+    }
+    for (unsigned int &index : indices)
+        index = remap[index];
+}
+
+void MeshOptimizer::OptimizeVertexCache(vector<unsigned int> &indices, size_t vertex_count)
+{
+    const size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0)
+        return;
+
+    // 顶点邻接的三角形，前live_triangles[v]个为尚未输出的三角形
+    vector<uint32_t> live_triangles(vertex_count, 0);
+    for (unsigned int index : indices)
+        live_triangles[index]++;
+    vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+    for (size_t v = 0; v < vertex_count; v++)
+        adjacency_offsets[v + 1] = adjacency_offsets[v] + live_triangles[v];
+    vector<uint32_t> adjacency(indices.size());
+    {
+        vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++)
+            adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+    }
+
+    vector<float> vertex_score(vertex_count);
+    for (size_t v = 0; v < vertex_count; v++)
+        vertex_score[v] = VertexScore(-1, live_triangles[v]);
+
+    vector<float> triangle_score(triangle_count);
+    vector<char> emitted(triangle_count, 0);
+    uint32_t best_triangle = kInvalid;
+    float best_score = -1.0f;
+    for (size_t t = 0; t < triangle_count; t++)
+    {
+        triangle_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+        if (triangle_score[t] > best_score)
+        {
+            best_score = triangle_score[t];
+            best_triangle = (uint32_t)t;
+        }
+    }
+
+    vector<unsigned int> output;
+    output.reserve(indices.size());
+    vector<uint32_t> cache, new_cache;
+    cache.reserve(kScoreCacheSize + 3);
+    new_cache.reserve(kScoreCacheSize + 3);
+    size_t cursor = 0;
+
+    while (output.size() < indices.size())
+    {
+        // 缓存中的顶点都没有剩余三角形时，从尚未输出的三角形中按顺序取下一个
+        if (best_triangle == kInvalid)
+        {
+            while (emitted[cursor])
+                cursor++;
+            best_triangle = (uint32_t)cursor;
+        }
+
+        const unsigned int *tri = &indices[best_triangle * 3];
+        emitted[best_triangle] = 1;
+        output.insert(output.end(), tri, tri + 3);
+
+        // 从三个顶点的邻接中移除该三角形
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t v = tri[k];
+            uint32_t *begin = &adjacency[adjacency_offsets[v]];
+            uint32_t *end = begin + live_triangles[v];
+            uint32_t *it = std::find(begin, end, best_triangle);
+            if (it != end)
+            {
+                std::swap(*it, *(end - 1));
+                live_triangles[v]--;
+            }
+        }
+
+        // 新三角形的顶点放到缓存最前面，其余顶点依次后移，超出的移出缓存
+        new_cache.clear();
+        for (int k = 0; k < 3; k++)
+        {
+            if (std::find(new_cache.begin(), new_cache.end(), tri[k]) == new_cache.end())
+                new_cache.push_back(tri[k]);
+        }
+        for (uint32_t v : cache)
+        {
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                new_cache.push_back(v);
+        }
+        if (new_cache.size() > (size_t)kScoreCacheSize)
+        {
+            // 被移出的顶点也要更新评分
+            for (size_t i = kScoreCacheSize; i < new_cache.size(); i++)
+            {
+                uint32_t v = new_cache[i];
+                float score = VertexScore(-1, live_triangles[v]);
+                float delta = score - vertex_score[v];
+                vertex_score[v] = score;
+                for (uint32_t a = 0; a < live_triangles[v]; a++)
+                    triangle_score[adjacency[adjacency_offsets[v] + a]] += delta;
+            }
+            new_cache.resize(kScoreCacheSize);
+        }
+        cache.swap(new_cache);
+
+        // 更新缓存中顶点及其相邻三角形的评分，并在其中选出下一个三角形
+        best_triangle = kInvalid;
+        best_score = -1.0f;
+        for (size_t i = 0; i < cache.size(); i++)
+        {
+            uint32_t v = cache[i];
+            float score = VertexScore((int)i, live_triangles[v]);
+            float delta = score - vertex_score[v];
+            vertex_score[v] = score;
+            for (uint32_t a = 0; a < live_triangles[v]; a++)
+            {
+                uint32_t t = adjacency[adjacency_offsets[v] + a];
+                triangle_score[t] += delta;
+            }
+        }
+        for (uint32_t v : cache)
+        {
+            for (uint32_t a = 0; a < live_triangles[v]; a++)
+            {
+                uint32_t t = adjacency[adjacency_offsets[v] + a];
+                if (triangle_score[t] > best_score)
+                {
+                    best_score = triangle_score[t];
+                    best_triangle = t;
+                }
+            }
+        }
+    }
+    indices.swap(output);
+}
+
+void MeshOptimizer::OptimizeOverdraw(vector<unsigned int> &indices, const vector<Vertex> &vertices, float threshold)
+{
+    const size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0)
+        return;
+
+    // 硬边界：三个顶点都未命中的三角形，说明缓存优化在此处跳到了新的区域
+    vector<uint32_t> hard_boundaries;
+    {
+        FifoCache cache(vertices.size());
+        for (size_t t = 0; t < triangle_count; t++)
+        {
+            if (cache.Triangle(&indices[t * 3]) == 3 || t == 0)
+                hard_boundaries.push_back((uint32_t)t);
+        }
+    }
+    hard_boundaries.push_back((uint32_t)triangle_count);
+
+    // 软边界：在硬簇内部，当簇开头一段的ACMR已不超过整簇ACMR的threshold倍时切开
+    vector<uint32_t> clusters;
+    FifoCache cache(vertices.size());
+    for (size_t c = 0; c + 1 < hard_boundaries.size(); c++)
+    {
+        const uint32_t begin = hard_boundaries[c], end = hard_boundaries[c + 1];
+        cache.Reset();
+        unsigned int cluster_misses = 0;
+        for (uint32_t t = begin; t < end; t++)
+            cluster_misses += cache.Triangle(&indices[t * 3]);
+        const float limit = threshold * cluster_misses / (end - begin);
+
+        cache.Reset();
+        clusters.push_back(begin);
+        unsigned int misses = 0;
+        uint32_t start = begin;
+        for (uint32_t t = begin; t < end; t++)
+        {
+            misses += cache.Triangle(&indices[t * 3]);
+            if (t + 1 < end && (float)misses / (t - start + 1) <= limit)
+            {
+                clusters.push_back(t + 1);
+                cache.Reset();
+                misses = 0;
+                start = t + 1;
+            }
+        }
+    }
+    clusters.push_back((uint32_t)triangle_count);
+
+    // 簇的朝外程度：簇中心相对网格中心沿簇平均法线的距离，朝外的簇先画，遮住后画的簇
+    struct Cluster {
+        uint32_t begin, end;
+        QVector3D centroid, normal;
+        float sort_key;
+    };
+    vector<Cluster> sorted;
+    sorted.reserve(clusters.size() - 1);
+    QVector3D mesh_centroid(0.0f, 0.0f, 0.0f);
+    float mesh_area = 0.0f;
+    for (size_t c = 0; c + 1 < clusters.size(); c++)
+    {
+        Cluster cluster{clusters[c], clusters[c + 1], QVector3D(0.0f, 0.0f, 0.0f), QVector3D(0.0f, 0.0f, 0.0f), 0.0f};
+        float area = 0.0f;
+        for (uint32_t t = cluster.begin; t < cluster.end; t++)
+        {
+            const QVector3D &p0 = vertices[indices[t * 3]].Position;
+            const QVector3D &p1 = vertices[indices[t * 3 + 1]].Position;
+            const QVector3D &p2 = vertices[indices[t * 3 + 2]].Position;
+            QVector3D n = QVector3D::crossProduct(p1 - p0, p2 - p0);
+            float a = n.length();
+            cluster.centroid += (p0 + p1 + p2) * (a / 3.0f);
+            cluster.normal += n;
+            area += a;
+        }
+        mesh_centroid += cluster.centroid;
+        mesh_area += area;
+        cluster.centroid = area > 0.0f ? cluster.centroid / area : vertices[indices[cluster.begin * 3]].Position;
+        cluster.normal.normalize();
+        sorted.push_back(cluster);
+    }
+    if (mesh_area > 0.0f)
+        mesh_centroid /= mesh_area;
+    for (Cluster &cluster : sorted)
+        cluster.sort_key = QVector3D::dotProduct(cluster.centroid - mesh_centroid, cluster.normal);
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster &a, const Cluster &b) {
+        return a.sort_key > b.sort_key;
+    });
+
+    vector<unsigned int> output;
+    output.reserve(indices.size());
+    for (const Cluster &cluster : sorted)
+        output.insert(output.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+    indices.swap(output);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(vector<Vertex> &vertices, vector<unsigned int> &indices, vector<VertexSkin> &skin)
+{
+    const bool has_skin = !skin.empty();
+    vector<uint32_t> remap(vertices.size(), kInvalid);
+    vector<Vertex> reordered;
+    vector<VertexSkin> reordered_skin;
+    reordered.reserve(vertices.size());
+    if (has_skin)
+        reordered_skin.reserve(skin.size());
+    for (unsigned int &index : indices)
+    {
+        if (remap[index] == kInvalid)
+        {
+            remap[index] = (uint32_t)reordered.size();
+            reordered.push_back(vertices[index]);
+            if (has_skin)
+                reordered_skin.push_back(skin[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(reordered);
+    if (has_skin)
+        skin.swap(reordered_skin);
+}
+
+MeshOptimizerStats MeshOptimizer::Analyze(const unsigned int *indices, size_t index_count, size_t vertex_count)
+{
+    MeshOptimizerStats stats;
+    stats.vertex_count = vertex_count;
+    stats.triangle_count = index_count / 3;
+
+    FifoCache cache(vertex_count);
+    size_t transformed = 0;
+    for (size_t t = 0; t < stats.triangle_count; t++)
+        transformed += cache.Triangle(&indices[t * 3]);
+    stats.acmr = stats.triangle_count ? (float)transformed / stats.triangle_count : 0.0f;
+    stats.atvr = vertex_count ? (float)transformed / vertex_count : 0.0f;
+    return stats;
+}
@@ -0,0 +1,99 @@
+/**
+  ******************************************************************************
+  * @file           : meshoptimizer.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了离线网格优化的定义，在导入时依次执行四步：焊接完全相同的顶点、
+  * 为顶点后变换缓存重排三角形（Forsyth算法）、按簇重排三角形以减少过度绘制（Tipsify的
+  * 簇排序）、按首次使用顺序重排顶点以提高顶点读取的局部性
+  ******************************************************************************
+  * @attention
+  *     优化在LOD生成之前进行，结果随网格一起写入网格缓存；ACMR为每个三角形平均变换的
+  * 顶点数，ATVR为每个顶点平均被变换的次数，均由FIFO缓存模拟得到，理想值分别约为0.5和1；
+  * 只有定义MESH_OPTIMIZER_REPORT时才统计并输出优化前后的ACMR和ATVR
+  ******************************************************************************
+  */
+
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include "mesh.h"
+#include <cstddef>
+#include <vector>
+
+// 模拟的顶点后变换缓存大小（FIFO）
+const unsigned int kVertexCacheSize = 16;
+// 过度绘制优化允许ACMR变差的比例
+const float kOverdrawThreshold = 1.05f;
+
+// 网格的顶点缓存统计
+struct MeshOptimizerStats {
+    size_t vertex_count;
+    size_t triangle_count;
+    float acmr;     // average cache miss ratio：变换次数 / 三角形数
+    float atvr;     // average transformed vertex ratio：变换次数 / 顶点数
+};
+
+class MeshOptimizer
+{
+public:
+    /**
+      * @brief  对所有网格执行完整的优化流程，各网格并行处理；定义MESH_OPTIMIZER_REPORT时输出优化前后的统计
+      * @author agent
+      * @param  meshes: 网格数据，lods须为空（优化在LOD生成之前）
+      * @retval none
+      */
+    static void Optimize(vector<MeshData> &meshes);
+
+    /**
+      * @brief  合并位置、法线、纹理坐标和蒙皮数据完全相同的顶点
+      * @author agent
+      * @param  vertices: 顶点，焊接后只保留不重复的顶点
+      * @param  indices: 索引，改为引用焊接后的顶点
+      * @param  skin: 蒙皮数据，与顶点一一对应，可以为空
+      * @retval none
+      */
+    static void WeldVertices(vector<Vertex> &vertices, vector<unsigned int> &indices, vector<VertexSkin> &skin);
+
+    /**
+      * @brief  为顶点后变换缓存重排三角形（Forsyth的线性时间算法）
+      * @author agent
+      * @param  indices: 三角形列表索引，原地重排
+      * @param  vertex_count: 顶点数量
+      * @retval none
+      */
+    static void OptimizeVertexCache(vector<unsigned int> &indices, size_t vertex_count);
+
+    /**
+      * @brief  在已按缓存排序的索引上划分簇，簇按朝外程度从大到小排序，减少过度绘制
+      * @author agent
+      * @param  indices: 已按缓存优化的三角形列表索引，原地重排
+      * @param  vertices: 顶点
+      * @param  threshold: 允许ACMR变差的比例，越大簇越小、过度绘制越少
+      * @retval none
+      */
+    static void OptimizeOverdraw(vector<unsigned int> &indices, const vector<Vertex> &vertices, float threshold = kOverdrawThreshold);
+
+    /**
+      * @brief  按索引中首次出现的顺序重排顶点，丢弃未被引用的顶点
+      * @author agent
+      * @param  vertices: 顶点，原地重排
+      * @param  indices: 索引，改为引用重排后的顶点
+      * @param  skin: 蒙皮数据，随顶点一起重排，可以为空
+      * @retval none
+      */
+    static void OptimizeVertexFetch(vector<Vertex> &vertices, vector<unsigned int> &indices, vector<VertexSkin> &skin);
+
+    /**
+      * @brief  用FIFO缓存模拟统计ACMR和ATVR
+      * @author agent
+      * @param  indices: 三角形列表索引首地址
+      * @param  index_count: 索引数量
+      * @param  vertex_count: 顶点数量
+      * @retval 统计结果
+      */
+    static MeshOptimizerStats Analyze(const unsigned int *indices, size_t index_count, size_t vertex_count);
+};
+
+#endif // MESHOPTIMIZER_H
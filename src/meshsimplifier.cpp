@@ -0,0 +1,358 @@
+#include "meshsimplifier.h"
+#include "meshoptimizer.h"
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// 边界约束平面的权重，保证开放边界在简化后基本保持不动
+const double kBorderWeight = 10.0;
+// 后一级LOD至少要比前一级少这么多三角形才保留
+const float kMinLodReduction = 0.9f;
+// 简化的最大轮数，防止无法继续坍缩时死循环
+const int kMaxPasses = 100;
+
+inline uint64_t EdgeKey(uint32_t a, uint32_t b)
+{
+    return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+struct EdgeCollapse {
+    uint32_t from;
+    uint32_t to;
+    double cost;        // 面积加权的二次误差，用于排序
+    double distance;    // 平均距离误差，用于报告LOD误差
+};
+
+} // namespace
+
+void MeshSimplifier::Quadric::AddPlane(const QVector3D &normal, double distance, double weight)
+{
+    const double nx = normal.x(), ny = normal.y(), nz = normal.z();
+    a00 += weight * nx * nx;
+    a01 += weight * nx * ny;
+    a02 += weight * nx * nz;
+    a11 += weight * ny * ny;
+    a12 += weight * ny * nz;
+    a22 += weight * nz * nz;
+    b0 += weight * nx * distance;
+    b1 += weight * ny * distance;
+    b2 += weight * nz * distance;
+    c += weight * distance * distance;
+    w += weight;
+}
+
+void MeshSimplifier::Quadric::Add(const Quadric &other)
+{
+    a00 += other.a00;
+    a01 += other.a01;
+    a02 += other.a02;
+    a11 += other.a11;
+    a12 += other.a12;
+    a22 += other.a22;
+    b0 += other.b0;
+    b1 += other.b1;
+    b2 += other.b2;
+    c += other.c;
+    w += other.w;
+}
+
+double MeshSimplifier::Quadric::Error(const QVector3D &p) const
+{
+    const double x = p.x(), y = p.y(), z = p.z();
+    double error = a00 * x * x + a11 * y * y + a22 * z * z
+                   + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                   + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+    return std::max(error, 0.0);
+}
+
+MeshSimplifier::MeshSimplifier(const vector<Vertex> &vertices, const vector<unsigned int> &indices)
+    : vertices(vertices), indices(indices)
+{
+    // 位置完全相同的顶点焊接为同一个拓扑顶点
+    const uint32_t vertex_count = (uint32_t)vertices.size();
+    vector<uint32_t> order(vertex_count);
+    for (uint32_t i = 0; i < vertex_count; i++)
+        order[i] = i;
+    auto less = [&vertices](uint32_t a, uint32_t b) {
+        const QVector3D &pa = vertices[a].Position, &pb = vertices[b].Position;
+        if (pa.x() != pb.x())
+            return pa.x() < pb.x();
+        if (pa.y() != pb.y())
+            return pa.y() < pb.y();
+        if (pa.z() != pb.z())
+            return pa.z() < pb.z();
+        return a < b;
+    };
+    std::sort(order.begin(), order.end(), less);
+    position_remap.resize(vertex_count);
+    wedges.resize(vertex_count);
+    for (uint32_t i = 0; i < vertex_count; i++)
+    {
+        uint32_t v = order[i];
+        bool same = i > 0 && vertices[order[i - 1]].Position == vertices[v].Position;
+        position_remap[v] = same ? position_remap[order[i - 1]] : v;
+        wedges[position_remap[v]].push_back(v);
+    }
+
+    // 三角形平面的二次误差按面积加权累加到三个顶点
+    quadrics.assign(vertex_count, Quadric{});
+    locked.assign(vertex_count, 0);
+    struct EdgeRef {
+        uint64_t key;
+        uint32_t triangle;
+    };
+    vector<EdgeRef> edges;
+    edges.reserve(indices.size());
+    for (size_t t = 0; t + 2 < indices.size(); t += 3)
+    {
+        uint32_t c[3] = {position_remap[indices[t]], position_remap[indices[t + 1]], position_remap[indices[t + 2]]};
+        if (c[0] == c[1] || c[1] == c[2] || c[2] == c[0])
+            continue;
+        const QVector3D &p0 = vertices[c[0]].Position;
+        QVector3D normal = QVector3D::crossProduct(vertices[c[1]].Position - p0, vertices[c[2]].Position - p0);
+        float length = normal.length();
+        if (length <= 0.0f)
+            continue;
+        normal /= length;
+        double distance = -QVector3D::dotProduct(normal, p0);
+        for (int k = 0; k < 3; k++)
+        {
+            quadrics[c[k]].AddPlane(normal, distance, 0.5 * length);
+            edges.push_back(EdgeRef{EdgeKey(c[k], c[(k + 1) % 3]), (uint32_t)t});
+        }
+    }
+
+    // 只属于一个三角形的边是边界，加垂直于三角形的约束平面；属于两个以上三角形的边是非流形，锁定端点
+    std::sort(edges.begin(), edges.end(), [](const EdgeRef &a, const EdgeRef &b) { return a.key < b.key; });
+    for (size_t i = 0; i < edges.size();)
+    {
+        size_t j = i;
+        while (j < edges.size() && edges[j].key == edges[i].key)
+            j++;
+        uint32_t a = (uint32_t)(edges[i].key >> 32), b = (uint32_t)edges[i].key;
+        if (j - i == 1)
+        {
+            const EdgeRef &edge = edges[i];
+            uint32_t c[3] = {position_remap[indices[edge.triangle]], position_remap[indices[edge.triangle + 1]], position_remap[indices[edge.triangle + 2]]};
+            const QVector3D &p0 = vertices[c[0]].Position;
+            QVector3D face_normal = QVector3D::crossProduct(vertices[c[1]].Position - p0, vertices[c[2]].Position - p0).normalized();
+            QVector3D direction = vertices[b].Position - vertices[a].Position;
+            QVector3D normal = QVector3D::crossProduct(direction, face_normal).normalized();
+            double distance = -QVector3D::dotProduct(normal, vertices[a].Position);
+            double weight = kBorderWeight * direction.lengthSquared();
+            quadrics[a].AddPlane(normal, distance, weight);
+            quadrics[b].AddPlane(normal, distance, weight);
+        }
+        else if (j - i > 2)
+        {
+            locked[a] = 1;
+            locked[b] = 1;
+        }
+        i = j;
+    }
+}
+
+float MeshSimplifier::Simplify(size_t target_index_count, vector<unsigned int> &out) const
+{
+    const uint32_t vertex_count = (uint32_t)vertices.size();
+    vector<Quadric> q = quadrics;
+    vector<unsigned int> triangles = indices;
+    const vector<uint32_t> &remap = position_remap;     // 拆分顶点 -> 拓扑顶点
+    vector<vector<uint32_t>> live_wedges = wedges;      // 拓扑顶点 -> 当前仍被引用的拆分顶点
+    vector<uint32_t> wedge_target(vertex_count);
+    vector<uint32_t> collapse_remap(vertex_count);
+    vector<char> collapse_locked(vertex_count);
+    vector<uint32_t> adjacency_offsets(vertex_count + 1);
+    vector<uint32_t> adjacency;
+    vector<uint64_t> edge_keys;
+    vector<EdgeCollapse> collapses;
+    double max_error = 0.0;
+
+    for (int pass = 0; pass < kMaxPasses && triangles.size() > target_index_count; pass++)
+    {
+        // 收集当前的唯一边，按两个方向中较小的坍缩代价排序
+        edge_keys.clear();
+        for (size_t t = 0; t < triangles.size(); t += 3)
+        {
+            for (int k = 0; k < 3; k++)
+                edge_keys.push_back(EdgeKey(remap[triangles[t + k]], remap[triangles[t + (k + 1) % 3]]));
+        }
+        std::sort(edge_keys.begin(), edge_keys.end());
+        edge_keys.erase(std::unique(edge_keys.begin(), edge_keys.end()), edge_keys.end());
+
+        collapses.clear();
+        for (uint64_t key : edge_keys)
+        {
+            uint32_t a = (uint32_t)(key >> 32), b = (uint32_t)key;
+            if (a == b)
+                continue;
+            Quadric sum = q[a];
+            sum.Add(q[b]);
+            double cost_ab = locked[a] ? INFINITY : sum.Error(vertices[b].Position);
+            double cost_ba = locked[b] ? INFINITY : sum.Error(vertices[a].Position);
+            if (std::isinf(cost_ab) && std::isinf(cost_ba))
+                continue;
+            double cost = std::min(cost_ab, cost_ba);
+            double distance = sum.w > 0.0 ? std::sqrt(cost / sum.w) : 0.0;
+            collapses.push_back(cost_ab <= cost_ba ? EdgeCollapse{a, b, cost, distance} : EdgeCollapse{b, a, cost, distance});
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const EdgeCollapse &x, const EdgeCollapse &y) { return x.cost < y.cost; });
+
+        // 拓扑顶点的邻接三角形（CSR）
+        std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+        for (unsigned int index : triangles)
+            adjacency_offsets[remap[index] + 1]++;
+        for (uint32_t i = 0; i < vertex_count; i++)
+            adjacency_offsets[i + 1] += adjacency_offsets[i];
+        adjacency.resize(triangles.size());
+        {
+            vector<uint32_t> cursor(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+            for (size_t i = 0; i < triangles.size(); i++)
+                adjacency[cursor[remap[triangles[i]]]++] = (uint32_t)(i / 3 * 3);
+        }
+
+        // 按代价从小到大坍缩，每个顶点每轮最多参与一次，每次坍缩约减少两个三角形
+        for (uint32_t i = 0; i < vertex_count; i++)
+            collapse_remap[i] = i;
+        std::fill(collapse_locked.begin(), collapse_locked.end(), 0);
+        const size_t needed = (triangles.size() - target_index_count) / 6 + 1;
+        size_t performed = 0;
+        for (const EdgeCollapse &collapse : collapses)
+        {
+            if (performed >= needed)
+                break;
+            const uint32_t u = collapse.from, v = collapse.to;
+            if (collapse_locked[u] || collapse_locked[v])
+                continue;
+            if (HasFlips(u, v, triangles, adjacency_offsets, adjacency, collapse_remap))
+                continue;
+
+            // u的拆分顶点映射到v处法线最接近的拆分顶点
+            for (uint32_t w : live_wedges[u])
+            {
+                uint32_t best = live_wedges[v].front();
+                float best_dot = -2.0f;
+                for (uint32_t t : live_wedges[v])
+                {
+                    float dot = QVector3D::dotProduct(vertices[w].Normal, vertices[t].Normal);
+                    if (dot > best_dot)
+                    {
+                        best_dot = dot;
+                        best = t;
+                    }
+                }
+                wedge_target[w] = best;
+            }
+            live_wedges[u].clear();
+            collapse_remap[u] = v;
+            q[v].Add(q[u]);
+            collapse_locked[u] = 1;
+            collapse_locked[v] = 1;
+            max_error = std::max(max_error, collapse.distance);
+            performed++;
+        }
+        if (performed == 0)
+            break;
+
+        // 应用本轮坍缩，去掉退化三角形
+        size_t write = 0;
+        for (size_t t = 0; t < triangles.size(); t += 3)
+        {
+            uint32_t corner[3];
+            for (int k = 0; k < 3; k++)
+            {
+                uint32_t w = triangles[t + k];
+                corner[k] = collapse_remap[remap[w]] != remap[w] ? wedge_target[w] : w;
+            }
+            if (remap[corner[0]] == remap[corner[1]] || remap[corner[1]] == remap[corner[2]] || remap[corner[2]] == remap[corner[0]])
+                continue;
+            for (int k = 0; k < 3; k++)
+                triangles[write++] = corner[k];
+        }
+        triangles.resize(write);
+    }
+
+    out.swap(triangles);
+    return (float)max_error;
+}
+
+bool MeshSimplifier::HasFlips(uint32_t u, uint32_t v, const vector<unsigned int> &triangles,
+                              const vector<uint32_t> &adjacency_offsets, const vector<uint32_t> &adjacency,
+                              const vector<uint32_t> &collapse_remap) const
+{
+    const QVector3D &target = vertices[v].Position;
+    for (uint32_t i = adjacency_offsets[u]; i < adjacency_offsets[u + 1]; i++)
+    {
+        uint32_t t = adjacency[i];
+        uint32_t c[3];
+        for (int k = 0; k < 3; k++)
+            c[k] = collapse_remap[position_remap[triangles[t + k]]];
+        // 本轮已退化或坍缩后退化的三角形不检查
+        if (c[0] == c[1] || c[1] == c[2] || c[2] == c[0] || c[0] == v || c[1] == v || c[2] == v)
+            continue;
+
+        QVector3D p[3], moved[3];
+        for (int k = 0; k < 3; k++)
+        {
+            p[k] = vertices[c[k]].Position;
+            moved[k] = c[k] == u ? target : p[k];
+        }
+        QVector3D before = QVector3D::crossProduct(p[1] - p[0], p[2] - p[0]);
+        QVector3D after = QVector3D::crossProduct(moved[1] - moved[0], moved[2] - moved[0]);
+        if (QVector3D::dotProduct(before, after) <= 0.0f)
+            return true;
+    }
+    return false;
+}
+
+void MeshSimplifier::BuildLodChain(vector<MeshData> &meshes)
+{
+    const size_t level_count = sizeof(kLodRatios) / sizeof(kLodRatios[0]);
+    struct LodJob {
+        const MeshSimplifier *p_simplifier;
+        size_t target_index_count;
+        vector<unsigned int> indices;
+        float error;
+    };
+
+    vector<std::unique_ptr<MeshSimplifier>> simplifiers(meshes.size());
+    vector<size_t> mesh_indices(meshes.size());
+    for (size_t i = 0; i < meshes.size(); i++)
+        mesh_indices[i] = i;
+    QtConcurrent::blockingMap(mesh_indices, [&](size_t i) {
+        simplifiers[i].reset(new MeshSimplifier(meshes[i].vertices, meshes[i].indices));
+    });
+
+    // 每个网格的每一级都是独立任务，均从原网格简化，互不依赖
+    vector<LodJob> jobs;
+    jobs.reserve(meshes.size() * level_count);
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        size_t triangle_count = meshes[i].indices.size() / 3;
+        for (size_t level = 0; level < level_count; level++)
+            jobs.push_back(LodJob{simplifiers[i].get(), (size_t)(triangle_count * kLodRatios[level]) * 3, {}, 0.0f});
+    }
+    QtConcurrent::blockingMap(jobs, [](LodJob &job) {
+        job.error = job.p_simplifier->Simplify(job.target_index_count, job.indices);
+        // 简化打乱了三角形顺序，每级单独按顶点缓存重排
+        MeshOptimizer::OptimizeVertexCache(job.indices, job.p_simplifier->vertices.size());
+    });
+
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        MeshData &mesh = meshes[i];
+        mesh.lods.clear();
+        mesh.lods.push_back(MeshLod{0, (uint32_t)mesh.indices.size(), 0.0f});
+        for (size_t level = 0; level < level_count; level++)
+        {
+            LodJob &job = jobs[i * level_count + level];
+            const MeshLod &previous = mesh.lods.back();
+            if (job.indices.empty() || job.indices.size() > previous.index_count * kMinLodReduction)
+                continue;
+            mesh.lods.push_back(MeshLod{(uint32_t)mesh.indices.size(), (uint32_t)job.indices.size(), std::max(job.error, previous.error)});
+            mesh.indices.insert(mesh.indices.end(), job.indices.begin(), job.indices.end());
+        }
+    }
+}
@@ -0,0 +1,93 @@
+/**
+  ******************************************************************************
+  * @file           : meshsimplifier.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了网格简化类的定义，用二次误差度量（QEM）的边坍缩生成多级LOD。
+  * 顶点只坍缩到已有顶点上，因此所有LOD共用原网格的顶点缓冲，每级LOD只是索引数组中的一段。
+  * 位置相同的顶点（法线折痕、纹理接缝处被拆开的顶点）按同一个拓扑顶点处理，
+  * 坍缩时各个拆分顶点映射到目标处法线最接近的拆分顶点
+  ******************************************************************************
+  * @attention
+  *     简化在导入时进行，结果随网格一起写入网格缓存；同一网格的各级LOD并行生成
+  ******************************************************************************
+  */
+
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include "mesh.h"
+#include <cstdint>
+#include <vector>
+
+// LOD链各级的目标三角形比例（相对原网格）
+const float kLodRatios[] = {0.5f, 0.25f, 0.1f, 0.05f};
+
+class MeshSimplifier
+{
+public:
+    /**
+      * @brief  构造函数，焊接位置相同的顶点，计算各顶点的初始二次误差矩阵
+      * @author agent
+      * @param  vertices: 网格顶点
+      * @param  indices: 网格索引（三角形列表）
+      * @retval none
+      */
+    MeshSimplifier(const vector<Vertex> &vertices, const vector<unsigned int> &indices);
+
+    /**
+      * @brief  简化网格，可在多个线程中对同一个简化器并发调用
+      * @author agent
+      * @param  target_index_count: 目标索引数量
+      * @param  out: 输出的简化后索引，引用原网格的顶点
+      * @retval 模型空间下的最大几何误差
+      */
+    float Simplify(size_t target_index_count, vector<unsigned int> &out) const;
+
+    /**
+      * @brief  为所有网格生成LOD链，追加到各网格的索引数组之后并填写lods，所有网格的所有级别并行简化
+      * @author agent
+      * @param  meshes: 网格数据
+      * @retval none
+      */
+    static void BuildLodChain(vector<MeshData> &meshes);
+
+private:
+    // 对称4x4矩阵形式的二次误差：Q(p) = p'Ap + 2b'p + c，w为累计权重，Q(p)/w为加权平均的平方距离
+    struct Quadric {
+        double a00, a01, a02, a11, a12, a22;
+        double b0, b1, b2;
+        double c;
+        double w;
+
+        void AddPlane(const QVector3D &normal, double distance, double weight);
+        void Add(const Quadric &other);
+        double Error(const QVector3D &p) const;
+    };
+
+    /**
+      * @brief  检查把拓扑顶点u坍缩到v时，u周围是否有三角形翻转
+      * @author agent
+      * @param  u: 被移除的拓扑顶点
+      * @param  v: 保留的拓扑顶点
+      * @param  triangles: 当前三角形（拆分顶点索引）
+      * @param  adjacency_offsets: 拓扑顶点邻接三角形的起始位置
+      * @param  adjacency: 拓扑顶点邻接的三角形
+      * @param  collapse_remap: 本轮已坍缩的拓扑顶点映射
+      * @retval 是否翻转
+      */
+    bool HasFlips(uint32_t u, uint32_t v, const vector<unsigned int> &triangles,
+                  const vector<uint32_t> &adjacency_offsets, const vector<uint32_t> &adjacency,
+                  const vector<uint32_t> &collapse_remap) const;
+
+    const vector<Vertex> &vertices;
+    const vector<unsigned int> &indices;
+
+    vector<uint32_t> position_remap;        // 顶点 -> 拓扑顶点（位置相同的第一个顶点）
+    vector<vector<uint32_t>> wedges;        // 拓扑顶点 -> 其所有拆分顶点
+    vector<Quadric> quadrics;               // 拓扑顶点的初始二次误差
+    vector<char> locked;                    // 非流形顶点不参与坍缩
+};
+
+#endif // MESHSIMPLIFIER_H
@@ -1,49 +1,347 @@
 #include "model.h"
+#include "meshcache.h"
+#include "meshlet.h"
+#include "meshoptimizer.h"
+#include "meshsimplifier.h"
+#include "resourceiosystem.h"
+#include "resourcemanager.h"
+#include "stlloader.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <assimp/ProgressHandler.hpp>
 
-Model::Model(QOpenGLFunctions_4_5_Core *glfuns, const char *path) : p_gl_funs(glfuns)
+namespace {
+
+// 导入各阶段结束时的进度：读取（Assimp读取与后处理，或STL解析）、网格处理、网格优化、LOD和簇生成，最后写缓存
+const float kImportProgressRead = 0.5f;
+const float kImportProgressProcessed = 0.6f;
+const float kImportProgressOptimized = 0.7f;
+const float kImportProgressSimplified = 0.95f;
+
+// 把Assimp读取和后处理的进度（0~1）映射到导入进度的读取阶段，回调要求中止时让导入器停止
+class ImportProgressHandler : public Assimp::ProgressHandler
+{
+public:
+    explicit ImportProgressHandler(const ModelImportProgress &progress) : progress(progress), cancelled(false) {}
+
+    bool Update(float percentage) override
+    {
+        if (progress && !cancelled)
+            cancelled = !progress(std::min(std::max(percentage, 0.0f), 1.0f) * kImportProgressRead);
+        return !cancelled;
+    }
+
+    ModelImportProgress progress;
+    bool cancelled;
+};
+
+// 同步构造时在当前线程导入
+ModelData ImportBlocking(const string &path)
 {
-    LoadModel(path);
+    ModelData data;
+    Model::Import(path, data);
+    return data;
 }
 
-void Model::Draw(QOpenGLShaderProgram &shader)
+} // namespace
+
+Model::Model(QOpenGLFunctions_4_5_Core *glfuns, const char *path, bool keep_cpu_data)
+    : Model(glfuns, ImportBlocking(path), keep_cpu_data)
 {
-    for (unsigned int i = 0; i < meshes.size(); i++)
-        meshes[i].Draw(shader);
 }
 
-void Model::LoadModel(string path)
+Model::Model(QOpenGLFunctions_4_5_Core *glfuns, ModelData &&data, bool keep_cpu_data)
+    : p_gl_funs(glfuns), keep_cpu_data(keep_cpu_data), first_draw_slot(0), lod_count(1), culled_command_capacity(0)
+{
+    p_geometry_pool = ResourceManager::Instance().AcquireGeometryPool(glfuns);
+    Upload(data);
+    BuildMaterials();
+    BuildBatches();
+    for (const Mesh &mesh : meshes)
+        culled_command_capacity += std::max((uint32_t)mesh.meshlets.size(), 1u);
+    UpdateTransforms();
+    ComputeBounds();
+}
+
+Model::~Model()
+{
+    uint32_t mesh_count = (uint32_t)meshes.size();
+    meshes.clear();
+    p_geometry_pool->FreeDraws(first_draw_slot, mesh_count * lod_count);
+}
+
+void Model::Draw(QOpenGLShaderProgram &shader, uint32_t lod, uint32_t instance_count)
+{
+    UpdateTransforms();
+    const uint32_t lod_first = first_draw_slot + std::min(lod, lod_count - 1) * (uint32_t)meshes.size();
+    for (const DrawBatch &batch : batches)
+    {
+        meshes[batch.first_mesh].p_material->Bind();
+        p_geometry_pool->Draw(shader, lod_first + batch.first_mesh, batch.mesh_count, instance_count);
+    }
+}
+
+void Model::DrawCulled(QOpenGLShaderProgram &shader, const QMatrix4x4 &model_matrix, const QMatrix4x4 &view_projection,
+                       const QVector3D &camera_position, const vector<QMatrix4x4> *p_node_worlds)
+{
+    UpdateTransforms();
+    const StreamAllocation commands = p_geometry_pool->AllocateCommands(culled_command_capacity);
+    DrawElementsIndirectCommand *p_commands = reinterpret_cast<DrawElementsIndirectCommand *>(commands.p_data);
+    uint32_t command_count = 0;
+    culled_offsets.assign(meshes.size() + 1, 0);
+
+    // 网格按节点先序编号，逐节点把视锥和相机变换到局部空间后剔除该节点上的网格
+    for (uint32_t node = 0; node < scene_graph.NodeCount(); node++)
+    {
+        const uint32_t first_mesh = scene_graph.first_meshes[node];
+        const uint32_t mesh_end = first_mesh + scene_graph.mesh_counts[node];
+        if (first_mesh == mesh_end)
+            continue;
+        const QMatrix4x4 local_to_world = model_matrix * (p_node_worlds ? (*p_node_worlds)[node] : scene_graph.worlds[node]);
+        const MeshletCuller culler(view_projection * local_to_world, local_to_world.inverted().map(camera_position));
+        for (uint32_t i = first_mesh; i < mesh_end; i++)
+        {
+            culled_offsets[i] = command_count;
+            const Mesh &mesh = meshes[i];
+            const uint32_t slot = first_draw_slot + i;
+            const GeometryAllocation &allocation = mesh.allocation;
+            // 蒙皮网格的顶点随骨骼移动，簇的包围球和法线锥不再有效
+            if (mesh.meshlets.empty() || allocation.skinned)
+            {
+                p_commands[command_count++] = DrawElementsIndirectCommand{mesh.lods[0].index_count, 1, allocation.first_index + mesh.lods[0].first_index,
+                                                                          (int32_t)allocation.base_vertex, slot};
+                continue;
+            }
+            // 相邻的可见簇在索引中连续，合并为一条命令；命令空间只写不读，正在合并的命令留在本地
+            DrawElementsIndirectCommand pending{0, 1, 0, (int32_t)allocation.base_vertex, slot};
+            for (const Meshlet &meshlet : mesh.meshlets)
+            {
+                if (!culler.IsVisible(meshlet))
+                    continue;
+                const uint32_t first_index = allocation.first_index + meshlet.first_index;
+                if (pending.count != 0 && pending.first_index + pending.count == first_index)
+                {
+                    pending.count += meshlet.index_count;
+                    continue;
+                }
+                if (pending.count != 0)
+                    p_commands[command_count++] = pending;
+                pending.count = meshlet.index_count;
+                pending.first_index = first_index;
+            }
+            if (pending.count != 0)
+                p_commands[command_count++] = pending;
+        }
+    }
+    culled_offsets[meshes.size()] = command_count;
+
+    for (const DrawBatch &batch : batches)
+    {
+        const uint32_t begin = culled_offsets[batch.first_mesh];
+        const uint32_t end = culled_offsets[batch.first_mesh + batch.mesh_count];
+        if (begin == end)
+            continue;
+        meshes[batch.first_mesh].p_material->Bind();
+        p_geometry_pool->DrawCommands(shader, commands, begin, end - begin);
+    }
+}
+
+uint32_t Model::SelectLod(float pixels_per_unit, float max_pixel_error) const
+{
+    uint32_t lod = 0;
+    while (lod + 1 < lod_count && lod_errors[lod + 1] * pixels_per_unit <= max_pixel_error)
+        lod++;
+    return lod;
+}
+
+int32_t Model::FindNode(const string &name) const
+{
+    return scene_graph.Find(name);
+}
+
+void Model::SetNodeTransform(uint32_t node, const QMatrix4x4 &local)
+{
+    scene_graph.SetLocal(node, local);
+}
+
+void Model::UpdateTransforms()
+{
+    if (!scene_graph.IsDirty())
+        return;
+    // 只有变化子树上的网格需要重写槽位
+    for (const SceneNodeRange &range : scene_graph.Update())
+    {
+        for (uint32_t node = range.begin; node < range.end; node++)
+        {
+            const uint32_t first_mesh = scene_graph.first_meshes[node];
+            for (uint32_t i = first_mesh; i < first_mesh + scene_graph.mesh_counts[node]; i++)
+                meshes[i].SetTransform(node, scene_graph.worlds[node]);
+        }
+    }
+}
+
+bool Model::Import(const string &path, ModelData &data, const ModelImportProgress &progress)
+{
+    auto report = [&progress](float fraction) { return !progress || progress(fraction); };
+    data.path = path;
+
+    // 先尝试网格缓存，命中时网格数据留在映射内存中，上传时不经拷贝；源文件不可读时不使用缓存，导入随后失败
+    const bool is_stl = StlLoader::IsStlFile(path);
+    if (!data.source_hashed)
+        data.source_hashed = MeshCache::HashFile(QString::fromStdString(path), data.source_hash);
+    std::unique_ptr<MeshCache> p_cache;
+    if (data.source_hashed)
+        p_cache.reset(new MeshCache(path, data.source_hash, is_stl ? kStlImportFlags : kModelImportFlags));
+    if (p_cache && p_cache->Map())
+    {
+        data.scene_graph = std::move(p_cache->scene_graph);
+        data.bones = std::move(p_cache->bones);
+        data.animations = std::move(p_cache->animations);
+        data.p_cache = std::move(p_cache);
+        return report(1.0f);
+    }
+
+    // STL使用原生加载器，其余格式由Assimp导入；原生加载器解析失败的STL（如不规范的文件）仍交给Assimp
+    bool native_loaded = false;
+    if (is_stl)
+    {
+        data.meshes.emplace_back();
+        native_loaded = StlLoader().Load(path, data.meshes.back());
+        if (native_loaded)
+        {
+            // STL没有层次结构，整个网格挂在单个根节点上
+            data.scene_graph.AddNode(SceneGraph::kNoParent, QMatrix4x4(), "root", 0, 1);
+            if (!report(kImportProgressRead))
+                return false;
+        }
+        else
+        {
+            qDebug() << "Model: native STL loading failed, falling back to Assimp" << QString::fromStdString(path);
+            data.meshes.clear();
+        }
+    }
+    if (!native_loaded)
+    {
+        // 通过ResourceIOSystem读取，模型及其引用的文件可以位于Qt资源或挂载的资源包中；导入器接管IO和进度处理器
+        Assimp::Importer import;
+        import.SetIOHandler(new ResourceIOSystem);
+        ImportProgressHandler *p_handler = new ImportProgressHandler(progress);
+        import.SetProgressHandler(p_handler);
+        const aiScene *scene = import.ReadFile(path, kModelImportFlags);
+        if (p_handler->cancelled)
+            return false;
+        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+        {
+            qDebug() << "ERROR::ASSIMP::" << import.GetErrorString();
+            return false;
+        }
+        data.meshes.reserve(scene->mNumMeshes);
+        ProcessNode(scene->mRootNode, scene, data, SceneGraph::kNoParent);
+
+        // 骨骼在所有节点记录完之后才能按名称找到对应节点
+        for (Bone &bone : data.bones)
+        {
+            int32_t node = data.scene_graph.Find(bone.name);
+            if (node == SceneGraph::kNoParent)
+                qDebug() << "Model: bone without node" << QString::fromStdString(bone.name);
+            bone.node = node == SceneGraph::kNoParent ? 0 : (uint32_t)node;
+        }
+        data.bone_lookup.clear();
+        ProcessAnimations(scene, data);
+    }
+    if (!report(kImportProgressProcessed))
+        return false;
+
+    // 网格优化和LOD链都在导入时进行，结果随网格一起缓存；先优化，LOD沿用优化后的顶点顺序
+    MeshOptimizer::Optimize(data.meshes);
+    if (!report(kImportProgressOptimized))
+        return false;
+    MeshSimplifier::BuildLodChain(data.meshes);
+    MeshletBuilder::Build(data.meshes);
+    // 最后按包围盒量化顶点，缓存和上传都直接使用量化结果，上传时不再转换
+    for (MeshData &mesh : data.meshes)
+    {
+        ComputeAabb(mesh.vertices.data(), mesh.vertices.size(), mesh.aabb_min, mesh.aabb_max);
+        QuantizeVertices(mesh.vertices.data(), mesh.vertices.size(), mesh.aabb_min, mesh.aabb_max, mesh.quantized);
+    }
+    if (!report(kImportProgressSimplified))
+        return false;
+    if (p_cache)
+        p_cache->Store(data.meshes, data.scene_graph, data.bones, data.animations);
+    return report(1.0f);
+}
+
+void Model::Upload(ModelData &data)
 {
-    Assimp::Importer import;
-    const aiScene *scene = import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+    directory = data.path.substr(0, data.path.find_last_of('/'));
+    scene_graph = std::move(data.scene_graph);
+    bones = std::move(data.bones);
+    animations = std::move(data.animations);
+
+    if (data.p_cache)
     {
-        qDebug() << "ERROR::ASSIMP::" << import.GetErrorString();
+        // 缓存命中：直接从映射内存上传
+        vector<MeshCacheView> &views = data.p_cache->views;
+        meshes.reserve(views.size());
+        uint32_t max_lod_count = 1;
+        for (const MeshCacheView &view : views)
+            max_lod_count = std::max(max_lod_count, (uint32_t)view.lods.size());
+        AllocateDraws((uint32_t)views.size(), max_lod_count);
+        for (MeshCacheView &view : views)
+        {
+            ResolveTextures(view.textures);
+            meshes.emplace_back(p_geometry_pool.get(), first_draw_slot + (uint32_t)meshes.size(), (uint32_t)views.size(), lod_count,
+                                view.vertices, view.vertex_count, view.aabb_min, view.aabb_max, view.indices, view.index_count,
+                                view.skin, std::move(view.lods), std::move(view.meshlets), std::move(view.textures), keep_cpu_data);
+        }
+        data.p_cache.reset();
         return;
     }
-    directory = path.substr(0, path.find_last_of('/'));
-    ProcessNode(scene->mRootNode, scene);
+
+    // 网格数据在缓存写入后直接移交给Mesh，不再拷贝
+    vector<MeshData> &mesh_data = data.meshes;
+    meshes.reserve(mesh_data.size());
+    uint32_t max_lod_count = 1;
+    for (const MeshData &mesh : mesh_data)
+        max_lod_count = std::max(max_lod_count, (uint32_t)mesh.lods.size());
+    AllocateDraws((uint32_t)mesh_data.size(), max_lod_count);
+    for (MeshData &mesh : mesh_data)
+    {
+        ResolveTextures(mesh.textures);
+        meshes.emplace_back(p_geometry_pool.get(), first_draw_slot + (uint32_t)meshes.size(), (uint32_t)mesh_data.size(), lod_count,
+                            std::move(mesh), keep_cpu_data);
+    }
+    mesh_data.clear();
 }
 
-void Model::ProcessNode(aiNode *node, const aiScene *scene)
+void Model::ProcessNode(aiNode *node, const aiScene *scene, ModelData &data, int32_t parent)
 {
+    // 先序记录节点，aiMatrix4x4按行主序存放，与QMatrix4x4的构造参数一致
+    const uint32_t index = data.scene_graph.AddNode(parent, QMatrix4x4(&node->mTransformation.a1), node->mName.C_Str(),
+                                                    (uint32_t)data.meshes.size(), node->mNumMeshes);
     // process all the node's meshes (if any)
     for (unsigned int i = 0; i < node->mNumMeshes; i++)
     {
         aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(ProcessMesh(mesh, scene));
+        data.meshes.emplace_back(ProcessMesh(mesh, scene, data));
     }
     // then do the same for each of its children
     for (unsigned int i = 0; i < node->mNumChildren; i++)
     {
-        ProcessNode(node->mChildren[i], scene);
+        ProcessNode(node->mChildren[i], scene, data, (int32_t)index);
     }
 }
 
-Mesh Model::ProcessMesh(aiMesh *mesh, const aiScene *scene)
+MeshData Model::ProcessMesh(aiMesh *mesh, const aiScene *scene, ModelData &data)
 {
-    vector<Vertex> vertices;
-    vector<unsigned int> indices;
-    vector<Texture> textures;
+    MeshData mesh_data;
+    vector<Vertex> &vertices = mesh_data.vertices;
+    vector<unsigned int> &indices = mesh_data.indices;
+    vector<Texture> &textures = mesh_data.textures;
+    // 按已知数量预留空间，一次遍历填满，不触发扩容
+    vertices.reserve(mesh->mNumVertices);
+    indices.reserve(mesh->mNumFaces * 3);
     for (unsigned int i = 0; i < mesh->mNumVertices; i++)
     {
         Vertex vertex;
@@ -74,11 +372,15 @@ Mesh Model::ProcessMesh(aiMesh *mesh, const aiScene *scene)
     // 处理索引
     for (unsigned int i = 0; i < mesh->mNumFaces; i++)
     {
-        aiFace face = mesh->mFaces[i];
+        const aiFace &face = mesh->mFaces[i];
         for (unsigned int j = 0; j < face.mNumIndices; j++)
             indices.push_back(face.mIndices[j]);
     }
 
+    // 处理骨骼权重
+    if (mesh->HasBones())
+        ProcessSkin(mesh, data, mesh_data.skin);
+
     // 处理材质
     if (mesh->mMaterialIndex >= 0)
     {
@@ -90,49 +392,215 @@ Mesh Model::ProcessMesh(aiMesh *mesh, const aiScene *scene)
             LoadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
         textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
     }
-    return Mesh(p_gl_funs, vertices, indices, textures);
+    return mesh_data;
 }
 
-vector<Texture> Model::LoadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+void Model::ProcessSkin(aiMesh *mesh, ModelData &data, vector<VertexSkin> &skin)
 {
-    vector<Texture> textures;
-    for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+    // 每个顶点保留权重最大的4根骨骼
+    struct Influence {
+        uint32_t bone;
+        float weight;
+    };
+    vector<std::array<Influence, 4>> influences(mesh->mNumVertices);
+    for (auto &strongest : influences)
+        strongest.fill(Influence{0, 0.0f});
+
+    for (unsigned int b = 0; b < mesh->mNumBones; b++)
     {
-        aiString str;
-        mat->GetTexture(type, i, &str);
-        bool skip = false;
-        for (unsigned int j = 0; j < textures.size(); j++)
+        const aiBone *ai_bone = mesh->mBones[b];
+        const string name = ai_bone->mName.C_Str();
+        auto it = data.bone_lookup.find(name);
+        if (it == data.bone_lookup.end())
         {
-            if (std::strcmp(textures[j].path.data(), str.C_Str()) == 0)
+            // 蒙皮数据中的骨骼编号为8位
+            if (data.bones.size() >= 256)
             {
-                textures.push_back(textures[j]);
-                skip = true;
-                break;
+                qDebug() << "Model: more than 256 bones, ignoring" << QString::fromStdString(name);
+                continue;
             }
+            it = data.bone_lookup.emplace(name, (uint32_t)data.bones.size()).first;
+            data.bones.push_back(Bone{name, 0, QMatrix4x4(&ai_bone->mOffsetMatrix.a1)});
         }
-        if (!skip)
+        for (unsigned int w = 0; w < ai_bone->mNumWeights; w++)
         {
-            Texture texture;
-            texture.id = TextureFromFile(str.C_Str(), directory);
-            texture.type = typeName;
-            texture.path = str.C_Str();
-            textures.push_back(texture);
-            textures.push_back(texture);
+            const aiVertexWeight &weight = ai_bone->mWeights[w];
+            auto &strongest = influences[weight.mVertexId];
+            auto smallest = std::min_element(strongest.begin(), strongest.end(), [](const Influence &a, const Influence &b) {
+                return a.weight < b.weight;
+            });
+            if (weight.mWeight > smallest->weight)
+                *smallest = Influence{it->second, weight.mWeight};
         }
     }
+
+    // 权重归一化后量化为8位，舍入误差补到最大的权重上，保证和为255
+    skin.resize(mesh->mNumVertices);
+    for (unsigned int v = 0; v < mesh->mNumVertices; v++)
+    {
+        const auto &strongest = influences[v];
+        float total = 0.0f;
+        for (const Influence &influence : strongest)
+            total += influence.weight;
+        VertexSkin &out = skin[v];
+        int sum = 0, largest = 0;
+        for (int k = 0; k < 4; k++)
+        {
+            out.joints[k] = (uint8_t)strongest[k].bone;
+            out.weights[k] = total > 0.0f ? (uint8_t)std::lround(strongest[k].weight / total * 255.0f) : 0;
+            sum += out.weights[k];
+            if (out.weights[k] > out.weights[largest])
+                largest = k;
+        }
+        if (total > 0.0f)
+            out.weights[largest] = (uint8_t)(out.weights[largest] + 255 - sum);
+    }
+}
+
+void Model::ProcessAnimations(const aiScene *scene, ModelData &data)
+{
+    for (unsigned int a = 0; a < scene->mNumAnimations; a++)
+    {
+        const aiAnimation *ai_animation = scene->mAnimations[a];
+        AnimationClip clip;
+        clip.name = ai_animation->mName.C_Str();
+        clip.duration = (float)ai_animation->mDuration;
+        clip.ticks_per_second = (float)ai_animation->mTicksPerSecond;
+        for (unsigned int c = 0; c < ai_animation->mNumChannels; c++)
+        {
+            const aiNodeAnim *ai_channel = ai_animation->mChannels[c];
+            int32_t node = data.scene_graph.Find(ai_channel->mNodeName.C_Str());
+            if (node == SceneGraph::kNoParent)
+                continue;
+            AnimationChannel channel;
+            channel.node = (uint32_t)node;
+            channel.positions.reserve(ai_channel->mNumPositionKeys);
+            for (unsigned int k = 0; k < ai_channel->mNumPositionKeys; k++)
+            {
+                const aiVectorKey &key = ai_channel->mPositionKeys[k];
+                channel.positions.push_back(VectorKey{(float)key.mTime, {key.mValue.x, key.mValue.y, key.mValue.z}});
+            }
+            channel.rotations.reserve(ai_channel->mNumRotationKeys);
+            for (unsigned int k = 0; k < ai_channel->mNumRotationKeys; k++)
+            {
+                const aiQuatKey &key = ai_channel->mRotationKeys[k];
+                channel.rotations.push_back(QuatKey{(float)key.mTime, {key.mValue.x, key.mValue.y, key.mValue.z, key.mValue.w}});
+            }
+            channel.scalings.reserve(ai_channel->mNumScalingKeys);
+            for (unsigned int k = 0; k < ai_channel->mNumScalingKeys; k++)
+            {
+                const aiVectorKey &key = ai_channel->mScalingKeys[k];
+                channel.scalings.push_back(VectorKey{(float)key.mTime, {key.mValue.x, key.mValue.y, key.mValue.z}});
+            }
+            clip.channels.push_back(std::move(channel));
+        }
+        data.animations.push_back(std::move(clip));
+    }
+}
+
+vector<Texture> Model::LoadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+{
+    // 纹理对象在ResolveTextures中通过ResourceManager获取，这里只记录类型和路径，便于写入网格缓存
+    vector<Texture> textures;
+    for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+    {
+        aiString str;
+        mat->GetTexture(type, i, &str);
+        Texture texture;
+        texture.id = 0;
+        texture.type = typeName;
+        texture.path = str.C_Str();
+        textures.push_back(texture);
+    }
     return textures;
 }
 
-GLuint Model::TextureFromFile(const char *path, const string &directory)
+void Model::ResolveTextures(vector<Texture> &textures)
+{
+    // 同一路径或同一内容的纹理在整个进程内只上传一次
+    for (Texture &texture : textures)
+    {
+        texture.handle = ResourceManager::Instance().AcquireTexture(QString::fromStdString(directory + '/' + texture.path));
+        texture.id = texture.handle ? texture.handle->textureId() : 0;
+    }
+}
+
+void Model::AllocateDraws(uint32_t mesh_count, uint32_t max_lod_count)
+{
+    lod_count = max_lod_count;
+    first_draw_slot = p_geometry_pool->AllocateDraws(mesh_count * lod_count);
+}
+
+void Model::BuildMaterials()
+{
+    // 材质数量通常很少，线性查找即可；导入时不保留光照参数，所有网格使用相同的参数
+    const QVector3D ambient(0.1f, 0.1f, 0.1f), diffuse(1.0f, 1.0f, 1.0f), specular(1.0f, 1.0f, 1.0f);
+    const float shininess = 1.0f;
+    const MaterialParameters parameters = Material::MakeParameters(ambient, diffuse, specular, shininess);
+    materials.clear();
+    for (Mesh &mesh : meshes)
+    {
+        auto it = std::find_if(materials.begin(), materials.end(), [&](const std::shared_ptr<Material> &material) {
+            return material->Matches(mesh.textures, parameters);
+        });
+        if (it == materials.end())
+        {
+            materials.push_back(std::make_shared<Material>(p_gl_funs, mesh.textures, ambient, diffuse, specular, shininess));
+            it = materials.end() - 1;
+        }
+        mesh.p_material = *it;
+    }
+    textured = !materials.empty() && std::all_of(materials.begin(), materials.end(), [](const std::shared_ptr<Material> &material) {
+        return material->HasDiffuseTexture();
+    });
+}
+
+void Model::BuildBatches()
 {
-    string filename = string(path);
-    filename = directory + '/' + filename;
+    // 材质以外的状态在模型内相同，材质相同的相邻网格可以合并
+    batches.clear();
+    for (uint32_t i = 0; i < meshes.size(); i++)
+    {
+        if (!batches.empty() && meshes[batches.back().first_mesh].p_material == meshes[i].p_material)
+            batches.back().mesh_count++;
+        else
+            batches.push_back(DrawBatch{i, 1});
+    }
 
-    QOpenGLTexture *texture = new QOpenGLTexture(QImage(filename.c_str()).mirrored());
-    if (texture == NULL)
-        qDebug() << "texture is NULL";
-    else
-        qDebug() << filename.c_str() << "loaded";
+    // 模型的一级LOD误差取所有网格中最大的，网格LOD数不足时沿用其最粗一级
+    lod_errors.assign(lod_count, 0.0f);
+    for (const Mesh &mesh : meshes)
+    {
+        for (uint32_t l = 0; l < lod_count; l++)
+            lod_errors[l] = std::max(lod_errors[l], mesh.lods[std::min<size_t>(l, mesh.lods.size() - 1)].error);
+    }
+}
 
-    return texture->textureId();
+void Model::ComputeBounds()
+{
+    // 网格包围盒的8个角点变换到模型空间后取并集
+    bool empty = true;
+    aabb_min = aabb_max = QVector3D(0.0f, 0.0f, 0.0f);
+    for (uint32_t node = 0; node < scene_graph.NodeCount(); node++)
+    {
+        const uint32_t first_mesh = scene_graph.first_meshes[node];
+        for (uint32_t i = first_mesh; i < first_mesh + scene_graph.mesh_counts[node]; i++)
+        {
+            for (int corner = 0; corner < 8; corner++)
+            {
+                QVector3D p(corner & 1 ? meshes[i].aabb_max.x() : meshes[i].aabb_min.x(),
+                            corner & 2 ? meshes[i].aabb_max.y() : meshes[i].aabb_min.y(),
+                            corner & 4 ? meshes[i].aabb_max.z() : meshes[i].aabb_min.z());
+                p = scene_graph.worlds[node].map(p);
+                if (empty)
+                {
+                    aabb_min = aabb_max = p;
+                    empty = false;
+                    continue;
+                }
+                aabb_min = QVector3D(std::min(aabb_min.x(), p.x()), std::min(aabb_min.y(), p.y()), std::min(aabb_min.z(), p.z()));
+                aabb_max = QVector3D(std::max(aabb_max.x(), p.x()), std::max(aabb_max.y(), p.y()), std::max(aabb_max.z(), p.z()));
+            }
+        }
+    }
 }
@@ -5,31 +5,190 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "animation.h"
+#include "geometrypool.h"
+#include "material.h"
 #include "mesh.h"
+#include "meshcache.h"
+#include "scenegraph.h"
 #include <QOpenGLTexture>
+#include <functional>
+#include <memory>
+#include <unordered_map>
 
 using std::vector;
 
+// 模型导入标志，同时作为网格缓存键的一部分
+const unsigned int kModelImportFlags = aiProcess_Triangulate | aiProcess_FlipUVs;
+// 原生STL加载器不经过Assimp，缓存键中的导入标志记为0
+const unsigned int kStlImportFlags = 0;
+
+// 导入进度回调，参数为0~1的进度，返回false时中止导入
+typedef std::function<bool(float)> ModelImportProgress;
+
+// 模型导入的CPU端结果，不涉及OpenGL，可以在工作线程中生成，再交给OpenGL线程构造Model
+struct ModelData {
+    string path;
+    // 源文件内容哈希：网格缓存和资源管理器按内容查重共用，调用者已算出时预先填入，Import不再重复计算
+    uint64_t source_hash = 0;
+    bool source_hashed = false;
+    // 缓存命中时网格数据留在映射内存中，由p_cache持有；否则在meshes中
+    std::unique_ptr<MeshCache> p_cache;
+    vector<MeshData> meshes;
+    SceneGraph scene_graph;
+    vector<Bone> bones;
+    vector<AnimationClip> animations;
+    // 导入时骨骼名称到骨骼编号的映射
+    std::unordered_map<string, uint32_t> bone_lookup;
+};
+
 class Model
 {
 
 public:
-    Model(QOpenGLFunctions_4_5_Core *glfuns, const char *path);
-    void Draw(QOpenGLShaderProgram &shader);
+    /**
+      * @brief  构造函数，加载模型并上传到GPU
+      * @author agent
+      * @param  glfuns: OpenGL函数指针
+      * @param  path: 模型路径
+      * @param  keep_cpu_data: 上传后是否保留网格的CPU端顶点和索引，只用于绘制的模型传false可节省一半内存
+      * @retval none
+      */
+    Model(QOpenGLFunctions_4_5_Core *glfuns, const char *path, bool keep_cpu_data = true);
+
+    /**
+      * @brief  构造函数，上传已导入的模型数据，必须在OpenGL线程中调用
+      * @author agent
+      * @param  glfuns: OpenGL函数指针
+      * @param  data: Import得到的模型数据，上传后被清空
+      * @param  keep_cpu_data: 上传后是否保留网格的CPU端顶点和索引
+      * @retval none
+      */
+    Model(QOpenGLFunctions_4_5_Core *glfuns, ModelData &&data, bool keep_cpu_data = true);
+    ~Model();
+    Model(const Model &) = delete;
+    Model &operator=(const Model &) = delete;
+
+    /**
+      * @brief  绘制模型，纹理相同的连续网格合并为一次间接绘制
+      * @author agent
+      * @param  shader: 当前绑定的着色器程序，已绑定实例数据（见InstanceBuffer）
+      * @param  lod: LOD级别，0为原网格
+      * @param  instance_count: 实例数量，从着色器的instance_base开始取连续的实例数据
+      * @retval none
+      */
+    void Draw(QOpenGLShaderProgram &shader, uint32_t lod = 0, uint32_t instance_count = 1);
+
+    /**
+      * @brief  逐簇剔除后绘制原网格（LOD 0），视锥外和整体背向相机的簇不提交，用于近处的精细模型；
+      *         没有簇的网格和蒙皮网格整体绘制；只画一个实例，即着色器instance_base处的实例
+      * @author agent
+      * @param  shader: 当前绑定的着色器程序
+      * @param  model_matrix: 模型矩阵，须与实例数据一致
+      * @param  view_projection: 投影矩阵 * 观察矩阵
+      * @param  camera_position: 相机的世界坐标
+      * @param  p_node_worlds: 各节点相对模型的变换（如Animator::node_worlds），为空时使用场景图
+      * @retval none
+      */
+    void DrawCulled(QOpenGLShaderProgram &shader, const QMatrix4x4 &model_matrix, const QMatrix4x4 &view_projection,
+                    const QVector3D &camera_position, const vector<QMatrix4x4> *p_node_worlds = nullptr);
+
+    /**
+      * @brief  按投影尺寸选择LOD：几何误差投影到屏幕后不超过max_pixel_error的最粗一级
+      * @author agent
+      * @param  pixels_per_unit: 模型空间中单位长度在屏幕上的像素数
+      * @param  max_pixel_error: 允许的屏幕空间误差（像素）
+      * @retval LOD级别
+      */
+    uint32_t SelectLod(float pixels_per_unit, float max_pixel_error = 1.0f) const;
+
+    /**
+      * @brief  按名称查找场景图节点（如舵面、起落架等可动部件）
+      * @author agent
+      * @param  name: 节点名称
+      * @retval 节点编号，不存在时为SceneGraph::kNoParent
+      */
+    int32_t FindNode(const string &name) const;
+
+    /**
+      * @brief  设置节点的局部变换，在下一次绘制或UpdateTransforms时生效
+      * @author agent
+      * @param  node: 节点编号
+      * @param  local: 相对父节点的局部变换
+      * @retval none
+      */
+    void SetNodeTransform(uint32_t node, const QMatrix4x4 &local);
+
+    /**
+      * @brief  更新变化节点的世界变换，并写入这些节点上网格的绘制槽位
+      * @author agent
+      * @param  none
+      * @retval none
+      */
+    void UpdateTransforms(void);
+
+    /**
+      * @brief  导入模型：读取网格缓存，未命中时运行导入器、优化网格、生成LOD并写入缓存。
+      *         不调用任何OpenGL函数，也不访问ResourceManager，可以在工作线程中调用
+      * @author agent
+      * @param  path: 模型路径
+      * @param  data: 输出的模型数据；source_hashed为true时直接使用其中的source_hash，否则计算后填入
+      * @param  progress: 进度回调，可以为空；返回false时在下一个检查点中止
+      * @retval 是否导入成功，中止时返回false
+      */
+    static bool Import(const string &path, ModelData &data, const ModelImportProgress &progress = nullptr);
 
 public:
     // model data
     QOpenGLFunctions_4_5_Core *p_gl_funs;
+    // 几何池必须先于网格构造、后于网格析构
+    std::shared_ptr<GeometryPool> p_geometry_pool;
     vector<Mesh> meshes;
     vector<Texture> textures;
+    // 模型内不重复的材质，网格通过p_material引用
+    vector<std::shared_ptr<Material>> materials;
+    // 所有材质都带漫反射纹理，可以使用采样纹理的着色器变体
+    bool textured;
     string directory;
+    bool keep_cpu_data;
+
+    // 网格占用从first_draw_slot开始的连续绘制槽位，按LOD分组：第l级第i个网格为first_draw_slot + l * meshes.size() + i
+    uint32_t first_draw_slot;
+    uint32_t lod_count;
+    // 每级LOD在所有网格上的最大几何误差（模型空间）
+    vector<float> lod_errors;
+    // 纹理相同的连续网格组成一个批次，每批次一次提交
+    struct DrawBatch {
+        uint32_t first_mesh;
+        uint32_t mesh_count;
+    };
+    vector<DrawBatch> batches;
+    // 导入时保留的节点层次和变换，网格按节点先序编号
+    SceneGraph scene_graph;
+    // 模型内所有网格共用的骨骼表，蒙皮数据中的骨骼编号指向这里
+    vector<Bone> bones;
+    // 动画片段，通道指向场景图节点，由每个实例的Animator播放
+    vector<AnimationClip> animations;
+    // 模型空间包围盒（所有网格的并集）
+    QVector3D aabb_min, aabb_max;
 
 private:
-    void LoadModel(string path);
-    void ProcessNode(aiNode *node, const aiScene *scene);
-    Mesh ProcessMesh(aiMesh *mesh, const aiScene *scene);
-    vector<Texture> LoadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName);
-    GLuint TextureFromFile(const char *path, const string &directory);
+    void Upload(ModelData &data);
+    static void ProcessNode(aiNode *node, const aiScene *scene, ModelData &data, int32_t parent);
+    static MeshData ProcessMesh(aiMesh *mesh, const aiScene *scene, ModelData &data);
+    static void ProcessSkin(aiMesh *mesh, ModelData &data, vector<VertexSkin> &skin);
+    static void ProcessAnimations(const aiScene *scene, ModelData &data);
+    static vector<Texture> LoadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName);
+    void ResolveTextures(vector<Texture> &textures);
+    void AllocateDraws(uint32_t mesh_count, uint32_t max_lod_count);
+    void BuildMaterials(void);
+    void BuildBatches(void);
+    void ComputeBounds(void);
+
+    // 逐帧剔除生成的命令直接写入几何池分配的空间，按网格顺序排列；culled_offsets[i]为第i个网格的第一条命令
+    // culled_command_capacity为一帧最多生成的命令数：每个簇一条，没有簇的网格一条
+    uint32_t culled_command_capacity;
+    vector<uint32_t> culled_offsets;
 
 };
 
@@ -0,0 +1,142 @@
+#include "modelloader.h"
+#include <QtConcurrent>
+#include <algorithm>
+
+ModelLoader::ModelLoader(QObject *parent)
+    : QObject(parent), next_request(0)
+{
+    load_pool.setMaxThreadCount(kModelLoadThreads);
+}
+
+ModelLoader::~ModelLoader()
+{
+    for (const std::shared_ptr<LoadJob> &job : jobs)
+        job->cancelled = true;
+    load_pool.waitForDone();
+}
+
+int ModelLoader::Load(const string &path, bool keep_cpu_data)
+{
+    const int request = next_request++;
+    ModelKey key;
+    std::shared_ptr<Model> model = ResourceManager::Instance().FindModel(path, keep_cpu_data, key);
+    if (model)
+    {
+        cached.emplace_back(request, model);
+        return request;
+    }
+
+    // 同一模型正在加载且能满足要求时合并请求
+    for (const std::shared_ptr<LoadJob> &job : jobs)
+    {
+        if (job->key.path == key.path && !job->cancelled && (job->keep_cpu_data || !keep_cpu_data))
+        {
+            job->requests.push_back(request);
+            return request;
+        }
+    }
+
+    std::shared_ptr<LoadJob> job = std::make_shared<LoadJob>();
+    job->path = path;
+    job->key = key;
+    job->keep_cpu_data = keep_cpu_data;
+    job->requests.push_back(request);
+    job->state = MODEL_LOAD_RUNNING;
+    job->progress = 0.0f;
+    job->cancelled = false;
+    job->reported_progress = -1.0f;
+    jobs.push_back(job);
+
+    // 工作线程持有任务的引用，请求全部取消后任务仍可安全地运行到下一个检查点；
+    // 内容哈希、网格缓存查找和导入都在工作线程中进行，完成后在Upload中按内容查重
+    QtConcurrent::run(&load_pool, [job]() {
+        bool success = Model::Import(job->path, job->data, [&job](float fraction) {
+            job->progress = fraction;
+            return !job->cancelled;
+        });
+        job->state = success ? MODEL_LOAD_READY : MODEL_LOAD_FAILED;
+    });
+    return request;
+}
+
+void ModelLoader::Cancel(int request)
+{
+    cached.erase(std::remove_if(cached.begin(), cached.end(), [request](const std::pair<int, std::shared_ptr<Model>> &entry) {
+        return entry.first == request;
+    }), cached.end());
+    for (const std::shared_ptr<LoadJob> &job : jobs)
+    {
+        auto it = std::find(job->requests.begin(), job->requests.end(), request);
+        if (it == job->requests.end())
+            continue;
+        job->requests.erase(it);
+        if (job->requests.empty())
+            job->cancelled = true;
+        return;
+    }
+}
+
+void ModelLoader::Upload(QOpenGLFunctions_4_5_Core *gl_funs, int max_uploads)
+{
+    // 先整理任务列表，最后统一发出信号，槽函数中再调用Load或Cancel不会破坏遍历
+    vector<std::pair<int, float>> progress;
+    vector<int> failed;
+    vector<std::pair<int, std::shared_ptr<Model>>> loaded;
+    loaded.swap(cached);
+
+    int uploads = 0;
+    for (auto it = jobs.begin(); it != jobs.end();)
+    {
+        LoadJob &job = **it;
+        const int state = job.state;
+        if (state == MODEL_LOAD_RUNNING)
+        {
+            const float fraction = job.progress;
+            if (fraction != job.reported_progress)
+            {
+                job.reported_progress = fraction;
+                for (int request : job.requests)
+                    progress.emplace_back(request, fraction);
+            }
+            ++it;
+            continue;
+        }
+        if (state == MODEL_LOAD_FAILED || job.requests.empty())
+        {
+            failed.insert(failed.end(), job.requests.begin(), job.requests.end());
+            it = jobs.erase(it);
+            continue;
+        }
+        // 超出本帧的上传数量，留到下一帧
+        if (uploads >= max_uploads)
+        {
+            ++it;
+            continue;
+        }
+        // 路径不同但内容相同的模型已经加载时直接共享，丢弃本次导入的数据
+        job.key.hash = job.data.source_hash;
+        job.key.hashed = job.data.source_hashed;
+        std::shared_ptr<Model> model = ResourceManager::Instance().FindModelByContent(job.key, job.keep_cpu_data);
+        if (!model)
+        {
+            uploads++;
+            model = std::make_shared<Model>(gl_funs, std::move(job.data), job.keep_cpu_data);
+        }
+        ResourceManager::Instance().RegisterModel(job.key, model);
+        for (int request : job.requests)
+            loaded.emplace_back(request, model);
+        it = jobs.erase(it);
+    }
+
+    for (const std::pair<int, float> &entry : progress)
+        emit Progress(entry.first, entry.second);
+    for (int request : failed)
+        emit Failed(request);
+    for (const std::pair<int, std::shared_ptr<Model>> &entry : loaded)
+        emit Loaded(entry.first, entry.second);
+}
+
+bool ModelLoader::IsIdle(void) const
+{
+    return jobs.empty() && cached.empty();
+}
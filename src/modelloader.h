@@ -0,0 +1,118 @@
+/**
+  ******************************************************************************
+  * @file           : modelloader.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了异步模型加载类的定义。导入（网格缓存读取或Assimp导入、网格优化、LOD生成）
+  * 在工作线程中进行，通过Assimp的ProgressHandler和各阶段检查点报告进度，可以随时取消；
+  * 导入完成的数据在OpenGL线程中每帧上传有限个模型，大量不同型号的飞机逐个出现而不是一起卡住
+  ******************************************************************************
+  * @attention
+  *     Load、Cancel和Upload都必须在OpenGL线程中调用，Upload还要求上下文为当前（通常在paintGL开头）；
+  * 所有信号都在Upload中发出，槽函数中可以直接使用OpenGL，也可以再次调用Load；
+  * 路径相同的已加载或正在加载的模型不会重复导入；Load只按路径查找，不读取文件，
+  * 内容哈希在工作线程中计算，路径不同而内容相同的模型在导入完成后合并为同一模型
+  ******************************************************************************
+  */
+
+#ifndef MODELLOADER_H
+#define MODELLOADER_H
+
+#include "model.h"
+#include "resourcemanager.h"
+#include <QObject>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+// 同时导入的模型数量，导入内部的网格优化和LOD生成另外使用全局线程池并行
+const int kModelLoadThreads = 2;
+// 每帧最多上传的模型数量
+const int kMaxModelUploadsPerFrame = 1;
+
+// 加载任务的状态
+typedef enum
+{
+    MODEL_LOAD_RUNNING,
+    MODEL_LOAD_READY,
+    MODEL_LOAD_FAILED,
+} ModelLoadState_t;
+
+class ModelLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ModelLoader(QObject *parent = nullptr);
+
+    /**
+      * @brief  析构函数，取消所有任务并等待工作线程结束，未上传的模型直接丢弃
+      * @author agent
+      * @param  none
+      * @retval none
+      */
+    ~ModelLoader();
+
+    /**
+      * @brief  请求加载模型，已加载的模型在下一次Upload时直接返回，正在加载的模型合并为同一任务
+      * @author agent
+      * @param  path: 模型路径，可以是磁盘文件或Qt资源
+      * @param  keep_cpu_data: 是否需要网格的CPU端顶点和索引
+      * @retval 请求编号，用于区分信号和取消
+      */
+    int Load(const string &path, bool keep_cpu_data = true);
+
+    /**
+      * @brief  取消请求，之后不再为该请求发出任何信号；任务的所有请求都取消后中止导入
+      * @author agent
+      * @param  request: 请求编号
+      * @retval none
+      */
+    void Cancel(int request);
+
+    /**
+      * @brief  发出进度和失败信号，上传导入完成的模型并发出Loaded，必须在OpenGL上下文为当前时调用
+      * @author agent
+      * @param  gl_funs: OpenGL函数指针
+      * @param  max_uploads: 本次最多上传的模型数量
+      * @retval none
+      */
+    void Upload(QOpenGLFunctions_4_5_Core *gl_funs, int max_uploads = kMaxModelUploadsPerFrame);
+
+    /**
+      * @brief  是否没有未完成的请求
+      * @author agent
+      * @param  none
+      * @retval 是否空闲
+      */
+    bool IsIdle(void) const;
+
+signals:
+    void Progress(int request, float fraction);
+    void Loaded(int request, std::shared_ptr<Model> model);
+    void Failed(int request);
+
+private:
+    // 一个模型的导入任务，可以对应多个请求；工作线程只访问data和原子成员
+    struct LoadJob {
+        string path;
+        ModelKey key;
+        bool keep_cpu_data;
+        vector<int> requests;
+        ModelData data;
+        std::atomic<int> state;
+        std::atomic<float> progress;
+        std::atomic<bool> cancelled;
+        float reported_progress;
+    };
+
+    QThreadPool load_pool;
+    vector<std::shared_ptr<LoadJob>> jobs;
+    // 命中已加载模型的请求，在下一次Upload时发出Loaded
+    vector<std::pair<int, std::shared_ptr<Model>>> cached;
+    int next_request;
+};
+
+#endif // MODELLOADER_H
@@ -1,16 +1,49 @@
 ﻿#include "myopenglwidget.h"
+#include "programcache.h"
+#include "resourceiosystem.h"
+#include "resourcemanager.h"
+#include <algorithm>
 #include <iostream>
+#include <QDebug>
+#include <QFile>
 #include <QtMath>
 
 MyOpenGLWidget::MyOpenGLWidget(QWidget *parent)
-    : QOpenGLWidget{parent}
+    : QOpenGLWidget{parent}, p_terrain_shaders(nullptr), p_plane_shaders(nullptr), p_gl_state(nullptr), p_stream_buffer(nullptr), p_frame_uniforms(nullptr), p_impostor_material(nullptr), p_render_queue(nullptr), p_render_graph(nullptr), present_fbo(0), frame_width(0), frame_height(0), cull_pixel_scale(0.0f), plane_model_request(-1), p_plane_impostor(nullptr), impostor_instances{nullptr, 0, 0, 0}, impostor_count(0), p_plane_instances(nullptr), p_plane_culler(nullptr)
 {
+    // 加载器不依赖OpenGL，提前创建以便主窗口连接进度信号
+    p_model_loader = new ModelLoader(this);
+    connect(p_model_loader, &ModelLoader::Loaded, this, &MyOpenGLWidget::OnModelLoaded);
     // 初始化刷新绘图定时器
     refresh_timer = new QTimer(this);
     connect(refresh_timer, SIGNAL(timeout()), this, SLOT(OnRefreshTimeout()));
     setFocusPolicy(Qt::StrongFocus);
 }
 
+MyOpenGLWidget::~MyOpenGLWidget()
+{
+    // 释放资源句柄时需要当前上下文，最后一个引用释放时才会删除GL对象
+    makeCurrent();
+    // 先等待后台导入结束，加载器中尚未交出的模型也要在上下文为当前时释放
+    delete p_model_loader;
+    delete p_plane_impostor;
+    for (Animator *p_animator : p_plane_animators)
+        delete p_animator;
+    delete p_plane_culler;
+    delete p_plane_instances;
+    delete p_render_graph;
+    glDeleteFramebuffers(1, &present_fbo);
+    delete p_render_queue;
+    delete p_frame_uniforms;
+    delete p_impostor_material;
+    delete p_terrain_shaders;
+    delete p_plane_shaders;
+    m_model.reset();
+    p_texture_terrain.reset();
+    p_my_photo.reset();
+    doneCurrent();
+}
+
 void MyOpenGLWidget::initializeGL()
 {
     // 初始化OpenGL函数指针
@@ -20,21 +53,44 @@ void MyOpenGLWidget::initializeGL()
     glEnable(GL_DEPTH_TEST);
 
     // 初始化操作
+    p_gl_state = &GLStateCache::Current();
+    p_stream_buffer = &StreamBuffer::Current();
     InitProgram();
+    p_frame_uniforms = new FrameUniforms(this, FRAME_VIEW_COUNT);
+    // 同一通道内按程序登记顺序绘制：地形、飞机、公告板
+    p_render_queue = new RenderQueue(this, p_frame_uniforms);
+    render_program_terrain = p_render_queue->RegisterProgram(&p_terrain_shaders->Get<kTerrainShaderFeatures>());
+    // 飞机的着色器变体在模型加载后选定
+    render_program_plane = p_render_queue->RegisterProgram(nullptr);
+    render_program_impostor = p_render_queue->RegisterProgram(&shader_program_impostor);
+    p_render_graph = new RenderGraph(this);
+    p_impostor_material = new Material(this, {}, QVector3D(0.1f, 0.1f, 0.1f), QVector3D(0.6f, 0.6f, 0.6f));
     InitTexture("./resources/terrain.png");
     InitTerrain("./resources/grid.dem");
     InitPhoto("./resources/photo.png", QVector2D(0.6f, -0.6f), QVector2D(1.0f, -1.0f));
 
     p_camera = new Camera(nearclip, farclip, 30.0, QVector3D(0, 0, farclip / 5));
-    m_model = new Model(QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_4_5_Core>(), "./resources/plane.stl");
+    // 模型打包在程序资源中；存在外部模型资源包时挂载到":/packed"下，其中的飞机模型优先于内置模型
+    QString plane_model_path = ":/model/resources/plane.stl";
+    if (!ResourceIOSystem::MountArchive("./resources/models.rcc", "/packed"))
+        qDebug() << "MyOpenGLWidget: cannot mount ./resources/models.rcc, using built-in models";
+    else if (QFile::exists(":/packed/plane.stl"))
+        plane_model_path = ":/packed/plane.stl";
+    LoadPlaneModel(plane_model_path);
+    frame_clock.start();
     QMatrix4x4 plane_pose_offset_matrix;
     plane_pose_offset_matrix.rotate(-90.0f, QVector3D(1.0f, 0.0f, 0.0f));
     p_plane_pose_0 = new ObjectPose(plane_pose_offset_matrix, QVector3D(0.0f, 10000.0f, 0.0f));
     plane_pose_offset_matrix.setToIdentity();
     plane_pose_offset_matrix.rotate(-90.0f, QVector3D(1.0f, 0.0f, 0.0f));
     p_plane_pose_1 = new ObjectPose(plane_pose_offset_matrix, QVector3D(0.0f, 10000.0f, 10000.0f));
-    p_plane_pose_array[0] = p_plane_pose_0;
-    p_plane_pose_array[1] = p_plane_pose_1;
+    p_plane_pose_array = {p_plane_pose_0, p_plane_pose_1};
+    p_plane_instances = new InstanceBuffer(this);
+
+    // 冲突检测：最小间隔与预测窗口按场景尺度给定，10Hz采样位姿
+    p_conflict_detector = new ConflictDetector(3000.0f, 10.0f);
+    p_conflict_detector->Resize((uint)p_plane_pose_array.size());
+    conflict_clock.start();
 }
 
 void MyOpenGLWidget::resizeGL(int w, int h)
@@ -45,101 +101,323 @@ void MyOpenGLWidget::resizeGL(int w, int h)
 
 void MyOpenGLWidget::paintGL()
 {
+    // 本帧的流式数据（包括新模型烘焙公告板时的上传）写入下一段，必要时等待GPU读完该段
+    p_stream_buffer->BeginFrame();
+    // 上传后台导入完成的模型，每帧数量有限
+    p_model_loader->Upload(QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_4_5_Core>());
+    p_gl_state->BeginFrame();
 
-    // 绘制地形
+    // 逐帧数据：主相机和照片覆盖层各一个视图，一次上传，所有着色器共用
     QMatrix4x4 projection;
     projection.perspective(p_camera->field_of_view_degree, (float)width()/height(), nearclip, farclip);
     QMatrix4x4 view = p_camera->GetViewMatrix();
-    QMatrix4x4 terrain_model;
-    terrain_model.rotate(-90.0f, QVector3D(1.0f, 0.0f, 0.0f));
-    terrain_model.translate(QVector3D(-rx, -ry, -rz));
-
-    shader_program_terrain.bind();
-    shader_program_terrain.setUniformValue("projection", projection);
-    shader_program_terrain.setUniformValue("view", view);
-    shader_program_terrain.setUniformValue("model", terrain_model);
-
-    p_texture_terrain->bind(0);
-    DrawTerrain();
-    p_texture_terrain->release();
-    shader_program_terrain.release();
-
-    // 绘制飞机
-    QMatrix4x4 plane_model;
-    plane_model.scale(100.0f);
-    plane_model = p_plane_pose_0->GetModelMatrix() * plane_model;
+    QMatrix4x4 photo_projection;
+    photo_projection.ortho(0.0f, 1.0f, 0.0f, height() / width(), -1.0f, 1.0f);
+    p_frame_uniforms->Begin();
+    p_frame_uniforms->Set(FRAME_VIEW_MAIN, projection, view, p_camera->position_vec,
+                          QVector3D(farclip, farclip, 0), QVector3D(1.0f, 1.0f, 1.0f));
+    p_frame_uniforms->Set(FRAME_VIEW_PHOTO, photo_projection, QMatrix4x4(), QVector3D());
+    view_projection = projection * view;
 
-    shader_program_plane.bind();
+    // 各部分提交绘制项，最后由渲染队列排序后统一执行
+    p_render_queue->Clear();
 
-    shader_program_plane.setUniformValue("projection", projection);
-    shader_program_plane.setUniformValue("view", view);
-    shader_program_plane.setUniformValue("model", plane_model);
+    // 地形
+    terrain_model.setToIdentity();
+    terrain_model.rotate(-90.0f, QVector3D(1.0f, 0.0f, 0.0f));
+    terrain_model.translate(QVector3D(-rx, -ry, -rz));
+    p_render_queue->Submit(RENDER_PASS_OPAQUE, render_program_terrain, nullptr, p_texture_terrain->textureId(), 1.0f,
+                           FRAME_VIEW_MAIN, this, RENDER_ITEM_TERRAIN);
+
+    // 飞机：屏幕上足够大的飞机按LOD绘制网格，过小的收集为公告板实例统一绘制；
+    // 网格飞机按LOD排序写入实例缓冲，同一LOD的所有飞机一次实例化绘制；
+    // 支持GPU剔除时网格飞机不排序，视锥剔除和LOD选择都在计算着色器中完成
+    const QVector3D plane_colors[2] = {QVector3D(0.5f, 0.5f, 0.5f), QVector3D(0.1f, 0.2f, 0.6f)};
+    const QVector3D plane_diffuses[2] = {QVector3D(0.6f, 0.6f, 0.6f), QVector3D(0.3f, 0.3f, 0.3f)};
+    impostor_count = 0;
+    plane_draws.clear();
+    plane_groups.clear();
+    const float delta_seconds = frame_clock.restart() / 1000.0f;
+
+    const uint plane_count = m_model ? (uint)p_plane_pose_array.size() : 0;
+    const bool gpu_culled = p_plane_culler != nullptr;
+    // 公告板实例直接写入流式缓冲，最多所有飞机都画成公告板
+    impostor_instances = p_stream_buffer->Allocate(plane_count * sizeof(ImpostorInstance));
+    ImpostorInstance *p_impostors = reinterpret_cast<ImpostorInstance *>(impostor_instances.p_data);
+    float nearest_impostor = 1.0f;
+    for (uint i = 0; i < plane_count; i++)
+    {
+        QMatrix4x4 plane_model;
+        plane_model.scale(100.0f);
+        plane_model = p_plane_pose_array[i]->GetModelMatrix() * plane_model;
+
+        // 画成公告板时动画时间照常推进
+        if (!p_plane_animators.empty())
+            p_plane_animators[i]->Update(delta_seconds);
+
+        const float depth = (plane_model.column(3).toVector3D() - p_camera->position_vec).length() / farclip;
+        float pixels_per_unit = PlanePixelsPerUnit(plane_model, 100.0f, projection);
+        if (2.0f * p_plane_impostor->radius * pixels_per_unit < kImpostorPixels)
+        {
+            QVector3D color = p_conflict_detector->IsInConflict(i) ? QVector3D(0.8f, 0.1f, 0.1f) : plane_colors[i % 2];
+            Impostor::PackInstance(plane_model, color, plane_diffuses[i % 2], p_impostors[impostor_count++]);
+            nearest_impostor = std::min(nearest_impostor, depth);
+            continue;
+        }
+        plane_draws.push_back(PlaneDraw{gpu_culled ? 0 : m_model->SelectLod(pixels_per_unit), i, depth, plane_model});
+    }
+    if (!gpu_culled)
+    {
+        std::sort(plane_draws.begin(), plane_draws.end(), [](const PlaneDraw &a, const PlaneDraw &b) {
+            return a.lod < b.lod;
+        });
+    }
 
-    shader_program_plane.setUniformValue("material.ambient", QVector3D(0.1f, 0.1f, 0.1f));
-    shader_program_plane.setUniformValue("material.diffuse", QVector3D(0.6f, 0.6f, 0.6f));
-    shader_program_plane.setUniformValue("material.specular", QVector3D(1.0f, 1.0f, 1.0f));
-    shader_program_plane.setUniformValue("material.color", QVector3D(0.5f, 0.5f, 0.5f));
-    
-    shader_program_plane.setUniformValue("light.position", QVector3D(farclip, farclip, 0));
-    shader_program_plane.setUniformValue("light.color", QVector3D(1.0f, 1.0f, 1.0f));
+    // 实例和动画矩阵按本帧的上限一次分配，Add直接写入映射内存
+    uint32_t animation_matrix_capacity = 0;
+    if (!p_plane_animators.empty())
+    {
+        for (const PlaneDraw &draw : plane_draws)
+            animation_matrix_capacity += (uint32_t)(p_plane_animators[draw.plane]->matrices.size() / 16);
+    }
+    p_plane_instances->Begin((uint32_t)plane_draws.size(), animation_matrix_capacity);
+    for (const PlaneDraw &draw : plane_draws)
+    {
+        QVector3D color = p_conflict_detector->IsInConflict(draw.plane) ? QVector3D(0.8f, 0.1f, 0.1f) : plane_colors[draw.plane % 2];
+        p_plane_instances->Add(draw.model, color, plane_diffuses[draw.plane % 2],
+                               p_plane_animators.empty() ? nullptr : p_plane_animators[draw.plane]);
+    }
+    p_plane_instances->End();
 
-    shader_program_plane.setUniformValue("view_pos", p_camera->position_vec);
-    
-    m_model->Draw(shader_program_plane);
+    const bool planes_gpu_culled = gpu_culled && !plane_draws.empty();
+    if (planes_gpu_culled)
+    {
+        float nearest = 1.0f;
+        for (const PlaneDraw &draw : plane_draws)
+            nearest = std::min(nearest, draw.depth);
+        p_render_queue->Submit(RENDER_PASS_OPAQUE, render_program_plane, nullptr, 0, nearest,
+                               FRAME_VIEW_MAIN, this, RENDER_ITEM_PLANES_GPU);
+    }
+    for (uint32_t first = 0; !gpu_culled && first < plane_draws.size();)
+    {
+        const uint32_t lod = plane_draws[first].lod;
+        uint32_t last = first;
+        float nearest = 1.0f;
+        while (last < plane_draws.size() && plane_draws[last].lod == lod)
+            nearest = std::min(nearest, plane_draws[last++].depth);
+        if (lod == 0)
+        {
+            // 原网格只在近处出现，数量少而屏幕占比大，逐架逐簇剔除
+            for (uint32_t k = first; k < last; k++)
+                p_render_queue->Submit(RENDER_PASS_OPAQUE, render_program_plane, nullptr, 0, plane_draws[k].depth,
+                                       FRAME_VIEW_MAIN, this, RENDER_ITEM_PLANE_CULLED, k);
+        }
+        else
+        {
+            p_render_queue->Submit(RENDER_PASS_OPAQUE, render_program_plane, nullptr, 0, nearest,
+                                   FRAME_VIEW_MAIN, this, RENDER_ITEM_PLANE_GROUP, (uint32_t)plane_groups.size());
+            plane_groups.push_back(PlaneGroup{first, last - first, lod});
+        }
+        first = last;
+    }
+
+    if (impostor_count != 0)
+        p_render_queue->Submit(RENDER_PASS_OPAQUE, render_program_impostor, p_impostor_material, 0, nearest_impostor,
+                               FRAME_VIEW_MAIN, this, RENDER_ITEM_IMPOSTORS);
+
+    // 照片
+    p_render_queue->Submit(RENDER_PASS_OVERLAY, render_program_terrain, nullptr, p_my_photo->textureId(), 0.0f,
+                           FRAME_VIEW_PHOTO, this, RENDER_ITEM_PHOTO);
+
+    // 渲染图：剔除 -> 场景 -> 覆盖层 -> 呈现，按读写关系排序，剔除结果不被读取时跳过剔除通道，
+    // 两者之间的内存屏障由渲染图插入；场景和覆盖层画在渲染图的临时颜色和深度纹理上，呈现时拷贝到默认帧缓冲
+    p_render_graph->Reset();
+    frame_width = (int)(width() * devicePixelRatioF());
+    frame_height = (int)(height() * devicePixelRatioF());
+    const uint32_t backbuffer = p_render_graph->ImportFramebuffer("backbuffer", defaultFramebufferObject());
+    const uint32_t scene_color = p_render_graph->CreateTexture("scene_color", frame_width, frame_height, GL_RGBA8);
+    const uint32_t scene_depth = p_render_graph->CreateTexture("scene_depth", frame_width, frame_height, GL_DEPTH_COMPONENT24);
+    const uint32_t plane_commands = p_render_graph->CreateBuffer("plane_commands");
+    if (gpu_culled)
+    {
+        cull_pixel_scale = projection(1, 1) * height() * 0.5f;
+        const uint32_t cull_pass = p_render_graph->AddPass("plane_cull", this, GRAPH_PASS_PLANE_CULL);
+        p_render_graph->Write(cull_pass, plane_commands);
+    }
+    const uint32_t scene_pass = p_render_graph->AddPass("scene", this, GRAPH_PASS_SCENE);
+    if (planes_gpu_culled)
+        p_render_graph->Read(scene_pass, plane_commands, kCullDrawBarriers);
+    p_render_graph->Write(scene_pass, scene_color, GL_COLOR_ATTACHMENT0);
+    p_render_graph->Write(scene_pass, scene_depth, GL_DEPTH_ATTACHMENT);
+    const uint32_t overlay_pass = p_render_graph->AddPass("overlay", this, GRAPH_PASS_OVERLAY);
+    p_render_graph->Write(overlay_pass, scene_color, GL_COLOR_ATTACHMENT0);
+    p_render_graph->Write(overlay_pass, scene_depth, GL_DEPTH_ATTACHMENT);
+    const uint32_t present_pass = p_render_graph->AddPass("present", this, GRAPH_PASS_PRESENT, scene_color);
+    p_render_graph->Read(present_pass, scene_color);
+    p_render_graph->Write(present_pass, backbuffer);
+    p_render_graph->Execute();
+    emit StateCallsCounted(p_gl_state->issued_calls, p_gl_state->saved_calls);
+    emit TransientMemoryCounted(p_render_graph->peak_transient_bytes, p_render_graph->unaliased_transient_bytes);
 
-    plane_model.setToIdentity();
-    plane_model.scale(100.0f);
-    plane_model = p_plane_pose_1->GetModelMatrix() * plane_model;
-    shader_program_plane.setUniformValue("model", plane_model);
-    shader_program_plane.setUniformValue("material.color", QVector3D(0.1f, 0.2f, 0.6f));
-    shader_program_plane.setUniformValue("material.diffuse", QVector3D(0.3f, 0.3f, 0.3f));
-    m_model->Draw(shader_program_plane);
+    refresh_timer->start(1000.0f / 60.0f);
+}
 
-    shader_program_plane.release();
+void MyOpenGLWidget::Render(QOpenGLShaderProgram &shader, uint32_t id, uint32_t param)
+{
+    switch (id)
+    {
+    case RENDER_ITEM_TERRAIN:
+        shader.setUniformValue(terrain_model_location, terrain_model);
+        DrawTerrain();
+        break;
+    case RENDER_ITEM_PLANE_GROUP:
+    {
+        const PlaneGroup &group = plane_groups[param];
+        p_plane_instances->Bind(shader, group.first);
+        m_model->Draw(shader, group.lod, group.count);
+        break;
+    }
+    case RENDER_ITEM_PLANE_CULLED:
+    {
+        const PlaneDraw &draw = plane_draws[param];
+        p_plane_instances->Bind(shader, param);
+        m_model->DrawCulled(shader, draw.model, view_projection, p_camera->position_vec,
+                            p_plane_animators.empty() ? nullptr : &p_plane_animators[draw.plane]->node_worlds);
+        break;
+    }
+    case RENDER_ITEM_PLANES_GPU:
+        p_plane_instances->Bind(shader);
+        p_plane_culler->Draw(shader);
+        break;
+    case RENDER_ITEM_IMPOSTORS:
+        p_plane_impostor->Draw(shader, impostor_instances, impostor_count);
+        break;
+    case RENDER_ITEM_PHOTO:
+        shader.setUniformValue(terrain_model_location, QMatrix4x4());
+        DrawPhoto();
+        break;
+    default:
+        break;
+    }
+}
 
-    // 绘制照片
-    QMatrix4x4 photo_projection;
-    photo_projection.ortho(0.0f, 1.0f, 0.0f, height() / width(), -1.0f, 1.0f);
-    QMatrix4x4 photo_view;
-    QMatrix4x4 photo_model;
+void MyOpenGLWidget::ExecutePass(uint32_t id, uint32_t param)
+{
+    switch (id)
+    {
+    case GRAPH_PASS_PLANE_CULL:
+        p_plane_culler->Cull(*p_plane_instances, view_projection, p_camera->position_vec, cull_pixel_scale, nearclip);
+        break;
+    case GRAPH_PASS_SCENE:
+    {
+        // 临时纹理的初始内容未定义，第一个写入它的通道先清除
+        const GLfloat clear_color[] = {0.0f, 0.0f, 0.0f, 1.0f};
+        const GLfloat clear_depth = 1.0f;
+        glClearBufferfv(GL_COLOR, 0, clear_color);
+        glClearBufferfv(GL_DEPTH, 0, &clear_depth);
+        p_render_queue->Execute(RENDER_PASS_OPAQUE, RENDER_PASS_TRANSPARENT);
+        break;
+    }
+    case GRAPH_PASS_OVERLAY:
+        p_render_queue->Execute(RENDER_PASS_OVERLAY, RENDER_PASS_OVERLAY);
+        break;
+    case GRAPH_PASS_PRESENT:
+        // 物理纹理可能逐帧不同，每次呈现前重新挂到读取用的帧缓冲上
+        if (present_fbo == 0)
+            glCreateFramebuffers(1, &present_fbo);
+        glNamedFramebufferTexture(present_fbo, GL_COLOR_ATTACHMENT0, p_render_graph->Texture(param), 0);
+        glNamedFramebufferReadBuffer(present_fbo, GL_COLOR_ATTACHMENT0);
+        glBlitNamedFramebuffer(present_fbo, defaultFramebufferObject(), 0, 0, frame_width, frame_height,
+                               0, 0, frame_width, frame_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        break;
+    default:
+        break;
+    }
+}
 
-    shader_program_terrain.bind();
-    shader_program_terrain.setUniformValue("projection", photo_projection);
-    shader_program_terrain.setUniformValue("view", photo_view);
-    shader_program_terrain.setUniformValue("model", photo_model);
+void MyOpenGLWidget::OnModelLoaded(int request, std::shared_ptr<Model> model)
+{
+    if (request != plane_model_request)
+        return;
+    // 替换模型：先释放引用旧模型的剔除器、公告板和动画播放器
+    delete p_plane_culler;
+    p_plane_culler = nullptr;
+    delete p_plane_impostor;
+    p_plane_impostor = nullptr;
+    for (Animator *p_animator : p_plane_animators)
+        delete p_animator;
+    p_plane_animators.clear();
+    m_model = model;
+    // 被替换的模型和纹理释放后，资源管理器中指向它们的弱引用条目随之清理
+    ResourceManager::Instance().Purge();
+    // 只编译这个模型需要的变体：不带动画的模型没有动画矩阵的分支，不完全带纹理的模型不采样纹理
+    uint32_t plane_features = SHADER_FEATURE_LIT;
+    if (m_model->textured)
+        plane_features |= SHADER_FEATURE_TEXTURED;
+    if (!m_model->animations.empty())
+        plane_features |= SHADER_FEATURE_ANIMATED;
+    // 驱动和模型支持时在GPU上剔除网格飞机并选择LOD，剔除程序构建失败时退回CPU
+    if (GpuCuller::Supported(*m_model))
+    {
+        p_plane_culler = new GpuCuller(this, *m_model);
+        if (!p_plane_culler->ready)
+        {
+            delete p_plane_culler;
+            p_plane_culler = nullptr;
+        }
+    }
+    if (p_plane_culler != nullptr)
+        plane_features |= SHADER_FEATURE_GPU_CULLED;
+    p_render_queue->SetProgram(render_program_plane, &p_plane_shaders->Variant(plane_features));
+    // 飞机可能从下方被看到，公告板覆盖整个球面
+    p_plane_impostor = new Impostor(this, *m_model, IMPOSTOR_SPHERE);
+    // 模型带动画时每架飞机独立播放，互不同步
+    if (!m_model->animations.empty())
+    {
+        for (size_t i = 0; i < p_plane_pose_array.size(); i++)
+        {
+            p_plane_animators.push_back(new Animator(*m_model));
+            p_plane_animators.back()->Play(0);
+        }
+    }
+}
 
-    p_my_photo->bind(0);
-    DrawPhoto();
-    p_my_photo->release();
-    shader_program_terrain.release();
+void MyOpenGLWidget::LoadPlaneModel(const QString &path)
+{
+    // 上一个模型还没加载完时取消它，只有最新请求的模型会替换当前模型
+    if (!p_model_loader->IsIdle())
+        p_model_loader->Cancel(plane_model_request);
+    plane_model_request = p_model_loader->Load(path.toStdString(), false);
+}
 
-    refresh_timer->start(1000.0f / 60.0f);
+float MyOpenGLWidget::PlanePixelsPerUnit(const QMatrix4x4 &plane_model, float model_scale, const QMatrix4x4 &projection)
+{
+    // 距离d处单位长度在屏幕上约为 projection(1,1) * 视口高度 / 2 / d 个像素
+    float distance = (plane_model.column(3).toVector3D() - p_camera->position_vec).length();
+    return model_scale * projection(1, 1) * height() * 0.5f / std::max(distance, (float)nearclip);
 }
 
 void MyOpenGLWidget::InitProgram(void)
 {
-    shader_program_terrain.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shader/terrain.vert");
-    shader_program_terrain.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shader/terrain.frag");
-    bool success = shader_program_terrain.link();
-    if (!success)
-    {
-        qDebug() << "ERR: " << shader_program_terrain.log();
+    // 优先从程序二进制缓存载入，其余程序并行编译
+    ProgramCache program_cache(this);
+    program_cache.Add(&shader_program_impostor, ":/shader/impostor.vert", ":/shader/impostor.frag");
+    if (!program_cache.Build())
         exit(-1);
-    }
 
-    shader_program_plane.addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shader/plane.vert");
-    shader_program_plane.addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shader/plane.frag");
-    success = shader_program_plane.link();
-    if (!success)
-    {
-        qDebug() << "ERR: " << shader_program_plane.log();
+    // 地形和飞机按特性编译变体，用到时才编译
+    p_terrain_shaders = new ShaderPermutations(this, ":/shader/terrain.vert", ":/shader/terrain.frag", SHADER_FEATURE_TEXTURED);
+    p_plane_shaders = new ShaderPermutations(this, ":/shader/plane.vert", ":/shader/plane.frag",
+                                             SHADER_FEATURE_TEXTURED | SHADER_FEATURE_LIT | SHADER_FEATURE_ANIMATED | SHADER_FEATURE_GPU_CULLED);
+    QOpenGLShaderProgram &terrain_program = p_terrain_shaders->Get<kTerrainShaderFeatures>();
+    if (!terrain_program.isLinked())
         exit(-1);
-    }
+    terrain_model_location = terrain_program.uniformLocation("model");
 }
 
 void MyOpenGLWidget::InitTexture(const char *pic_file)
 {
-    p_texture_terrain = new QOpenGLTexture(QImage(pic_file).mirrored());
+    p_texture_terrain = ResourceManager::Instance().AcquireTexture(pic_file);
 }
 
 void MyOpenGLWidget::InitTerrain(const char *dem_file)
@@ -236,18 +514,15 @@ void MyOpenGLWidget::InitTerrain(const char *dem_file)
 void MyOpenGLWidget::DrawTerrain(void)
 {
     // 绑定VAO
-    glBindVertexArray(vao_terrain);
+    p_gl_state->BindVertexArray(vao_terrain);
 
     // 绘制地形
     glDrawElements(GL_TRIANGLES, (nx_terrain - 1) * (ny_terrain - 1) * 6, GL_UNSIGNED_INT, nullptr);
-
-    // 解绑VAO
-    glBindVertexArray(0);
 }
 
 void MyOpenGLWidget::InitPhoto(const char *pic_file, QVector2D left_top, QVector2D right_bottom)
 {
-    p_my_photo = new QOpenGLTexture(QImage(pic_file));
+    p_my_photo = ResourceManager::Instance().AcquireTexture(pic_file, false);
     float x_left_top = left_top.x();
     float y_left_top = left_top.y();
     float x_right_bottom = right_bottom.x();
@@ -296,9 +571,8 @@ void MyOpenGLWidget::InitPhoto(const char *pic_file, QVector2D left_top, QVector
 
 void MyOpenGLWidget::DrawPhoto(void)
 {
-    glBindVertexArray(vao_photo);
+    p_gl_state->BindVertexArray(vao_photo);
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
-    glBindVertexArray(0);
 }
 
 void MyOpenGLWidget::OnRefreshTimeout(void)
@@ -354,6 +628,15 @@ void MyOpenGLWidget::OnRefreshTimeout(void)
     {
         temp_p_plane_pose->Rotate(0, 0, 1);
     }
+    // 冲突检测，每100ms采样一次位姿
+    qint64 now_ms = conflict_clock.elapsed();
+    if (now_ms - conflict_last_ms >= 100)
+    {
+        conflict_last_ms = now_ms;
+        for (uint i = 0; i < p_plane_pose_array.size(); i++)
+            p_conflict_detector->UpdatePose(i, p_plane_pose_array[i]->position_vec, now_ms / 1000.0);
+        p_conflict_detector->Detect();
+    }
     // qDebug() << p_plane_pose_0->position_vec;
     update();
 }
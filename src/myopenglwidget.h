@@ -8,11 +8,58 @@
 #include <QMouseEvent>
 #include <QWheelEvent>
 #include <QTimer>
+#include <QElapsedTimer>
 #include "model.h"
+#include "animator.h"
+#include "frameuniforms.h"
+#include "glstatecache.h"
+#include "gpuculler.h"
+#include "impostor.h"
+#include "instancebuffer.h"
+#include "modelloader.h"
 #include "camera.h"
 #include "objectpose.h"
+#include "rendergraph.h"
+#include "renderqueue.h"
+#include "shaderpermutations.h"
+#include "streambuffer.h"
+#include "conflictdetector.h"
+#include <memory>
 
-class MyOpenGLWidget : public QOpenGLWidget, QOpenGLFunctions_4_5_Core
+// 飞机在屏幕上的直径小于该像素数时画成公告板
+const float kImpostorPixels = 48.0f;
+// 地形和照片使用的着色器特性
+const uint32_t kTerrainShaderFeatures = SHADER_FEATURE_TEXTURED;
+
+// 一帧中的视图，对应逐帧uniform缓冲中的各段
+typedef enum
+{
+    FRAME_VIEW_MAIN,    // 主相机
+    FRAME_VIEW_PHOTO,   // 照片覆盖层
+    FRAME_VIEW_COUNT,
+} FrameView_t;
+
+// 本窗口提交到渲染队列的绘制项
+typedef enum
+{
+    RENDER_ITEM_TERRAIN,        // 地形
+    RENDER_ITEM_PLANE_GROUP,    // 同一LOD的一组飞机，参数为组编号
+    RENDER_ITEM_PLANE_CULLED,   // 逐簇剔除的一架原网格飞机，参数为实例编号
+    RENDER_ITEM_PLANES_GPU,     // GPU剔除并选择LOD的所有网格飞机
+    RENDER_ITEM_IMPOSTORS,      // 所有公告板飞机
+    RENDER_ITEM_PHOTO,          // 照片覆盖层
+} RenderItem_t;
+
+// 本窗口添加到渲染图的通道
+typedef enum
+{
+    GRAPH_PASS_PLANE_CULL,      // GPU剔除飞机并生成间接绘制命令
+    GRAPH_PASS_SCENE,           // 不透明和透明绘制项
+    GRAPH_PASS_OVERLAY,         // 覆盖层绘制项
+    GRAPH_PASS_PRESENT,         // 场景颜色拷贝到默认帧缓冲，参数为场景颜色资源
+} GraphPass_t;
+
+class MyOpenGLWidget : public QOpenGLWidget, QOpenGLFunctions_4_5_Core, public Renderable, public RenderGraphPass
 {
     Q_OBJECT
 
@@ -30,6 +77,7 @@ protected:  // 回调函数覆写
 
 public:
     explicit MyOpenGLWidget(QWidget *parent = nullptr);
+    ~MyOpenGLWidget();
 
     // my functions
 
@@ -76,6 +124,35 @@ public:
     void InitPhoto(const char *pic_file, QVector2D left_top, QVector2D right_bottom);
     void DrawPhoto(void);
 
+    /**
+      * @brief  计算飞机处模型空间单位长度在屏幕上的像素数，用于选择LOD和公告板
+      * @author agent
+      * @param  plane_model: 飞机的模型矩阵
+      * @param  model_scale: 模型矩阵中的缩放系数
+      * @param  projection: 投影矩阵
+      * @retval 每单位长度的像素数
+      */
+    float PlanePixelsPerUnit(const QMatrix4x4 &plane_model, float model_scale, const QMatrix4x4 &projection);
+
+    /**
+      * @brief  执行本窗口提交的绘制项，由渲染队列回调
+      * @author agent
+      * @param  shader: 当前绑定的着色器程序
+      * @param  id: 绘制项类型，见RenderItem_t
+      * @param  param: 组编号或实例编号
+      * @retval none
+      */
+    virtual void Render(QOpenGLShaderProgram &shader, uint32_t id, uint32_t param) override;
+
+    /**
+      * @brief  执行本窗口添加的通道，由渲染图回调
+      * @author agent
+      * @param  id: 通道类型，见GraphPass_t
+      * @param  param: 呈现通道为场景颜色的资源编号
+      * @retval none
+      */
+    virtual void ExecutePass(uint32_t id, uint32_t param) override;
+
 public:
     GLint mouse_x, mouse_y; // position of mouse;
 
@@ -85,31 +162,109 @@ public:
     GLfloat rx, ry, rz;  // reference point
 
     int nx_terrain, ny_terrain; // the resolution of terrain
-    QOpenGLTexture *p_texture_terrain;     // terrain texture
-    QOpenGLTexture *p_my_photo;
+    std::shared_ptr<QOpenGLTexture> p_texture_terrain;     // terrain texture
+    std::shared_ptr<QOpenGLTexture> p_my_photo;
 
     GLuint vao_terrain, vbo_vercoord, vbo_texcoord, ebo_index; // VAO, VBO and EBO of terrain
-    QOpenGLShaderProgram shader_program_terrain;
-    QOpenGLShaderProgram shader_program_plane;
+    ShaderPermutations *p_terrain_shaders;  // 地形和照片，带纹理不带光照
+    ShaderPermutations *p_plane_shaders;    // 网格飞机，变体由模型是否带纹理和动画决定
+    QOpenGLShaderProgram shader_program_impostor;
+    GLStateCache *p_gl_state;           // 逐帧路径上的绑定经过状态缓存，每帧开始时置为未知
+    StreamBuffer *p_stream_buffer;      // 逐帧上传的数据写入其中，每帧开始时切换到下一段
+    FrameUniforms *p_frame_uniforms;    // 投影、观察、相机和光源，每帧上传一次
+    Material *p_impostor_material;      // 公告板的光照参数，网格飞机使用模型自己的材质
+    RenderQueue *p_render_queue;        // 每帧的绘制项，排序后统一执行
+    RenderGraph *p_render_graph;        // 每帧声明的通道和资源，按读写关系排序执行
+    GLuint present_fbo;                 // 呈现通道读取场景颜色（渲染图的临时纹理）用的帧缓冲，首次呈现时创建
+    int frame_width, frame_height;      // 本帧默认帧缓冲的像素尺寸
+    float cull_pixel_scale;             // 本帧剔除通道换算屏幕像素用的比例
+    uint32_t render_program_terrain, render_program_plane, render_program_impostor;    // 着色器程序在队列中的编号
+    int terrain_model_location;         // 地形程序的model位置，链接后查询一次
+    QMatrix4x4 terrain_model;
+    QMatrix4x4 view_projection;
     GLuint vao_photo, vbo_vercoord_photo, vbo_texcoord_photo, ebo_index_photo; // VAO, VBO and EBO of photo
 
     QTimer *refresh_timer;
 
-    Model *m_model;
+    ModelLoader *p_model_loader;    // 模型在后台导入，paintGL开头上传
+    int plane_model_request;
+    std::shared_ptr<Model> m_model; // 加载完成前为空，此时不绘制飞机
+    Impostor *p_plane_impostor;     // 远处的飞机画成公告板
+    StreamAllocation impostor_instances;    // 本帧的公告板实例，在流式缓冲中按飞机总数分配，直接写入
+    uint32_t impostor_count;
+    std::vector<Animator *> p_plane_animators;  // 每架飞机的动画播放器，模型没有动画时为空
+    InstanceBuffer *p_plane_instances;  // 按网格绘制的飞机，同一LOD的实例连续存放
+    GpuCuller *p_plane_culler;          // 网格飞机的GPU剔除，驱动或模型不支持时为空，在CPU上选择LOD
+    // 一架按网格绘制的飞机，按LOD排序后写入实例缓冲
+    struct PlaneDraw {
+        uint32_t lod;
+        uint32_t plane;
+        float depth;    // 到相机的距离除以远裁剪面距离
+        QMatrix4x4 model;
+    };
+    std::vector<PlaneDraw> plane_draws;
+    // 同一LOD的一组飞机在实例缓冲中的范围
+    struct PlaneGroup {
+        uint32_t first;
+        uint32_t count;
+        uint32_t lod;
+    };
+    std::vector<PlaneGroup> plane_groups;
+    QElapsedTimer frame_clock;      // 动画时钟
     Camera *p_camera;
 
     ObjectPose *p_plane_pose_0;
     ObjectPose *p_plane_pose_1;
-    ObjectPose *p_plane_pose_array[2];
+    std::vector<ObjectPose *> p_plane_pose_array;  // 所有飞机，前两架由键盘控制
+
+    ConflictDetector *p_conflict_detector;  // 飞行冲突预测
+    QElapsedTimer conflict_clock;           // 冲突检测时钟，按固定频率采样位姿
+    qint64 conflict_last_ms = 0;
 
     bool w_pressed = false, a_pressed = false, s_pressed = false, d_pressed = false, q_pressed = false, e_pressed = false;
     bool up_pressed = false, down_pressed = false, left_pressed = false, right_pressed = false, z_pressed = false, c_pressed = false;
 
     uint plane_select = 0;
 
+signals:
+    /**
+      * @brief  一帧绘制完成，报告状态缓存发出和省下的OpenGL调用数量
+      * @author agent
+      * @param  issued: 实际发出的调用数量
+      * @param  saved: 省下的冗余调用数量
+      * @retval none
+      */
+    void StateCallsCounted(uint issued, uint saved);
+
+    /**
+      * @brief  一帧绘制完成，报告渲染图临时纹理占用的显存
+      * @author agent
+      * @param  peak: 别名后实际占用的字节数
+      * @param  unaliased: 每个临时纹理单独分配时所需的字节数
+      * @retval none
+      */
+    void TransientMemoryCounted(qulonglong peak, qulonglong unaliased);
+
 public slots:
     void OnRefreshTimeout(void);
 
+    /**
+      * @brief  模型加载完成：替换当前模型，重新创建剔除器、公告板和动画播放器，在paintGL中调用，上下文为当前
+      * @author agent
+      * @param  request: 请求编号
+      * @param  model: 模型句柄
+      * @retval none
+      */
+    void OnModelLoaded(int request, std::shared_ptr<Model> model);
+
+    /**
+      * @brief  切换飞机模型：取消尚未完成的上一次请求，在后台加载新模型，完成后由OnModelLoaded替换
+      * @author agent
+      * @param  path: 模型路径，可以是磁盘文件或Qt资源
+      * @retval none
+      */
+    void LoadPlaneModel(const QString &path);
+
 };
 
 #endif // MYOPENGLWIDGET_H
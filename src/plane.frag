@@ -1,42 +1,60 @@
 #version 450 core
 
-struct Light {
-    vec3 position;
-    vec3 color;
-};
-
-struct Material {
-    vec3 color;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
 out vec4 FragColor;
 
-uniform Light light;
-uniform Material material;
-uniform vec3 view_pos;
+// 逐帧数据，由FrameUniforms每帧上传一次，布局须与FrameData一致
+layout (std140, binding = 0) uniform FrameBlock
+{
+    mat4 projection;
+    mat4 view;
+    vec4 view_pos;
+    vec4 light_position;
+    vec4 light_color;
+};
+// 材质参数，由Material在加载时写入，绘制时切换绑定
+layout (std140, binding = 1) uniform MaterialBlock
+{
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+    float shininess;
+} material;
 
 in vec2 TexCoords;
 in vec3 Normal;
 in vec3 FragPos;
+flat in vec3 InstanceColor;
+flat in vec3 InstanceDiffuse;
+
+#ifdef FEATURE_TEXTURED
+// 材质的第一张漫反射纹理，单元与kMaterialDiffuseUnit一致
+layout (binding = 0) uniform sampler2D texture_diffuse1;
+#endif
 
 void main() {
 
+    vec3 albedo = InstanceColor;
+#ifdef FEATURE_TEXTURED
+    albedo *= texture(texture_diffuse1, TexCoords).rgb;
+#endif
+
+#ifdef FEATURE_LIT
     // ambient
-    vec3 ambient = material.ambient * light.color;
+    vec3 ambient = material.ambient.rgb * light_color.rgb;
     // diffuse
     vec3 norm = normalize(Normal);
-    vec3 light_dir = normalize(light.position - FragPos).xyz;
+    vec3 light_dir = normalize(light_position.xyz - FragPos);
     float diff = max(dot(norm, light_dir), 0.0);
-    vec3 diffuse = diff * light.color * material.diffuse;
+    vec3 diffuse = diff * light_color.rgb * material.diffuse.rgb * InstanceDiffuse;
     // specular
-    vec3 view_dir = normalize(view_pos - FragPos);
+    vec3 view_dir = normalize(view_pos.xyz - FragPos);
     vec3 reflect_dir = reflect(-light_dir, norm);
-    float spec = pow(max(dot(view_dir, reflect_dir), 0.0), 1.0);
-    vec3 specular =  spec * light.color * material.specular;
+    float spec = pow(max(dot(view_dir, reflect_dir), 0.0), material.shininess);
+    vec3 specular =  spec * light_color.rgb * material.specular.rgb;
 
-    vec3 result = (ambient + diffuse + specular) * material.color;
+    vec3 result = (ambient + diffuse + specular) * albedo;
+#else
+    vec3 result = albedo;
+#endif
     FragColor = vec4(result, 1.0);
 }
@@ -1,20 +1,140 @@
 #version 450 core 
+#extension GL_ARB_shader_draw_parameters : enable
 
 layout (location = 0) in vec3 aPos; 
-layout (location = 1) in vec3 aNormal;
+layout (location = 1) in vec2 aNormalOct;
 layout (location = 2) in vec2 aTexCoords;
 
 out vec3 Normal;
 out vec3 FragPos;
 out vec2 TexCoords;
+flat out vec3 InstanceColor;
+flat out vec3 InstanceDiffuse;
+
+// 逐帧数据，由FrameUniforms每帧上传一次，布局须与FrameData一致
+layout (std140, binding = 0) uniform FrameBlock
+{
+    mat4 projection;
+    mat4 view;
+    vec4 view_pos;
+    vec4 light_position;
+    vec4 light_color;
+};
+// 逐绘制数据，由共享几何池按绘制槽位存放
+// 顶点位置还原：网格包围盒的最小角和边长
+// node_transform为网格所在场景图节点相对模型的变换，node_index为该节点的编号
+// skin_base加上gl_VertexID为顶点的蒙皮数据位置，无蒙皮时为-1
+struct DrawData
+{
+    vec4 position_offset;
+    vec4 position_scale;
+    mat4 node_transform;
+    int node_index;
+    int skin_base;
+    int pad0;
+    int pad1;
+};
+layout (std430, binding = 0) readonly buffer DrawDataBlock
+{
+    DrawData draw_data[];
+};
+
+// 每个实例的数据：模型矩阵、法线矩阵（模型矩阵线性部分的逆转置）和材质
+// animation_base为该实例的动画矩阵起点，无动画时为-1，之后依次为各节点的世界变换，从bone_base起为骨骼的蒙皮矩阵
+struct ModelInstance
+{
+    mat4 model;
+    vec4 normal_matrix[3];
+    vec4 color;
+    vec4 diffuse;
+    int animation_base;
+    int bone_base;
+    int pad0;
+    int pad1;
+};
+layout (std430, binding = 3) readonly buffer InstanceBlock
+{
+    ModelInstance instances[];
+};
+uniform int instance_base;
+
+#ifdef FEATURE_GPU_CULLED
+// GPU剔除后各级LOD的可见实例编号（相对instance_base），第l级从l * cull_capacity开始
+// 模型的槽位按LOD分组，第l级第i个网格为cull_first_slot + l * cull_mesh_count + i，由槽位得到LOD
+layout (std430, binding = 4) readonly buffer VisibleBlock
+{
+    uint visible_instances[];
+};
+uniform int cull_first_slot;
+uniform int cull_mesh_count;
+uniform int cull_capacity;
+#endif
+
+#ifdef FEATURE_ANIMATED
+// 所有实例的动画矩阵拼接在一起
+layout (std430, binding = 1) readonly buffer AnimationBlock
+{
+    mat4 animation_matrices[];
+};
+// 每个顶点的蒙皮数据：x为4个8位骨骼编号，y为4个8位归一化权重
+layout (std430, binding = 2) readonly buffer SkinBlock
+{
+    uvec2 skin_data[];
+};
+#endif
+// 间接绘制时每条命令的base_instance为其槽位，不支持该扩展时逐命令绘制并设置draw_id
+#ifdef GL_ARB_shader_draw_parameters
+#define DRAW_ID gl_BaseInstanceARB
+#else
+uniform int draw_id;
+#define DRAW_ID draw_id
+#endif
+
+// 八面体编码法线的解码
+vec3 OctDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
 
-uniform mat4 model; 
-uniform mat4 view; 
-uniform mat4 projection; 
 void main()
 { 
+    DrawData draw = draw_data[DRAW_ID];
+#ifdef FEATURE_GPU_CULLED
+    int lod = (DRAW_ID - cull_first_slot) / cull_mesh_count;
+    ModelInstance instance = instances[instance_base + int(visible_instances[lod * cull_capacity + gl_InstanceID])];
+#else
+    ModelInstance instance = instances[instance_base + gl_InstanceID];
+#endif
+    vec3 pos = aPos * draw.position_scale.xyz + draw.position_offset.xyz;
+    mat4 node = draw.node_transform;
+#ifdef FEATURE_ANIMATED
+    if (instance.animation_base >= 0)
+    {
+        if (draw.skin_base >= 0)
+        {
+            uvec2 skin = skin_data[draw.skin_base + gl_VertexID];
+            vec4 weights = unpackUnorm4x8(skin.y);
+            node = mat4(0.0);
+            for (int k = 0; k < 4; k++)
+                node += weights[k] * animation_matrices[instance.bone_base + int((skin.x >> (8 * k)) & 0xFFu)];
+        }
+        else
+        {
+            node = animation_matrices[instance.animation_base + draw.node_index];
+        }
+    }
+#endif
+    mat4 world = instance.model * node;
+    // 节点变换不含非均匀缩放，其线性部分与逆转置只差一个缩放，片元着色器中会重新归一化
+    mat3 normal_matrix = mat3(instance.normal_matrix[0].xyz, instance.normal_matrix[1].xyz, instance.normal_matrix[2].xyz);
     TexCoords = aTexCoords;
-    Normal = mat3(transpose(inverse(model))) * aNormal;
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    InstanceColor = instance.color.rgb;
+    InstanceDiffuse = instance.diffuse.rgb;
+    Normal = normal_matrix * (mat3(node) * OctDecode(aNormalOct));
+    FragPos = vec3(world * vec4(pos, 1.0));
+    gl_Position = projection * view * vec4(FragPos, 1.0);
 } 
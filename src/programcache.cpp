@@ -0,0 +1,248 @@
+#include "programcache.h"
+#include "meshcache.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QOpenGLContext>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <cstring>
+
+namespace {
+
+const char kProgramCacheMagic[8] = {'P', 'G', 'P', 'R', 'O', 'G', '\0', '\0'};
+
+// GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile，不在4.5核心函数中
+typedef void (APIENTRY *MaxShaderCompilerThreadsFunction)(GLuint count);
+
+} // namespace
+
+ProgramCache::ProgramCache(QOpenGLFunctions_4_5_Core *gl_funs)
+    : p_gl_funs(gl_funs), binary_supported(false)
+{
+    // 驱动升级后二进制可能不再兼容，驱动字符串计入键
+    driver_hash = MeshCache::Hash(nullptr, 0);
+    const GLenum names[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    for (GLenum name : names)
+    {
+        const char *value = reinterpret_cast<const char *>(p_gl_funs->glGetString(name));
+        if (value != nullptr)
+            driver_hash = MeshCache::Hash(value, std::strlen(value) + 1, driver_hash);
+    }
+
+    GLint format_count = 0;
+    p_gl_funs->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+    binary_supported = format_count > 0;
+
+    cache_dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/programcache";
+    QDir().mkpath(cache_dir);
+
+    // 并行编译：驱动在后台线程编译，查询状态时才等待
+    QOpenGLContext *p_context = QOpenGLContext::currentContext();
+    const char *function_name = nullptr;
+    if (p_context->hasExtension("GL_KHR_parallel_shader_compile"))
+        function_name = "glMaxShaderCompilerThreadsKHR";
+    else if (p_context->hasExtension("GL_ARB_parallel_shader_compile"))
+        function_name = "glMaxShaderCompilerThreadsARB";
+    if (function_name != nullptr)
+    {
+        MaxShaderCompilerThreadsFunction max_threads =
+            reinterpret_cast<MaxShaderCompilerThreadsFunction>(p_context->getProcAddress(function_name));
+        if (max_threads != nullptr)
+            max_threads(0xFFFFFFFFu);
+    }
+}
+
+void ProgramCache::Add(QOpenGLShaderProgram *p_program, const QString &vertex_path, const QString &fragment_path,
+                       const QStringList &defines)
+{
+    const GLenum stage_types[2] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER};
+    const QString paths[2] = {vertex_path, fragment_path};
+    AddStages(p_program, stage_types, paths, 2, defines);
+}
+
+void ProgramCache::AddCompute(QOpenGLShaderProgram *p_program, const QString &compute_path, const QStringList &defines)
+{
+    const GLenum stage_type = GL_COMPUTE_SHADER;
+    AddStages(p_program, &stage_type, &compute_path, 1, defines);
+}
+
+void ProgramCache::AddStages(QOpenGLShaderProgram *p_program, const GLenum *stage_types, const QString *paths, uint32_t stage_count,
+                             const QStringList &defines)
+{
+    ProgramRequest request;
+    request.p_program = p_program;
+    request.stage_count = stage_count;
+    request.name = QFileInfo(paths[0]).completeBaseName();
+    if (!defines.isEmpty())
+        request.name += "[" + defines.join(",") + "]";
+    request.shaders[0] = request.shaders[1] = 0;
+
+    request.key = driver_hash;
+    for (uint32_t i = 0; i < stage_count; i++)
+    {
+        request.stage_types[i] = stage_types[i];
+        QFile file(paths[i]);
+        if (file.open(QIODevice::ReadOnly))
+            request.sources[i] = InjectDefines(file.readAll(), defines);
+        else
+            qDebug() << "ProgramCache: cannot read shader" << paths[i];
+        request.key = MeshCache::Hash(&stage_types[i], sizeof(stage_types[i]), request.key);
+        request.key = MeshCache::Hash(request.sources[i].constData(), request.sources[i].size(), request.key);
+    }
+    requests.push_back(request);
+}
+
+bool ProgramCache::Build(void)
+{
+    // 先提交全部需要编译的程序，再逐个等待，各程序的编译互相重叠
+    for (ProgramRequest &request : requests)
+    {
+        request.p_program->create();
+        if (!Load(request))
+            Compile(request);
+    }
+
+    bool success = true;
+    for (ProgramRequest &request : requests)
+    {
+        if (request.shaders[0] != 0 && !Finish(request))
+            success = false;
+    }
+    requests.clear();
+    return success;
+}
+
+bool ProgramCache::Load(ProgramRequest &request)
+{
+    if (!binary_supported)
+        return false;
+    QFile file(CachePath(request.key));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    const QByteArray bytes = file.readAll();
+    file.close();
+
+    ProgramCacheHeader header;
+    if ((size_t)bytes.size() < sizeof(header))
+        return false;
+    std::memcpy(&header, bytes.constData(), sizeof(header));
+    if (std::memcmp(header.magic, kProgramCacheMagic, sizeof(kProgramCacheMagic)) != 0 ||
+        header.version != kProgramCacheVersion ||
+        header.key != request.key ||
+        (size_t)bytes.size() != sizeof(header) + header.binary_size)
+    {
+        qDebug() << "ProgramCache: stale cache" << request.name;
+        return false;
+    }
+
+    // 驱动可以拒绝任何二进制（如驱动更新但版本字符串未变），此时程序处于未链接状态，照常编译即可
+    const GLuint program = request.p_program->programId();
+    p_gl_funs->glProgramBinary(program, header.binary_format, bytes.constData() + sizeof(header), (GLsizei)header.binary_size);
+    GLint status = GL_FALSE;
+    p_gl_funs->glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE)
+    {
+        qDebug() << "ProgramCache: binary rejected" << request.name;
+        return false;
+    }
+    // 程序已链接，没有添加着色器时link()只查询链接状态
+    return request.p_program->link();
+}
+
+void ProgramCache::Compile(ProgramRequest &request)
+{
+    const GLuint program = request.p_program->programId();
+    for (uint32_t i = 0; i < request.stage_count; i++)
+    {
+        request.shaders[i] = p_gl_funs->glCreateShader(request.stage_types[i]);
+        const char *source = request.sources[i].constData();
+        const GLint length = request.sources[i].size();
+        p_gl_funs->glShaderSource(request.shaders[i], 1, &source, &length);
+        p_gl_funs->glCompileShader(request.shaders[i]);
+        p_gl_funs->glAttachShader(program, request.shaders[i]);
+    }
+    if (binary_supported)
+        p_gl_funs->glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    p_gl_funs->glLinkProgram(program);
+}
+
+bool ProgramCache::Finish(ProgramRequest &request)
+{
+    // link()查询链接状态，失败时重新链接以取得日志
+    const GLuint program = request.p_program->programId();
+    const bool linked = request.p_program->link();
+    if (!linked)
+    {
+        for (uint32_t i = 0; i < request.stage_count; i++)
+        {
+            const unsigned int shader = request.shaders[i];
+            GLint length = 0;
+            p_gl_funs->glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+            if (length > 1)
+            {
+                QByteArray log(length, '\0');
+                p_gl_funs->glGetShaderInfoLog(shader, length, nullptr, log.data());
+                qDebug() << "ERR: " << request.name << log;
+            }
+        }
+        qDebug() << "ERR: " << request.name << request.p_program->log();
+    }
+    for (uint32_t i = 0; i < request.stage_count; i++)
+    {
+        p_gl_funs->glDetachShader(program, request.shaders[i]);
+        p_gl_funs->glDeleteShader(request.shaders[i]);
+        request.shaders[i] = 0;
+    }
+    if (!linked || !binary_supported)
+        return linked;
+
+    GLint length = 0;
+    p_gl_funs->glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return true;
+    ProgramCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kProgramCacheMagic, sizeof(kProgramCacheMagic));
+    header.version = kProgramCacheVersion;
+    header.key = request.key;
+    QByteArray binary(length, '\0');
+    GLsizei written = 0;
+    p_gl_funs->glGetProgramBinary(program, length, &written, &header.binary_format, binary.data());
+    header.binary_size = (uint32_t)written;
+
+    // QSaveFile先写临时文件再原子替换，中途失败不会留下损坏的缓存
+    QSaveFile file(CachePath(request.key));
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qDebug() << "ProgramCache: cannot write" << request.name;
+        return true;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(binary.constData(), written);
+    file.commit();
+    return true;
+}
+
+QByteArray ProgramCache::InjectDefines(const QByteArray &source, const QStringList &defines)
+{
+    if (defines.isEmpty())
+        return source;
+    QByteArray block;
+    for (const QString &define : defines)
+        block += "#define " + define.toUtf8() + "\n";
+    // #version必须是第一条语句，宏定义放在它的下一行
+    const int version = source.indexOf("#version");
+    const int line_end = version < 0 ? -1 : source.indexOf('\n', version);
+    if (line_end < 0)
+        return block + source;
+    QByteArray out = source;
+    out.insert(line_end + 1, block);
+    return out;
+}
+
+QString ProgramCache::CachePath(uint64_t key) const
+{
+    return QString("%1/%2.pgprog").arg(cache_dir).arg(QString::number((qulonglong)key, 16));
+}
@@ -0,0 +1,151 @@
+/**
+  ******************************************************************************
+  * @file           : programcache.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了着色器程序二进制缓存类的定义。程序以着色器源码、宏定义和驱动的厂商、渲染器、
+  * 版本字符串的哈希为键，链接后用glGetProgramBinary保存到磁盘，再次启动时用glProgramBinary直接载入，
+  * 跳过编译和链接；缓存缺失、过期或被驱动拒绝时退回从源码编译。
+  * 需要编译的程序先全部提交编译和链接，再逐个查询结果，驱动支持并行编译时各程序同时编译
+  ******************************************************************************
+  * @attention
+  *     缓存文件格式：ProgramCacheHeader | 程序二进制；
+  * 程序载入后仍通过QOpenGLShaderProgram::link()登记为已链接，之后照常查询uniform位置；
+  * 需要在OpenGL上下文为当前时构建
+  ******************************************************************************
+  */
+
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include <QByteArray>
+#include <QOpenGLFunctions_4_5_Core>
+#include <QOpenGLShaderProgram>
+#include <QString>
+#include <QStringList>
+#include <cstdint>
+#include <vector>
+
+// 缓存格式版本号
+const uint32_t kProgramCacheVersion = 1;
+
+// 缓存文件头
+struct ProgramCacheHeader {
+    char magic[8];              // "PGPROG\0\0"
+    uint32_t version;           // 缓存格式版本号
+    uint32_t binary_format;     // glGetProgramBinary给出的格式
+    uint64_t key;               // 源码、宏定义和驱动的哈希
+    uint32_t binary_size;       // 程序二进制长度
+    uint32_t padding;
+};
+
+class ProgramCache
+{
+public:
+    /**
+      * @brief  构造函数，读取驱动信息并在支持时开启并行编译
+      * @author agent
+      * @param  gl_funs: OpenGL函数指针
+      * @retval none
+      */
+    explicit ProgramCache(QOpenGLFunctions_4_5_Core *gl_funs);
+
+    /**
+      * @brief  登记一个由顶点和片段着色器组成的程序，Build时统一构建
+      * @author agent
+      * @param  p_program: 着色器程序，尚未添加着色器
+      * @param  vertex_path: 顶点着色器源文件
+      * @param  fragment_path: 片段着色器源文件
+      * @param  defines: 插入在#version之后的宏定义，形如"NAME"或"NAME VALUE"
+      * @retval none
+      */
+    void Add(QOpenGLShaderProgram *p_program, const QString &vertex_path, const QString &fragment_path,
+             const QStringList &defines = QStringList());
+
+    /**
+      * @brief  登记一个只有计算着色器的程序，Build时统一构建
+      * @author agent
+      * @param  p_program: 着色器程序，尚未添加着色器
+      * @param  compute_path: 计算着色器源文件
+      * @param  defines: 插入在#version之后的宏定义
+      * @retval none
+      */
+    void AddCompute(QOpenGLShaderProgram *p_program, const QString &compute_path, const QStringList &defines = QStringList());
+
+    /**
+      * @brief  构建所有登记的程序：先从缓存载入，其余并行编译链接后写入缓存
+      * @author agent
+      * @param  none
+      * @retval 是否全部成功，失败的程序的日志输出到调试信息
+      */
+    bool Build(void);
+
+private:
+    // 一个登记的程序，由1个（计算）或2个（顶点和片段）着色器组成
+    struct ProgramRequest {
+        QOpenGLShaderProgram *p_program;
+        uint32_t stage_count;
+        GLenum stage_types[2];
+        QByteArray sources[2];      // 各着色器源码，已插入宏定义
+        QString name;               // 调试信息中的名字
+        uint64_t key;
+        unsigned int shaders[2];    // 编译中的着色器对象，从缓存载入时为0
+    };
+
+    /**
+      * @brief  读取源码并计算键后登记程序
+      * @author agent
+      * @param  p_program: 着色器程序
+      * @param  stage_types: 各着色器的类型
+      * @param  paths: 各着色器的源文件
+      * @param  stage_count: 着色器数量
+      * @param  defines: 宏定义
+      * @retval none
+      */
+    void AddStages(QOpenGLShaderProgram *p_program, const GLenum *stage_types, const QString *paths, uint32_t stage_count,
+                   const QStringList &defines);
+
+    /**
+      * @brief  从缓存载入程序二进制
+      * @author agent
+      * @param  request: 程序
+      * @retval 是否命中且被驱动接受
+      */
+    bool Load(ProgramRequest &request);
+
+    /**
+      * @brief  提交编译和链接，不等待结果
+      * @author agent
+      * @param  request: 程序
+      * @retval none
+      */
+    void Compile(ProgramRequest &request);
+
+    /**
+      * @brief  等待链接结果，成功时保存程序二进制，删除着色器对象
+      * @author agent
+      * @param  request: 程序
+      * @retval 是否链接成功
+      */
+    bool Finish(ProgramRequest &request);
+
+    /**
+      * @brief  在源码的#version之后插入宏定义
+      * @author agent
+      * @param  source: 源码
+      * @param  defines: 宏定义
+      * @retval 插入后的源码
+      */
+    static QByteArray InjectDefines(const QByteArray &source, const QStringList &defines);
+
+    QString CachePath(uint64_t key) const;
+
+    QOpenGLFunctions_4_5_Core *p_gl_funs;
+    uint64_t driver_hash;       // 厂商、渲染器和版本字符串的哈希
+    bool binary_supported;      // 驱动是否提供程序二进制格式
+    QString cache_dir;
+    std::vector<ProgramRequest> requests;
+};
+
+#endif // PROGRAMCACHE_H
@@ -0,0 +1,428 @@
+#include "rendergraph.h"
+#include "glstatecache.h"
+#include <QDebug>
+#include <algorithm>
+
+RenderGraph::RenderGraph(QOpenGLFunctions_4_5_Core *gl_funs)
+    : executed_passes(0), culled_passes(0), peak_transient_bytes(0), unaliased_transient_bytes(0),
+      p_gl_funs(gl_funs), p_gl_state(&GLStateCache::Current()), pass_count(0)
+{
+}
+
+RenderGraph::~RenderGraph()
+{
+    for (const auto &framebuffer : framebuffers)
+        p_gl_funs->glDeleteFramebuffers(1, &framebuffer.second.fbo);
+    for (const PhysicalTexture &physical : physical_textures)
+        p_gl_state->DeleteTextures(1, &physical.texture);
+}
+
+void RenderGraph::Reset(void)
+{
+    // 通道只计数清零，读写数组在AddPass复用时清空，保留容量
+    pass_count = 0;
+    resources.clear();
+    order.clear();
+}
+
+uint32_t RenderGraph::CreateTexture(const char *name, int width, int height, GLenum format)
+{
+    resources.push_back(Resource{name, RENDER_RESOURCE_TRANSIENT, width, height, format, 0, -1, -1, false, 0});
+    return (uint32_t)resources.size() - 1;
+}
+
+uint32_t RenderGraph::ImportTexture(const char *name, unsigned int texture, int width, int height)
+{
+    resources.push_back(Resource{name, RENDER_RESOURCE_TEXTURE, width, height, GL_NONE, texture, -1, -1, false, 0});
+    return (uint32_t)resources.size() - 1;
+}
+
+uint32_t RenderGraph::ImportFramebuffer(const char *name, unsigned int fbo)
+{
+    resources.push_back(Resource{name, RENDER_RESOURCE_FRAMEBUFFER, 0, 0, GL_NONE, fbo, -1, -1, false, 0});
+    return (uint32_t)resources.size() - 1;
+}
+
+uint32_t RenderGraph::CreateBuffer(const char *name)
+{
+    resources.push_back(Resource{name, RENDER_RESOURCE_BUFFER, 0, 0, GL_NONE, 0, -1, -1, false, 0});
+    return (uint32_t)resources.size() - 1;
+}
+
+uint32_t RenderGraph::AddPass(const char *name, RenderGraphPass *p_executor, uint32_t id, uint32_t param)
+{
+    if (pass_count == passes.size())
+        passes.emplace_back();
+    Pass &pass = passes[pass_count];
+    pass.name = name;
+    pass.p_executor = p_executor;
+    pass.id = id;
+    pass.param = param;
+    pass.reads.clear();
+    pass.writes.clear();
+    pass.needed = false;
+    return pass_count++;
+}
+
+void RenderGraph::Read(uint32_t pass, uint32_t resource, GLbitfield barriers)
+{
+    passes[pass].reads.push_back(Access{resource, barriers != 0 ? barriers : GL_ALL_BARRIER_BITS, GL_NONE});
+}
+
+void RenderGraph::Write(uint32_t pass, uint32_t resource, GLenum attachment)
+{
+    passes[pass].writes.push_back(Access{resource, 0, attachment});
+}
+
+void RenderGraph::Execute(void)
+{
+    if (!Sort())
+        qDebug() << "RenderGraph: cyclic pass dependencies, using declaration order";
+    Cull();
+    Allocate();
+
+    executed_passes = 0;
+    culled_passes = 0;
+    for (uint32_t index : order)
+    {
+        Pass &pass = passes[index];
+        if (!pass.needed)
+        {
+            culled_passes++;
+            continue;
+        }
+        // 着色器写入之后的读取需要屏障，同一次写入的多个读者只补上还没有插入过的位
+        GLbitfield barriers = 0;
+        for (const Access &read : pass.reads)
+        {
+            Resource &resource = resources[read.resource];
+            if (resource.storage_written)
+            {
+                barriers |= read.barriers & ~resource.synced_barriers;
+                resource.synced_barriers |= read.barriers;
+            }
+        }
+        for (const Access &write : pass.writes)
+        {
+            Resource &resource = resources[write.resource];
+            if (write.attachment != GL_NONE && resource.storage_written &&
+                (resource.synced_barriers & GL_FRAMEBUFFER_BARRIER_BIT) == 0)
+            {
+                barriers |= GL_FRAMEBUFFER_BARRIER_BIT;
+                resource.synced_barriers |= GL_FRAMEBUFFER_BARRIER_BIT;
+            }
+        }
+        if (barriers != 0)
+            p_gl_funs->glMemoryBarrier(barriers);
+
+        BindFramebuffer(pass);
+        pass.p_executor->ExecutePass(pass.id, pass.param);
+        executed_passes++;
+
+        for (const Access &write : pass.writes)
+        {
+            Resource &resource = resources[write.resource];
+            if (write.attachment == GL_NONE && resource.type != RENDER_RESOURCE_FRAMEBUFFER)
+            {
+                resource.storage_written = true;
+                resource.synced_barriers = 0;
+            }
+        }
+    }
+
+    // 本帧没有绑定过的帧缓冲可能引用已删除的纹理，一并删除
+    for (auto it = framebuffers.begin(); it != framebuffers.end();)
+    {
+        if (it->second.used)
+        {
+            it->second.used = false;
+            ++it;
+        }
+        else
+        {
+            p_gl_funs->glDeleteFramebuffers(1, &it->second.fbo);
+            it = framebuffers.erase(it);
+        }
+    }
+}
+
+unsigned int RenderGraph::Texture(uint32_t resource) const
+{
+    const Resource &r = resources[resource];
+    if (r.type != RENDER_RESOURCE_TRANSIENT && r.type != RENDER_RESOURCE_TEXTURE)
+        return 0;
+    return r.object;
+}
+
+bool RenderGraph::Sort(void)
+{
+    // 每个资源的写者按声明顺序串联，每个写者指向只读不写的读者；
+    // 嵌套数组只增不减，缩小会释放内层数组的容量
+    if (successors.size() < pass_count)
+        successors.resize(pass_count);
+    for (uint32_t p = 0; p < pass_count; p++)
+        successors[p].clear();
+    indegrees.assign(pass_count, 0);
+    if (writers.size() < resources.size())
+    {
+        writers.resize(resources.size());
+        readers.resize(resources.size());
+    }
+    for (size_t r = 0; r < resources.size(); r++)
+    {
+        writers[r].clear();
+        readers[r].clear();
+    }
+    for (uint32_t p = 0; p < pass_count; p++)
+    {
+        for (const Access &write : passes[p].writes)
+        {
+            std::vector<uint32_t> &list = writers[write.resource];
+            if (list.empty() || list.back() != p)
+                list.push_back(p);
+        }
+    }
+    for (uint32_t p = 0; p < pass_count; p++)
+    {
+        for (const Access &read : passes[p].reads)
+        {
+            const std::vector<uint32_t> &list = writers[read.resource];
+            if (std::find(list.begin(), list.end(), p) == list.end())
+                readers[read.resource].push_back(p);
+        }
+    }
+    for (size_t r = 0; r < resources.size(); r++)
+    {
+        for (size_t w = 0; w < writers[r].size(); w++)
+        {
+            if (w + 1 < writers[r].size())
+            {
+                successors[writers[r][w]].push_back(writers[r][w + 1]);
+                indegrees[writers[r][w + 1]]++;
+            }
+            for (uint32_t reader : readers[r])
+            {
+                successors[writers[r][w]].push_back(reader);
+                indegrees[reader]++;
+            }
+        }
+    }
+
+    // 通道数量很少，每次从就绪的通道中取声明最早的一个
+    order.clear();
+    scheduled.assign(pass_count, false);
+    while (order.size() < pass_count)
+    {
+        uint32_t next = pass_count;
+        for (uint32_t p = 0; p < pass_count; p++)
+        {
+            if (!scheduled[p] && indegrees[p] == 0)
+            {
+                next = p;
+                break;
+            }
+        }
+        if (next == pass_count)
+        {
+            order.clear();
+            for (uint32_t p = 0; p < pass_count; p++)
+                order.push_back(p);
+            return false;
+        }
+        scheduled[next] = true;
+        order.push_back(next);
+        for (uint32_t successor : successors[next])
+            indegrees[successor]--;
+    }
+    return true;
+}
+
+void RenderGraph::Cull(void)
+{
+    live.assign(resources.size(), false);
+    for (auto it = order.rbegin(); it != order.rend(); ++it)
+    {
+        Pass &pass = passes[*it];
+        pass.needed = false;
+        for (const Access &write : pass.writes)
+        {
+            const Resource &resource = resources[write.resource];
+            if (resource.type == RENDER_RESOURCE_TEXTURE || resource.type == RENDER_RESOURCE_FRAMEBUFFER || live[write.resource])
+                pass.needed = true;
+        }
+        if (!pass.needed)
+            continue;
+        for (const Access &read : pass.reads)
+            live[read.resource] = true;
+    }
+}
+
+void RenderGraph::Allocate(void)
+{
+    // 生命周期：需要执行的通道中首次和末次读写的位置
+    for (Resource &resource : resources)
+    {
+        resource.first = -1;
+        resource.last = -1;
+        resource.storage_written = false;
+    }
+    for (int position = 0; position < (int)order.size(); position++)
+    {
+        const Pass &pass = passes[order[position]];
+        if (!pass.needed)
+            continue;
+        for (const std::vector<Access> *p_accesses : {&pass.reads, &pass.writes})
+        {
+            for (const Access &access : *p_accesses)
+            {
+                Resource &resource = resources[access.resource];
+                if (resource.type != RENDER_RESOURCE_TRANSIENT)
+                    continue;
+                if (resource.first < 0)
+                    resource.first = position;
+                resource.last = position;
+            }
+        }
+    }
+    transients.clear();
+    for (uint32_t r = 0; r < resources.size(); r++)
+    {
+        if (resources[r].type == RENDER_RESOURCE_TRANSIENT && resources[r].first >= 0)
+            transients.push_back(r);
+    }
+    // stable_sort会申请临时缓冲，首次使用相同时按编号排序，结果一致
+    std::sort(transients.begin(), transients.end(), [this](uint32_t a, uint32_t b) {
+        return resources[a].first != resources[b].first ? resources[a].first < resources[b].first : a < b;
+    });
+
+    // 按首次使用的顺序贪心分配：优先复用本帧已经用过且已空闲的物理纹理，其次是上一帧留下的，都没有时创建
+    for (PhysicalTexture &physical : physical_textures)
+        physical.free_after = -1;
+    unaliased_transient_bytes = 0;
+    for (uint32_t r : transients)
+    {
+        Resource &resource = resources[r];
+        unaliased_transient_bytes += TextureBytes(resource.width, resource.height, resource.format);
+        PhysicalTexture *p_best = nullptr;
+        for (PhysicalTexture &physical : physical_textures)
+        {
+            if (physical.width != resource.width || physical.height != resource.height || physical.format != resource.format ||
+                physical.free_after >= resource.first)
+                continue;
+            if (p_best == nullptr || physical.free_after > p_best->free_after)
+                p_best = &physical;
+        }
+        if (p_best == nullptr)
+        {
+            PhysicalTexture physical{0, resource.width, resource.height, resource.format,
+                                     TextureBytes(resource.width, resource.height, resource.format), -1};
+            p_gl_funs->glCreateTextures(GL_TEXTURE_2D, 1, &physical.texture);
+            p_gl_funs->glTextureStorage2D(physical.texture, 1, resource.format, resource.width, resource.height);
+            p_gl_funs->glTextureParameteri(physical.texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            p_gl_funs->glTextureParameteri(physical.texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            p_gl_funs->glTextureParameteri(physical.texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            p_gl_funs->glTextureParameteri(physical.texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            physical_textures.push_back(physical);
+            p_best = &physical_textures.back();
+        }
+        p_best->free_after = resource.last;
+        resource.object = p_best->texture;
+    }
+
+    // 本帧没有用到的物理纹理（如窗口尺寸变化前的）立即删除，显存跟随当前的需要
+    peak_transient_bytes = 0;
+    for (size_t i = 0; i < physical_textures.size();)
+    {
+        if (physical_textures[i].free_after < 0)
+        {
+            p_gl_state->DeleteTextures(1, &physical_textures[i].texture);
+            physical_textures.erase(physical_textures.begin() + i);
+            continue;
+        }
+        peak_transient_bytes += physical_textures[i].bytes;
+        i++;
+    }
+}
+
+void RenderGraph::BindFramebuffer(const Pass &pass)
+{
+    Attachments attachments;
+    attachments.fill(std::make_pair(GLenum(GL_NONE), 0u));
+    uint32_t attachment_count = 0;
+    int width = 0, height = 0;
+    for (const Access &write : pass.writes)
+    {
+        const Resource &resource = resources[write.resource];
+        if (resource.type == RENDER_RESOURCE_FRAMEBUFFER)
+        {
+            p_gl_funs->glBindFramebuffer(GL_FRAMEBUFFER, resource.object);
+            return;
+        }
+        if (write.attachment == GL_NONE || (resource.type != RENDER_RESOURCE_TRANSIENT && resource.type != RENDER_RESOURCE_TEXTURE) ||
+            attachment_count == kRenderGraphMaxAttachments)
+            continue;
+        attachments[attachment_count++] = std::make_pair(write.attachment, resource.object);
+        width = resource.width;
+        height = resource.height;
+    }
+    // 只由着色器写入的通道（如计算）不改变帧缓冲
+    if (attachment_count == 0)
+        return;
+    std::sort(attachments.begin(), attachments.end());
+
+    auto it = framebuffers.find(attachments);
+    if (it == framebuffers.end())
+    {
+        Framebuffer framebuffer{0, false};
+        p_gl_funs->glCreateFramebuffers(1, &framebuffer.fbo);
+        GLenum draw_buffers[kRenderGraphMaxAttachments];
+        GLsizei draw_buffer_count = 0;
+        for (const auto &attachment : attachments)
+        {
+            if (attachment.first == GL_NONE)
+                continue;
+            p_gl_funs->glNamedFramebufferTexture(framebuffer.fbo, attachment.first, attachment.second, 0);
+            if (attachment.first >= GL_COLOR_ATTACHMENT0 && attachment.first <= GL_COLOR_ATTACHMENT15)
+                draw_buffers[draw_buffer_count++] = attachment.first;
+        }
+        if (draw_buffer_count == 0)
+            p_gl_funs->glNamedFramebufferDrawBuffer(framebuffer.fbo, GL_NONE);
+        else
+            p_gl_funs->glNamedFramebufferDrawBuffers(framebuffer.fbo, draw_buffer_count, draw_buffers);
+        if (p_gl_funs->glCheckNamedFramebufferStatus(framebuffer.fbo, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            qDebug() << "RenderGraph: incomplete framebuffer for pass" << pass.name;
+        it = framebuffers.insert(std::make_pair(attachments, framebuffer)).first;
+    }
+    it->second.used = true;
+    p_gl_funs->glBindFramebuffer(GL_FRAMEBUFFER, it->second.fbo);
+    p_gl_funs->glViewport(0, 0, width, height);
+}
+
+size_t RenderGraph::TextureBytes(int width, int height, GLenum format)
+{
+    size_t bytes_per_pixel;
+    switch (format)
+    {
+    case GL_R8:
+        bytes_per_pixel = 1;
+        break;
+    case GL_RG8:
+    case GL_R16F:
+    case GL_DEPTH_COMPONENT16:
+        bytes_per_pixel = 2;
+        break;
+    case GL_RGBA16F:
+    case GL_RG32F:
+    case GL_DEPTH32F_STENCIL8:
+        bytes_per_pixel = 8;
+        break;
+    case GL_RGBA32F:
+        bytes_per_pixel = 16;
+        break;
+    default:
+        // RGBA8、R32F、RG16F、R11F_G11F_B10F以及24/32位深度，驱动一般按4字节存储
+        bytes_per_pixel = 4;
+        break;
+    }
+    return (size_t)width * height * bytes_per_pixel;
+}
@@ -0,0 +1,278 @@
+/**
+  ******************************************************************************
+  * @file           : rendergraph.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了渲染图的定义。每帧把各个通道（剔除、场景、覆盖层、离屏烘焙等）连同它们
+  * 读写的资源声明到图中，执行时由读写关系自动排序，剔除结果没有被使用的通道，在着色器写入与
+  * 之后的读取之间插入内存屏障，并为每个通道的附件组合绑定帧缓冲；临时纹理由图分配，
+  * 生命周期不重叠且格式和尺寸相同的临时纹理共用同一张物理纹理，并报告实际占用的显存
+  ******************************************************************************
+  * @attention
+  *     同一资源的所有写入先于所有读取，写入之间按声明顺序；
+  * 临时纹理的初始内容未定义，第一个写入它的通道须先清除，Texture只在通道回调中有效；
+  * OpenGL不能让不同格式的纹理共用存储，只有描述完全相同的临时纹理之间才会别名；
+  * 物理纹理和帧缓冲跨帧保留，本帧没有用到的在执行结束时删除；
+  * 通道和资源的名称只保存指针，须在Execute结束前有效（一般为字符串字面量）；
+  * 通道、资源和排序用的临时数组跨帧复用，通道数量和读写数量不增长时每帧不分配堆内存
+  ******************************************************************************
+  */
+
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+
+#include <QOpenGLFunctions_4_5_Core>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+class GLStateCache;
+
+// 资源种类
+typedef enum
+{
+    RENDER_RESOURCE_TRANSIENT,      // 临时纹理：由图分配，只在本帧内有效
+    RENDER_RESOURCE_TEXTURE,        // 外部纹理：由调用者持有，写入它的通道不会被剔除
+    RENDER_RESOURCE_FRAMEBUFFER,    // 外部帧缓冲（如QOpenGLWidget的默认帧缓冲），写入它的通道不会被剔除
+    RENDER_RESOURCE_BUFFER,         // 着色器写入的缓冲：由调用者持有，只在本帧内被读取
+} RenderResource_t;
+
+// 一个通道最多的帧缓冲附件数：8个颜色附件、深度和模板
+const uint32_t kRenderGraphMaxAttachments = 10;
+
+// 通道的执行者，渲染图排好序、插入屏障并绑定帧缓冲后回调
+class RenderGraphPass
+{
+public:
+    virtual ~RenderGraphPass() {}
+
+    /**
+      * @brief  执行一个通道
+      * @author agent
+      * @param  id: 添加通道时给出的通道类型
+      * @param  param: 添加通道时给出的参数
+      * @retval none
+      */
+    virtual void ExecutePass(uint32_t id, uint32_t param) = 0;
+};
+
+class RenderGraph
+{
+public:
+    /**
+      * @brief  构造函数
+      * @author agent
+      * @param  gl_funs: OpenGL函数指针
+      * @retval none
+      */
+    explicit RenderGraph(QOpenGLFunctions_4_5_Core *gl_funs);
+    ~RenderGraph();
+    RenderGraph(const RenderGraph &) = delete;
+    RenderGraph &operator=(const RenderGraph &) = delete;
+
+    /**
+      * @brief  清空通道和资源的声明，每帧开始时调用，保留物理纹理、帧缓冲以及各数组的容量
+      * @author agent
+      * @param  none
+      * @retval none
+      */
+    void Reset(void);
+
+    /**
+      * @brief  声明临时纹理（单层，无mip）
+      * @author agent
+      * @param  name: 名称，用于调试输出，只保存指针
+      * @param  width: 宽度（像素）
+      * @param  height: 高度（像素）
+      * @param  format: 内部格式，如GL_RGBA16F、GL_DEPTH_COMPONENT24
+      * @retval 资源编号
+      */
+    uint32_t CreateTexture(const char *name, int width, int height, GLenum format);
+
+    /**
+      * @brief  导入外部纹理，作为附件时绘制到0级
+      * @author agent
+      * @param  name: 名称
+      * @param  texture: 纹理对象
+      * @param  width: 0级宽度（像素）
+      * @param  height: 0级高度（像素）
+      * @retval 资源编号
+      */
+    uint32_t ImportTexture(const char *name, unsigned int texture, int width, int height);
+
+    /**
+      * @brief  导入外部帧缓冲，写入它的通道绑定该帧缓冲，视口保持不变
+      * @author agent
+      * @param  name: 名称
+      * @param  fbo: 帧缓冲对象
+      * @retval 资源编号
+      */
+    uint32_t ImportFramebuffer(const char *name, unsigned int fbo);
+
+    /**
+      * @brief  声明由着色器写入的缓冲，只用于排序、剔除和插入内存屏障
+      * @author agent
+      * @param  name: 名称
+      * @retval 资源编号
+      */
+    uint32_t CreateBuffer(const char *name);
+
+    /**
+      * @brief  添加通道
+      * @author agent
+      * @param  name: 名称，只保存指针
+      * @param  p_executor: 执行者，调用时帧缓冲和内存屏障已经就绪，须在Execute结束前有效
+      * @param  id: 回调时传回的通道类型
+      * @param  param: 回调时传回的参数
+      * @retval 通道编号
+      */
+    uint32_t AddPass(const char *name, RenderGraphPass *p_executor, uint32_t id, uint32_t param = 0);
+
+    /**
+      * @brief  声明通道读取资源
+      * @author agent
+      * @param  pass: 通道编号
+      * @param  resource: 资源编号
+      * @param  barriers: 资源被着色器写入后读取前需要的屏障（如GL_COMMAND_BARRIER_BIT），为0时使用GL_ALL_BARRIER_BITS
+      * @retval none
+      */
+    void Read(uint32_t pass, uint32_t resource, GLbitfield barriers = 0);
+
+    /**
+      * @brief  声明通道写入资源
+      * @author agent
+      * @param  pass: 通道编号
+      * @param  resource: 资源编号
+      * @param  attachment: 纹理作为帧缓冲附件的位置（GL_COLOR_ATTACHMENTi、GL_DEPTH_ATTACHMENT），
+      *                     GL_NONE表示由着色器写入（SSBO、图像）；写入外部帧缓冲时忽略；
+      *                     超过kRenderGraphMaxAttachments个的附件被忽略
+      * @retval none
+      */
+    void Write(uint32_t pass, uint32_t resource, GLenum attachment = GL_NONE);
+
+    /**
+      * @brief  排序、剔除、分配临时纹理，然后依次执行通道；结束后保留最后一个通道的帧缓冲和视口
+      * @author agent
+      * @param  none
+      * @retval none
+      */
+    void Execute(void);
+
+    /**
+      * @brief  资源对应的纹理对象，临时纹理为本帧分配到的物理纹理
+      * @author agent
+      * @param  resource: 资源编号
+      * @retval 纹理对象，不是纹理或未被使用时为0
+      */
+    unsigned int Texture(uint32_t resource) const;
+
+    // 最近一次执行的统计
+    uint32_t executed_passes;
+    uint32_t culled_passes;
+    size_t peak_transient_bytes;        // 临时纹理实际占用的显存，物理纹理整帧存在，即为峰值
+    size_t unaliased_transient_bytes;   // 每个临时纹理单独分配时所需的显存，与上一项一起由调用者显示
+
+private:
+    // 一次读写
+    struct Access {
+        uint32_t resource;
+        GLbitfield barriers;
+        GLenum attachment;
+    };
+    struct Pass {
+        const char *name;
+        RenderGraphPass *p_executor;
+        uint32_t id, param;
+        std::vector<Access> reads, writes;  // Reset时清空但保留容量
+        bool needed;
+    };
+    struct Resource {
+        const char *name;
+        RenderResource_t type;
+        int width, height;
+        GLenum format;
+        unsigned int object;        // 外部纹理或帧缓冲；临时纹理为分配到的物理纹理
+        int first, last;            // 临时纹理在执行顺序中的首次和末次使用，-1为未被使用
+        bool storage_written;       // 本帧被着色器写入过
+        GLbitfield synced_barriers; // 最近一次着色器写入之后已经插入的屏障
+    };
+    // 物理纹理，描述相同的临时纹理在生命周期不重叠时共用
+    struct PhysicalTexture {
+        unsigned int texture;
+        int width, height;
+        GLenum format;
+        size_t bytes;
+        int free_after;             // 本帧最后一个使用者的执行位置，-1为本帧未被使用
+    };
+    // 帧缓冲的附件组合：附件位置和纹理对象，整体排序后作为键，未用的项为{GL_NONE, 0}
+    typedef std::array<std::pair<GLenum, unsigned int>, kRenderGraphMaxAttachments> Attachments;
+    struct Framebuffer {
+        unsigned int fbo;
+        bool used;                  // 本帧被绑定过，没有的在执行结束时删除
+    };
+
+    /**
+      * @brief  按读写关系拓扑排序，同时可执行的通道按声明顺序，结果在order中
+      * @author agent
+      * @param  none
+      * @retval 是否无环，有环时order为声明顺序
+      */
+    bool Sort(void);
+
+    /**
+      * @brief  从执行顺序的末尾向前标记需要执行的通道：写入外部资源，或写入的资源被需要的通道读取
+      * @author agent
+      * @param  none
+      * @retval none
+      */
+    void Cull(void);
+
+    /**
+      * @brief  计算临时纹理的生命周期并分配物理纹理，删除本帧没有用到的物理纹理
+      * @author agent
+      * @param  none
+      * @retval none
+      */
+    void Allocate(void);
+
+    /**
+      * @brief  绑定通道写入的帧缓冲，附件组合第一次出现时创建帧缓冲
+      * @author agent
+      * @param  pass: 通道
+      * @retval none
+      */
+    void BindFramebuffer(const Pass &pass);
+
+    /**
+      * @brief  估算纹理占用的显存
+      * @author agent
+      * @param  width: 宽度
+      * @param  height: 高度
+      * @param  format: 内部格式
+      * @retval 字节数
+      */
+    static size_t TextureBytes(int width, int height, GLenum format);
+
+    QOpenGLFunctions_4_5_Core *p_gl_funs;
+    GLStateCache *p_gl_state;
+    std::vector<Pass> passes;                       // 前pass_count个为本帧的通道，其余留作复用
+    uint32_t pass_count;
+    std::vector<Resource> resources;
+    std::vector<uint32_t> order;                    // 执行顺序，包括被剔除的通道
+    std::vector<PhysicalTexture> physical_textures;
+    std::map<Attachments, Framebuffer> framebuffers;
+
+    // 排序、剔除和分配用的临时数组，跨帧复用；嵌套数组只增不减，保留内层容量
+    std::vector<std::vector<uint32_t>> successors;  // 每个通道之后必须执行的通道
+    std::vector<uint32_t> indegrees;
+    std::vector<std::vector<uint32_t>> writers, readers;    // 每个资源的写者和只读的读者
+    std::vector<bool> scheduled;
+    std::vector<bool> live;
+    std::vector<uint32_t> transients;
+};
+
+#endif // RENDERGRAPH_H
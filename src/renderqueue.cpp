@@ -0,0 +1,166 @@
+#include "renderqueue.h"
+#include "glstatecache.h"
+#include <algorithm>
+
+namespace {
+
+// 排序键各字段的位置和宽度
+const int kKeyPassShift = 60;
+const int kKeyProgramShift = 52;
+const int kKeyMaterialShift = 40;
+const int kKeyTextureShift = 28;
+const int kKeyDepthShift = 4;
+const uint64_t kKeyPassMask = 0xF;
+const uint64_t kKeyProgramMask = 0xFF;
+const uint64_t kKeyMaterialMask = 0xFFF;
+const uint64_t kKeyTextureMask = 0xFFF;
+const uint32_t kKeyDepthMax = 0xFFFFFF;
+
+// 执行时表示尚未绑定任何程序或视图
+const uint32_t kNoState = ~0u;
+
+} // namespace
+
+RenderQueue::RenderQueue(QOpenGLFunctions_4_5_Core *gl_funs, FrameUniforms *p_frame_uniforms)
+    : p_gl_funs(gl_funs), p_gl_state(&GLStateCache::Current()), p_frame_uniforms(p_frame_uniforms), sorted_valid(true)
+{
+}
+
+uint32_t RenderQueue::RegisterProgram(QOpenGLShaderProgram *p_program)
+{
+    programs.push_back(p_program);
+    return (uint32_t)programs.size() - 1;
+}
+
+void RenderQueue::SetProgram(uint32_t program, QOpenGLShaderProgram *p_program)
+{
+    programs[program] = p_program;
+}
+
+void RenderQueue::Clear(void)
+{
+    items.clear();
+    sorted.clear();
+    sorted_valid = true;
+}
+
+void RenderQueue::Submit(RenderPass_t pass, uint32_t program, const Material *p_material, unsigned int texture, float depth,
+                         uint32_t frame_view, Renderable *p_renderable, uint32_t id, uint32_t param)
+{
+    const uint32_t material = p_material ? p_material->sort_id : 0;
+    sorted.push_back(SortEntry{MakeKey(pass, program, material, texture, depth), (uint32_t)items.size()});
+    items.push_back(RenderItem{pass, program, frame_view, p_material, texture, p_renderable, id, param});
+    sorted_valid = false;
+}
+
+void RenderQueue::Execute(RenderPass_t first, RenderPass_t last)
+{
+    if (!sorted_valid)
+    {
+        Sort();
+        sorted_valid = true;
+    }
+
+    // 通道在排序键的最高位，范围内的绘制项连续存放
+    const uint64_t first_key = (uint64_t)first << kKeyPassShift;
+    auto begin = std::lower_bound(sorted.begin(), sorted.end(), first_key, [](const SortEntry &entry, uint64_t key) {
+        return entry.key < key;
+    });
+    uint32_t current_pass = kNoState, current_program = kNoState, current_view = kNoState;
+    const Material *p_current_material = nullptr;
+    unsigned int current_texture = 0;
+    for (auto it = begin; it != sorted.end(); ++it)
+    {
+        const RenderItem &item = items[it->item];
+        if (item.pass > (uint32_t)last)
+            break;
+        if (item.pass != current_pass)
+        {
+            ApplyPassState(item.pass);
+            current_pass = item.pass;
+        }
+        if (item.program != current_program)
+        {
+            p_gl_state->UseProgram(programs[item.program]->programId());
+            current_program = item.program;
+        }
+        if (item.frame_view != current_view)
+        {
+            p_frame_uniforms->Bind(item.frame_view);
+            current_view = item.frame_view;
+        }
+        if (item.p_material != nullptr && item.p_material != p_current_material)
+        {
+            // 材质的纹理可能占用0号单元
+            item.p_material->Bind();
+            p_current_material = item.p_material;
+            current_texture = 0;
+        }
+        if (item.texture != 0 && item.texture != current_texture)
+        {
+            p_gl_state->BindTextureUnit(0, item.texture);
+            current_texture = item.texture;
+        }
+
+        item.p_renderable->Render(*programs[item.program], item.id, item.param);
+
+        if (item.p_material == nullptr)
+        {
+            p_current_material = nullptr;
+            current_texture = 0;
+        }
+    }
+    // 下一帧仍从不透明通道的状态开始
+    if (current_pass != kNoState && current_pass != RENDER_PASS_OPAQUE)
+        ApplyPassState(RENDER_PASS_OPAQUE);
+}
+
+void RenderQueue::ApplyPassState(uint32_t pass)
+{
+    // 半透明物体按从远到近混合，不写深度，以免挡住其后的半透明物体
+    const bool transparent = pass == RENDER_PASS_TRANSPARENT;
+    p_gl_state->SetCapability(GL_DEPTH_TEST, true);
+    p_gl_state->DepthMask(transparent ? GL_FALSE : GL_TRUE);
+    p_gl_state->SetCapability(GL_BLEND, transparent);
+    if (transparent)
+        p_gl_state->BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+uint64_t RenderQueue::MakeKey(RenderPass_t pass, uint32_t program, uint32_t material, unsigned int texture, float depth)
+{
+    uint32_t quantized = (uint32_t)(std::min(std::max(depth, 0.0f), 1.0f) * kKeyDepthMax);
+    if (pass == RENDER_PASS_TRANSPARENT)
+        quantized = kKeyDepthMax - quantized;
+    return ((uint64_t)pass & kKeyPassMask) << kKeyPassShift |
+           ((uint64_t)program & kKeyProgramMask) << kKeyProgramShift |
+           ((uint64_t)material & kKeyMaterialMask) << kKeyMaterialShift |
+           ((uint64_t)texture & kKeyTextureMask) << kKeyTextureShift |
+           (uint64_t)quantized << kKeyDepthShift;
+}
+
+void RenderQueue::Sort(void)
+{
+    const size_t count = sorted.size();
+    if (count < 2)
+        return;
+    scratch.resize(count);
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        size_t offsets[256] = {0};
+        for (const SortEntry &entry : sorted)
+            offsets[(entry.key >> shift) & 0xFF]++;
+        // 所有键在这8位上相同，本趟不改变顺序
+        if (offsets[(sorted[0].key >> shift) & 0xFF] == count)
+            continue;
+        size_t offset = 0;
+        for (size_t &bucket : offsets)
+        {
+            const size_t bucket_count = bucket;
+            bucket = offset;
+            offset += bucket_count;
+        }
+        for (const SortEntry &entry : sorted)
+            scratch[offsets[(entry.key >> shift) & 0xFF]++] = entry;
+        sorted.swap(scratch);
+    }
+}
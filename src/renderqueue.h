@@ -0,0 +1,174 @@
+/**
+  ******************************************************************************
+  * @file           : renderqueue.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了渲染队列的定义。各部分每帧把要画的东西作为绘制项提交到队列，
+  * 每个绘制项带一个64位排序键（通道、着色器程序、材质、纹理、深度），队列用基数排序后依次执行，
+  * 相邻绘制项之间只切换变化了的状态（着色器程序、逐帧视图、材质、纹理），
+  * 绘制顺序不再写死在paintGL中，新增场景物体或特效只需要提交新的绘制项
+  ******************************************************************************
+  * @attention
+  *     排序键从高到低：通道4位、程序8位、材质12位、纹理12位、深度24位，低4位保留；
+  * 不透明通道按深度从近到远，透明通道从远到近；键相同的绘制项保持提交顺序；
+  * 材质为空的绘制项自己绑定材质和纹理（如按批次切换材质的模型），执行后队列不再假定材质和纹理状态
+  ******************************************************************************
+  */
+
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include "frameuniforms.h"
+#include "material.h"
+#include <QOpenGLFunctions_4_5_Core>
+#include <QOpenGLShaderProgram>
+#include <cstdint>
+#include <vector>
+
+class GLStateCache;
+
+// 渲染通道，按编号顺序执行
+typedef enum
+{
+    RENDER_PASS_OPAQUE,         // 不透明物体，从近到远
+    RENDER_PASS_TRANSPARENT,    // 半透明物体，从远到近
+    RENDER_PASS_OVERLAY,        // 屏幕覆盖层，在最后绘制
+} RenderPass_t;
+
+// 绘制项的执行者，队列切换好状态后回调
+class Renderable
+{
+public:
+    virtual ~Renderable() {}
+
+    /**
+      * @brief  执行一个绘制项，着色器程序、逐帧视图、材质和纹理已由队列绑定
+      * @author agent
+      * @param  shader: 当前绑定的着色器程序
+      * @param  id: 提交时给出的绘制项类型
+      * @param  param: 提交时给出的参数（如实例组编号）
+      * @retval none
+      */
+    virtual void Render(QOpenGLShaderProgram &shader, uint32_t id, uint32_t param) = 0;
+};
+
+class RenderQueue
+{
+public:
+    /**
+      * @brief  构造函数
+      * @author agent
+      * @param  gl_funs: OpenGL函数指针
+      * @param  p_frame_uniforms: 逐帧数据，执行时按绘制项的视图绑定
+      * @retval none
+      */
+    RenderQueue(QOpenGLFunctions_4_5_Core *gl_funs, FrameUniforms *p_frame_uniforms);
+
+    /**
+      * @brief  登记着色器程序，程序的登记编号决定同一通道内的先后
+      * @author agent
+      * @param  p_program: 着色器程序，生命周期必须长于队列；可以为nullptr，先占住编号，提交前用SetProgram设置
+      * @retval 程序编号，用于Submit
+      */
+    uint32_t RegisterProgram(QOpenGLShaderProgram *p_program);
+
+    /**
+      * @brief  更换已登记编号对应的着色器程序（如数据就绪后选定的着色器变体），编号和先后不变
+      * @author agent
+      * @param  program: 程序编号
+      * @param  p_program: 着色器程序
+      * @retval none
+      */
+    void SetProgram(uint32_t program, QOpenGLShaderProgram *p_program);
+
+    /**
+      * @brief  清空绘制项，每帧开始时调用，保留已分配的内存
+      * @author agent
+      * @param  none
+      * @retval none
+      */
+    void Clear(void);
+
+    /**
+      * @brief  提交绘制项
+      * @author agent
+      * @param  pass: 渲染通道
+      * @param  program: 程序编号
+      * @param  p_material: 材质，为nullptr时由绘制项自己绑定
+      * @param  texture: 绑定到0号纹理单元的纹理，0为不绑定
+      * @param  depth: 归一化的深度（0为最近，1为最远），超出范围时截断
+      * @param  frame_view: 逐帧数据中的视图编号
+      * @param  p_renderable: 执行者
+      * @param  id: 绘制项类型，原样传给执行者
+      * @param  param: 参数，原样传给执行者
+      * @retval none
+      */
+    void Submit(RenderPass_t pass, uint32_t program, const Material *p_material, unsigned int texture, float depth,
+                uint32_t frame_view, Renderable *p_renderable, uint32_t id, uint32_t param = 0);
+
+    /**
+      * @brief  执行通道范围内的绘制项，本帧第一次执行时排序；绑定经过状态缓存，结束后不解绑
+      * @author agent
+      * @param  first: 第一个通道
+      * @param  last: 最后一个通道（含）
+      * @retval none
+      */
+    void Execute(RenderPass_t first = RENDER_PASS_OPAQUE, RenderPass_t last = RENDER_PASS_OVERLAY);
+
+    /**
+      * @brief  组装排序键
+      * @author agent
+      * @param  pass: 渲染通道
+      * @param  program: 程序编号
+      * @param  material: 材质的排序编号
+      * @param  texture: 纹理对象
+      * @param  depth: 归一化的深度
+      * @retval 排序键
+      */
+    static uint64_t MakeKey(RenderPass_t pass, uint32_t program, uint32_t material, unsigned int texture, float depth);
+
+private:
+    // 一个绘制项，排序键之外的状态用于执行时比较和绑定
+    struct RenderItem {
+        uint32_t pass;
+        uint32_t program;
+        uint32_t frame_view;
+        const Material *p_material;
+        unsigned int texture;
+        Renderable *p_renderable;
+        uint32_t id;
+        uint32_t param;
+    };
+    // 基数排序的元素：排序键和绘制项编号
+    struct SortEntry {
+        uint64_t key;
+        uint32_t item;
+    };
+
+    /**
+      * @brief  按排序键做LSD基数排序（每趟8位，所有元素该位相同时跳过），结果在sorted中
+      * @author agent
+      * @param  none
+      * @retval none
+      */
+    void Sort(void);
+
+    /**
+      * @brief  设置通道的深度和混合状态，经过状态缓存，未变化的状态不会重复设置
+      * @author agent
+      * @param  pass: 渲染通道
+      * @retval none
+      */
+    void ApplyPassState(uint32_t pass);
+
+    QOpenGLFunctions_4_5_Core *p_gl_funs;
+    GLStateCache *p_gl_state;
+    FrameUniforms *p_frame_uniforms;
+    std::vector<QOpenGLShaderProgram *> programs;
+    std::vector<RenderItem> items;
+    std::vector<SortEntry> sorted, scratch;
+    bool sorted_valid;  // 提交后尚未排序时为false，分通道执行时只排序一次
+};
+
+#endif // RENDERQUEUE_H
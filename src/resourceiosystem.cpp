@@ -0,0 +1,142 @@
+#include "resourceiosystem.h"
+#include <QFileInfo>
+#include <QResource>
+#include <cstring>
+
+ResourceIOStream::ResourceIOStream(const QString &path)
+    : file(path), p_mapped(nullptr), p_data(nullptr), data_size(0), cursor(0)
+{
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+    data_size = (size_t)file.size();
+    p_mapped = file.map(0, file.size());
+    if (p_mapped != nullptr)
+    {
+        p_data = p_mapped;
+    }
+    else
+    {
+        fallback = file.readAll();
+        p_data = reinterpret_cast<const uchar *>(fallback.constData());
+    }
+}
+
+ResourceIOStream::~ResourceIOStream()
+{
+    if (p_mapped != nullptr)
+        file.unmap(p_mapped);
+}
+
+bool ResourceIOStream::IsOpen(void) const
+{
+    return file.isOpen();
+}
+
+const uchar *ResourceIOStream::Data(void) const
+{
+    return p_data;
+}
+
+size_t ResourceIOStream::Read(void *buffer, size_t size, size_t count)
+{
+    if (size == 0 || count == 0)
+        return 0;
+    // 与fread一致：只读取完整的元素，返回读取的元素个数
+    size_t available = (data_size - cursor) / size;
+    size_t read_count = count < available ? count : available;
+    std::memcpy(buffer, p_data + cursor, read_count * size);
+    cursor += read_count * size;
+    return read_count;
+}
+
+size_t ResourceIOStream::Write(const void *buffer, size_t size, size_t count)
+{
+    Q_UNUSED(buffer);
+    Q_UNUSED(size);
+    Q_UNUSED(count);
+    return 0;
+}
+
+aiReturn ResourceIOStream::Seek(size_t offset, aiOrigin origin)
+{
+    size_t target;
+    switch (origin)
+    {
+    case aiOrigin_SET:
+        target = offset;
+        break;
+    case aiOrigin_CUR:
+        target = cursor + offset;
+        break;
+    case aiOrigin_END:
+        // aiOrigin_END时偏移量按负数解释
+        target = data_size - offset;
+        break;
+    default:
+        return aiReturn_FAILURE;
+    }
+    if (target > data_size)
+        return aiReturn_FAILURE;
+    cursor = target;
+    return aiReturn_SUCCESS;
+}
+
+size_t ResourceIOStream::Tell() const
+{
+    return cursor;
+}
+
+size_t ResourceIOStream::FileSize() const
+{
+    return data_size;
+}
+
+void ResourceIOStream::Flush()
+{
+}
+
+bool ResourceIOSystem::Exists(const char *file) const
+{
+    return QFile::exists(QString::fromUtf8(file));
+}
+
+char ResourceIOSystem::getOsSeparator() const
+{
+    // Qt在所有平台上都接受'/'，Qt资源路径也只能使用'/'
+    return '/';
+}
+
+Assimp::IOStream *ResourceIOSystem::Open(const char *file, const char *mode)
+{
+    // 只支持读取，模型导入不需要写文件
+    if (std::strchr(mode, 'w') != nullptr || std::strchr(mode, 'a') != nullptr)
+        return nullptr;
+    ResourceIOStream *stream = new ResourceIOStream(QString::fromUtf8(file));
+    if (!stream->IsOpen())
+    {
+        delete stream;
+        return nullptr;
+    }
+    return stream;
+}
+
+void ResourceIOSystem::Close(Assimp::IOStream *stream)
+{
+    delete stream;
+}
+
+bool ResourceIOSystem::ComparePaths(const char *one, const char *second) const
+{
+    QString path_one = QString::fromUtf8(one);
+    QString path_second = QString::fromUtf8(second);
+    if (path_one == path_second)
+        return true;
+    // 磁盘文件比较规范化后的绝对路径，Qt资源的规范路径为空时按原路径比较
+    QString canonical_one = QFileInfo(path_one).canonicalFilePath();
+    return !canonical_one.isEmpty() && canonical_one == QFileInfo(path_second).canonicalFilePath();
+}
+
+bool ResourceIOSystem::MountArchive(const QString &rcc_path, const QString &mount_root)
+{
+    return QResource::registerResource(rcc_path, mount_root);
+}
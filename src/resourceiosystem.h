@@ -0,0 +1,91 @@
+/**
+  ******************************************************************************
+  * @file           : resourceiosystem.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了Assimp文件系统接口（IOSystem/IOStream）的Qt实现，
+  * 文件通过QFile::map内存映射后直接交给Assimp读取，不经过Assimp默认的缓冲流。
+  * 路径可以是磁盘文件、编译进程序的Qt资源（":/..."），也可以是挂载的外部资源包（.rcc）中的条目，
+  * 模型引用的其他文件（材质、纹理等）按同样的方式解析
+  ******************************************************************************
+  * @attention
+  *     Qt资源只有未压缩时才能映射，需要零拷贝读取的模型在.qrc中应设置compression-algorithm="none"，
+  * 无法映射时自动退化为一次性读入内存
+  ******************************************************************************
+  */
+
+#ifndef RESOURCEIOSYSTEM_H
+#define RESOURCEIOSYSTEM_H
+
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+class ResourceIOStream : public Assimp::IOStream
+{
+public:
+    /**
+      * @brief  构造函数，映射已打开的文件，映射失败时读入内存
+      * @author agent
+      * @param  path: 文件路径
+      * @retval none
+      */
+    explicit ResourceIOStream(const QString &path);
+    ~ResourceIOStream() override;
+
+    /**
+      * @brief  文件是否成功打开
+      * @author agent
+      * @param  none
+      * @retval 是否打开
+      */
+    bool IsOpen(void) const;
+
+    /**
+      * @brief  获取文件内容首地址（映射内存或读入的缓冲），用于绕过Read直接解码
+      * @author agent
+      * @param  none
+      * @retval 文件内容首地址
+      */
+    const uchar *Data(void) const;
+
+    size_t Read(void *buffer, size_t size, size_t count) override;
+    size_t Write(const void *buffer, size_t size, size_t count) override;
+    aiReturn Seek(size_t offset, aiOrigin origin) override;
+    size_t Tell() const override;
+    size_t FileSize() const override;
+    void Flush() override;
+
+private:
+    QFile file;
+    QByteArray fallback;        // 无法映射时的文件内容
+    uchar *p_mapped;
+    const uchar *p_data;
+    size_t data_size;
+    size_t cursor;
+};
+
+class ResourceIOSystem : public Assimp::IOSystem
+{
+public:
+    bool Exists(const char *file) const override;
+    char getOsSeparator() const override;
+    Assimp::IOStream *Open(const char *file, const char *mode = "rb") override;
+    void Close(Assimp::IOStream *stream) override;
+    bool ComparePaths(const char *one, const char *second) const override;
+
+    /**
+      * @brief  挂载外部资源包（由rcc -binary生成），Qt以内存映射方式打开资源包，
+      *         挂载后其中的文件可通过":<mount_root>/..."路径访问
+      * @author agent
+      * @param  rcc_path: 资源包路径
+      * @param  mount_root: 挂载点，如"/packed"
+      * @retval 是否挂载成功
+      */
+    static bool MountArchive(const QString &rcc_path, const QString &mount_root);
+};
+
+#endif // RESOURCEIOSYSTEM_H
@@ -0,0 +1,142 @@
+#include "resourcemanager.h"
+#include "geometrypool.h"
+#include "meshcache.h"
+#include "model.h"
+#include "resourceiosystem.h"
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+
+namespace {
+
+// 按键查找仍然存活的资源
+template <typename T>
+std::shared_ptr<T> Lookup(std::unordered_map<std::string, std::weak_ptr<T>> &by_path, const std::string &key)
+{
+    auto it = by_path.find(key);
+    return it == by_path.end() ? nullptr : it->second.lock();
+}
+
+template <typename Map>
+void EraseExpired(Map &map)
+{
+    for (auto it = map.begin(); it != map.end();)
+    {
+        if (it->second.expired())
+            it = map.erase(it);
+        else
+            ++it;
+    }
+}
+
+} // namespace
+
+ResourceManager &ResourceManager::Instance(void)
+{
+    static ResourceManager instance;
+    return instance;
+}
+
+std::shared_ptr<QOpenGLTexture> ResourceManager::AcquireTexture(const QString &path, bool mirrored)
+{
+    const std::string path_key = CanonicalPath(path).toStdString() + (mirrored ? "|m" : "|n");
+    std::shared_ptr<QOpenGLTexture> texture = Lookup(textures_by_path, path_key);
+    if (texture)
+        return texture;
+
+    uint64_t hash;
+    if (!MeshCache::HashFile(path, hash))
+    {
+        qDebug() << "ResourceManager: cannot read texture" << path;
+        return nullptr;
+    }
+    hash = MeshCache::Hash(&mirrored, sizeof(mirrored), hash);
+    auto it = textures_by_hash.find(hash);
+    if (it != textures_by_hash.end() && (texture = it->second.lock()))
+    {
+        textures_by_path[path_key] = texture;
+        return texture;
+    }
+
+    // 与模型文件一样通过映射读取并直接解码
+    QImage image;
+    ResourceIOStream stream(path);
+    if (stream.IsOpen())
+        image.loadFromData(stream.Data(), (int)stream.FileSize());
+    if (image.isNull())
+    {
+        qDebug() << "ResourceManager: cannot decode texture" << path;
+        return nullptr;
+    }
+    texture = std::make_shared<QOpenGLTexture>(mirrored ? image.mirrored() : image);
+    textures_by_path[path_key] = texture;
+    textures_by_hash[hash] = texture;
+    qDebug() << path << "loaded";
+    return texture;
+}
+
+namespace {
+
+// 保留了CPU端数据的模型可以满足任何请求，反之不行
+bool UsableModel(const std::shared_ptr<Model> &model, bool keep_cpu_data)
+{
+    return model && (model->keep_cpu_data || !keep_cpu_data);
+}
+
+} // namespace
+
+std::shared_ptr<Model> ResourceManager::FindModel(const std::string &path, bool keep_cpu_data, ModelKey &key)
+{
+    key.path = CanonicalPath(QString::fromStdString(path)).toStdString();
+    key.hash = 0;
+    key.hashed = false;
+    std::shared_ptr<Model> model = Lookup(models_by_path, key.path);
+    return UsableModel(model, keep_cpu_data) ? model : nullptr;
+}
+
+std::shared_ptr<Model> ResourceManager::FindModelByContent(const ModelKey &key, bool keep_cpu_data)
+{
+    if (!key.hashed)
+        return nullptr;
+    auto it = models_by_hash.find(key.hash);
+    std::shared_ptr<Model> model = it == models_by_hash.end() ? nullptr : it->second.lock();
+    if (!UsableModel(model, keep_cpu_data))
+        return nullptr;
+    models_by_path[key.path] = model;
+    return model;
+}
+
+void ResourceManager::RegisterModel(const ModelKey &key, const std::shared_ptr<Model> &model)
+{
+    models_by_path[key.path] = model;
+    if (key.hashed)
+        models_by_hash[key.hash] = model;
+}
+
+std::shared_ptr<GeometryPool> ResourceManager::AcquireGeometryPool(QOpenGLFunctions_4_5_Core *gl_funs)
+{
+    std::shared_ptr<GeometryPool> pool = geometry_pool.lock();
+    if (!pool)
+    {
+        pool = std::make_shared<GeometryPool>(gl_funs);
+        geometry_pool = pool;
+    }
+    return pool;
+}
+
+void ResourceManager::Purge(void)
+{
+    EraseExpired(textures_by_path);
+    EraseExpired(textures_by_hash);
+    EraseExpired(models_by_path);
+    EraseExpired(models_by_hash);
+}
+
+QString ResourceManager::CanonicalPath(const QString &path)
+{
+    if (path.startsWith(":"))
+        return QDir::cleanPath(path);
+    QString canonical = QFileInfo(path).canonicalFilePath();
+    return canonical.isEmpty() ? QDir::cleanPath(path) : canonical;
+}
@@ -0,0 +1,125 @@
+/**
+  ******************************************************************************
+  * @file           : resourcemanager.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了进程级资源管理类的定义，统一管理模型和纹理，
+  * 按规范化路径和文件内容哈希去重，对外发放引用计数句柄（std::shared_ptr），
+  * 最后一个使用者释放句柄时自动销毁对应的OpenGL对象。同一型号的飞机无论生成多少架，
+  * 模型和纹理都只上传一次
+  ******************************************************************************
+  * @attention
+  *     管理器内部只保存弱引用，不延长资源寿命，失效的条目在Purge时清理（如替换模型之后）；所有获取与释放都必须在OpenGL上下文所在线程、
+  * 且上下文为当前时进行，以便QOpenGLTexture和网格能正确删除GL对象
+  ******************************************************************************
+  */
+
+#ifndef RESOURCEMANAGER_H
+#define RESOURCEMANAGER_H
+
+#include <QOpenGLFunctions_4_5_Core>
+#include <QOpenGLTexture>
+#include <QString>
+#include "vertexformat.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+class GeometryPool;
+class Model;
+
+// 模型的查找键：规范化路径和文件内容哈希，文件不可读时hashed为false
+struct ModelKey {
+    std::string path;
+    uint64_t hash;
+    bool hashed;
+};
+
+class ResourceManager
+{
+public:
+    /**
+      * @brief  获取进程唯一的资源管理器
+      * @author agent
+      * @param  none
+      * @retval 资源管理器
+      */
+    static ResourceManager &Instance(void);
+
+    /**
+      * @brief  获取纹理，路径或内容相同的纹理共享同一个纹理对象
+      * @author agent
+      * @param  path: 图片路径，可以是磁盘文件或Qt资源
+      * @param  mirrored: 是否上下翻转（OpenGL纹理坐标原点在左下角）
+      * @retval 纹理句柄，加载失败时为空
+      */
+    std::shared_ptr<QOpenGLTexture> AcquireTexture(const QString &path, bool mirrored = true);
+
+    /**
+      * @brief  按规范化路径查找已加载的模型，不读取文件，可以在GUI线程中调用；未命中时在工作线程中计算内容哈希并导入
+      * @author agent
+      * @param  path: 模型路径
+      * @param  keep_cpu_data: 是否需要网格的CPU端顶点和索引
+      * @param  key: 输出的查找键，只含路径，内容哈希由导入后填入
+      * @retval 模型句柄，未命中时为空
+      */
+    std::shared_ptr<Model> FindModel(const std::string &path, bool keep_cpu_data, ModelKey &key);
+
+    /**
+      * @brief  按内容哈希查找已加载的模型，命中时把路径登记为别名；供异步导入完成后查重
+      * @author agent
+      * @param  key: 查找键，hashed为false时不查找
+      * @param  keep_cpu_data: 是否需要网格的CPU端顶点和索引
+      * @retval 模型句柄，未命中时为空
+      */
+    std::shared_ptr<Model> FindModelByContent(const ModelKey &key, bool keep_cpu_data);
+
+    /**
+      * @brief  登记新加载的模型，之后路径或内容相同的请求共享该模型
+      * @author agent
+      * @param  key: 查找键，内容哈希已填入
+      * @param  model: 模型句柄
+      * @retval none
+      */
+    void RegisterModel(const ModelKey &key, const std::shared_ptr<Model> &model);
+
+    /**
+      * @brief  获取共享几何池，所有模型的网格子分配在同一个池中
+      * @author agent
+      * @param  gl_funs: OpenGL函数指针
+      * @retval 几何池句柄，最后一个模型释放后销毁
+      */
+    std::shared_ptr<GeometryPool> AcquireGeometryPool(QOpenGLFunctions_4_5_Core *gl_funs);
+
+    /**
+      * @brief  清理已失效的弱引用条目
+      * @author agent
+      * @param  none
+      * @retval none
+      */
+    void Purge(void);
+
+private:
+    ResourceManager() = default;
+    ResourceManager(const ResourceManager &) = delete;
+    ResourceManager &operator=(const ResourceManager &) = delete;
+
+    /**
+      * @brief  计算规范化路径：磁盘文件取规范绝对路径，Qt资源取清理后的路径
+      * @author agent
+      * @param  path: 原始路径
+      * @retval 规范化路径
+      */
+    static QString CanonicalPath(const QString &path);
+
+    // 纹理的键包含是否翻转，同一图片的两种朝向是不同的纹理
+    std::unordered_map<std::string, std::weak_ptr<QOpenGLTexture>> textures_by_path;
+    std::unordered_map<uint64_t, std::weak_ptr<QOpenGLTexture>> textures_by_hash;
+    std::unordered_map<std::string, std::weak_ptr<Model>> models_by_path;
+    std::unordered_map<uint64_t, std::weak_ptr<Model>> models_by_hash;
+    std::weak_ptr<GeometryPool> geometry_pool;
+};
+
+#endif // RESOURCEMANAGER_H
@@ -0,0 +1,68 @@
+#include "scenegraph.h"
+#include <algorithm>
+
+uint32_t SceneGraph::AddNode(int32_t parent, const QMatrix4x4 &local, const string &name, uint32_t first_mesh, uint32_t mesh_count)
+{
+    const uint32_t node = (uint32_t)parents.size();
+    parents.push_back(parent);
+    subtree_ends.push_back(node + 1);
+    locals.push_back(local);
+    worlds.push_back(local);
+    names.push_back(name);
+    first_meshes.push_back(first_mesh);
+    mesh_counts.push_back(mesh_count);
+    dirty_flags.push_back(0);
+
+    // 先序添加时新节点紧跟在所有祖先的子树之后，祖先的子树向后扩展一个节点
+    for (int32_t p = parent; p != kNoParent; p = parents[p])
+        subtree_ends[p] = node + 1;
+
+    // 新节点的世界变换在下一次Update时计算，同时报告给调用者
+    SetLocal(node, local);
+    return node;
+}
+
+void SceneGraph::SetLocal(uint32_t node, const QMatrix4x4 &local)
+{
+    locals[node] = local;
+    if (!dirty_flags[node])
+    {
+        dirty_flags[node] = 1;
+        dirty_nodes.push_back(node);
+    }
+}
+
+const vector<SceneNodeRange> &SceneGraph::Update()
+{
+    changed_ranges.clear();
+    if (dirty_nodes.empty())
+        return changed_ranges;
+
+    // 按编号排序后，落在前一个子树区间内的节点已被覆盖，跳过
+    std::sort(dirty_nodes.begin(), dirty_nodes.end());
+    for (uint32_t node : dirty_nodes)
+    {
+        dirty_flags[node] = 0;
+        if (!changed_ranges.empty() && node < changed_ranges.back().end)
+            continue;
+        changed_ranges.push_back(SceneNodeRange{node, subtree_ends[node]});
+    }
+    dirty_nodes.clear();
+
+    // 父节点在子节点之前，顺序遍历子树区间即可保证父节点的世界变换已是最新
+    for (const SceneNodeRange &range : changed_ranges)
+    {
+        for (uint32_t node = range.begin; node < range.end; node++)
+        {
+            const int32_t parent = parents[node];
+            worlds[node] = parent == kNoParent ? locals[node] : worlds[parent] * locals[node];
+        }
+    }
+    return changed_ranges;
+}
+
+int32_t SceneGraph::Find(const string &name) const
+{
+    auto it = std::find(names.begin(), names.end(), name);
+    return it == names.end() ? kNoParent : (int32_t)(it - names.begin());
+}
@@ -0,0 +1,95 @@
+/**
+  ******************************************************************************
+  * @file           : scenegraph.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了扁平化场景图的定义。节点按深度优先的先序存放在连续数组中，父节点总在
+  * 子节点之前，每个节点的子树是从它开始的一段连续区间；节点保存局部变换和世界变换（相对模型），
+  * 修改局部变换只标记该节点，更新时只重算被标记节点的子树
+  ******************************************************************************
+  * @attention
+  *     节点必须按先序添加：新节点的父节点必须是最近添加的节点或其祖先；
+  * 节点挂载的网格也按先序编号，第i个节点的网格为[first_mesh, first_mesh + mesh_count)
+  ******************************************************************************
+  */
+
+#ifndef SCENEGRAPH_H
+#define SCENEGRAPH_H
+
+#include <QMatrix4x4>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+// 节点区间[begin, end)
+struct SceneNodeRange {
+    uint32_t begin;
+    uint32_t end;
+};
+
+class SceneGraph
+{
+public:
+    // 根节点的父节点
+    static const int32_t kNoParent = -1;
+
+    /**
+      * @brief  按先序添加节点
+      * @author agent
+      * @param  parent: 父节点，根节点为kNoParent
+      * @param  local: 相对父节点的局部变换
+      * @param  name: 节点名称
+      * @param  first_mesh: 节点的第一个网格
+      * @param  mesh_count: 节点的网格数量
+      * @retval 节点编号
+      */
+    uint32_t AddNode(int32_t parent, const QMatrix4x4 &local, const string &name, uint32_t first_mesh, uint32_t mesh_count);
+
+    /**
+      * @brief  修改节点的局部变换，世界变换在下一次Update时更新
+      * @author agent
+      * @param  node: 节点编号
+      * @param  local: 局部变换
+      * @retval none
+      */
+    void SetLocal(uint32_t node, const QMatrix4x4 &local);
+
+    /**
+      * @brief  重算被标记节点的子树的世界变换，代价与变化的节点数成正比
+      * @author agent
+      * @param  none
+      * @retval 世界变换发生变化的节点区间，按起点排序且互不重叠，在下一次Update前有效
+      */
+    const vector<SceneNodeRange> &Update(void);
+
+    /**
+      * @brief  按名称查找节点
+      * @author agent
+      * @param  name: 节点名称
+      * @retval 节点编号，不存在时为kNoParent
+      */
+    int32_t Find(const string &name) const;
+
+    uint32_t NodeCount(void) const { return (uint32_t)parents.size(); }
+    bool IsDirty(void) const { return !dirty_nodes.empty(); }
+
+    // 按节点编号索引的连续数组
+    vector<int32_t> parents;
+    vector<uint32_t> subtree_ends;      // 子树为[node, subtree_ends[node])
+    vector<QMatrix4x4> locals;
+    vector<QMatrix4x4> worlds;
+    vector<string> names;
+    vector<uint32_t> first_meshes;
+    vector<uint32_t> mesh_counts;
+
+private:
+    vector<uint32_t> dirty_nodes;       // 被修改过局部变换的节点，可能重复或互相包含
+    vector<char> dirty_flags;
+    vector<SceneNodeRange> changed_ranges;
+};
+
+#endif // SCENEGRAPH_H
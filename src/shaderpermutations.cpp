@@ -0,0 +1,42 @@
+#include "shaderpermutations.h"
+#include "programcache.h"
+
+namespace {
+
+// 按特性位的顺序排列
+const char *const kShaderFeatureDefines[kShaderFeatureCount] = {"FEATURE_TEXTURED", "FEATURE_LIT", "FEATURE_ANIMATED",
+                                                                 "FEATURE_GPU_CULLED"};
+
+} // namespace
+
+ShaderPermutations::ShaderPermutations(QOpenGLFunctions_4_5_Core *gl_funs, const QString &vertex_path, const QString &fragment_path,
+                                       uint32_t supported_features)
+    : p_gl_funs(gl_funs), vertex_path(vertex_path), fragment_path(fragment_path), supported_features(supported_features)
+{
+}
+
+QOpenGLShaderProgram &ShaderPermutations::Variant(uint32_t features)
+{
+    // 源文件不支持的特性位不产生新的变体
+    features &= supported_features & (kShaderVariantCount - 1);
+    std::unique_ptr<QOpenGLShaderProgram> &variant = variants[features];
+    if (!variant)
+    {
+        variant.reset(new QOpenGLShaderProgram);
+        ProgramCache program_cache(p_gl_funs);
+        program_cache.Add(variant.get(), vertex_path, fragment_path, Defines(features));
+        program_cache.Build();
+    }
+    return *variant;
+}
+
+QStringList ShaderPermutations::Defines(uint32_t features)
+{
+    QStringList defines;
+    for (uint32_t i = 0; i < kShaderFeatureCount; i++)
+    {
+        if (features & (1u << i))
+            defines << kShaderFeatureDefines[i];
+    }
+    return defines;
+}
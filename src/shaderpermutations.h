@@ -0,0 +1,93 @@
+/**
+  ******************************************************************************
+  * @file           : shaderpermutations.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了着色器变体类的定义。一对着色器源文件按特性位编译出多个变体，
+  * 每个特性位对应一个宏定义（如SHADER_FEATURE_LIT对应FEATURE_LIT），着色器中用#ifdef选择代码，
+  * 不在运行时分支；变体在第一次取用时才编译（经过程序二进制缓存），之后按特性位直接取数组元素
+  ******************************************************************************
+  * @attention
+  *     固定的绘制路径用Get<特性位>()，特性位在编译期检查；依赖数据的路径（如模型是否带纹理、动画）
+  * 在数据就绪时用Variant()取一次程序并保存，不在每次绘制时取；
+  * 需要在OpenGL上下文为当前时取用变体
+  ******************************************************************************
+  */
+
+#ifndef SHADERPERMUTATIONS_H
+#define SHADERPERMUTATIONS_H
+
+#include <QOpenGLFunctions_4_5_Core>
+#include <QOpenGLShaderProgram>
+#include <QString>
+#include <QStringList>
+#include <cstdint>
+#include <memory>
+
+// 着色器特性位
+typedef enum
+{
+    SHADER_FEATURE_TEXTURED = 1 << 0,   // 采样漫反射纹理
+    SHADER_FEATURE_LIT = 1 << 1,        // Phong光照
+    SHADER_FEATURE_ANIMATED = 1 << 2,   // 节点动画和骨骼蒙皮
+    SHADER_FEATURE_GPU_CULLED = 1 << 3, // 实例编号取自GPU剔除后的可见列表（见GpuCuller）
+} ShaderFeature_t;
+
+const uint32_t kShaderFeatureCount = 4;
+const uint32_t kShaderVariantCount = 1u << kShaderFeatureCount;
+
+class ShaderPermutations
+{
+public:
+    /**
+      * @brief  构造函数，只记录源文件，不编译
+      * @author agent
+      * @param  gl_funs: OpenGL函数指针
+      * @param  vertex_path: 顶点着色器源文件
+      * @param  fragment_path: 片段着色器源文件
+      * @param  supported_features: 源文件支持的特性位，其余特性位在取用变体时被忽略
+      * @retval none
+      */
+    ShaderPermutations(QOpenGLFunctions_4_5_Core *gl_funs, const QString &vertex_path, const QString &fragment_path,
+                       uint32_t supported_features);
+    ShaderPermutations(const ShaderPermutations &) = delete;
+    ShaderPermutations &operator=(const ShaderPermutations &) = delete;
+
+    /**
+      * @brief  取用特性位在编译期确定的变体
+      * @author agent
+      * @param  none
+      * @retval 着色器程序，编译失败时未链接
+      */
+    template <uint32_t kFeatures>
+    QOpenGLShaderProgram &Get(void)
+    {
+        static_assert(kFeatures < kShaderVariantCount, "unknown shader feature bits");
+        return Variant(kFeatures);
+    }
+
+    /**
+      * @brief  取用变体，第一次取用时编译
+      * @author agent
+      * @param  features: 特性位
+      * @retval 着色器程序，编译失败时未链接
+      */
+    QOpenGLShaderProgram &Variant(uint32_t features);
+
+    /**
+      * @brief  特性位对应的宏定义
+      * @author agent
+      * @param  features: 特性位
+      * @retval 宏定义
+      */
+    static QStringList Defines(uint32_t features);
+
+private:
+    QOpenGLFunctions_4_5_Core *p_gl_funs;
+    QString vertex_path, fragment_path;
+    uint32_t supported_features;
+    std::unique_ptr<QOpenGLShaderProgram> variants[kShaderVariantCount];
+};
+
+#endif // SHADERPERMUTATIONS_H
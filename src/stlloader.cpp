@@ -0,0 +1,371 @@
+#include "stlloader.h"
+#include <QDebug>
+#include <QFile>
+#include <QString>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// 二进制STL每个三角形记录的长度：法线12字节 + 3个顶点36字节 + 属性2字节
+const size_t kStlRecordSize = 50;
+const size_t kStlHeaderSize = 84;
+
+inline uint32_t FloatBits(float value)
+{
+    // -0.0与0.0视为同一位置
+    if (value == 0.0f)
+        value = 0.0f;
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline uint32_t HashBits(const uint32_t *bits, int count)
+{
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < count; i++)
+    {
+        h ^= bits[i];
+        h *= 16777619u;
+        h ^= h >> 15;
+    }
+    return h;
+}
+
+// 开放寻址哈希表，只存储编号，键的比较交给调用者，装载率超过一半时扩容
+class IdHashTable
+{
+public:
+    explicit IdHashTable(size_t expected)
+    {
+        size_t capacity = 64;
+        while (capacity < expected * 2)
+            capacity <<= 1;
+        buckets.assign(capacity, kEmpty);
+        hashes.assign(capacity, 0);
+    }
+
+    template <typename Equal>
+    uint32_t FindOrInsert(uint32_t hash, uint32_t new_id, Equal equal)
+    {
+        if ((count + 1) * 2 > buckets.size())
+            Grow();
+        size_t mask = buckets.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask)
+        {
+            if (buckets[i] == kEmpty)
+            {
+                buckets[i] = new_id;
+                hashes[i] = hash;
+                count++;
+                return new_id;
+            }
+            if (hashes[i] == hash && equal(buckets[i]))
+                return buckets[i];
+        }
+    }
+
+private:
+    static constexpr uint32_t kEmpty = 0xFFFFFFFFu;
+    vector<uint32_t> buckets;
+    vector<uint32_t> hashes;
+    size_t count = 0;
+
+    void Grow(void)
+    {
+        vector<uint32_t> old_slots;
+        vector<uint32_t> old_hashes;
+        old_slots.swap(buckets);
+        old_hashes.swap(hashes);
+        buckets.assign(old_slots.size() * 2, kEmpty);
+        hashes.assign(old_slots.size() * 2, 0);
+        size_t mask = buckets.size() - 1;
+        for (size_t j = 0; j < old_slots.size(); j++)
+        {
+            if (old_slots[j] == kEmpty)
+                continue;
+            size_t i = old_hashes[j] & mask;
+            while (buckets[i] != kEmpty)
+                i = (i + 1) & mask;
+            buckets[i] = old_slots[j];
+            hashes[i] = old_hashes[j];
+        }
+    }
+};
+
+// ASCII STL的词法分析：跳过空白，返回下一个单词
+bool NextToken(const char *&cursor, const char *end, const char *&token, size_t &length)
+{
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n'))
+        cursor++;
+    if (cursor >= end)
+        return false;
+    token = cursor;
+    while (cursor < end && !(*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n'))
+        cursor++;
+    length = cursor - token;
+    return true;
+}
+
+inline bool TokenIs(const char *token, size_t length, const char *word)
+{
+    size_t word_length = std::strlen(word);
+    return length == word_length && std::memcmp(token, word, length) == 0;
+}
+
+// 读取3个浮点数，from_chars不受locale影响且不会越过映射内存的末尾
+bool ReadFloat3(const char *&cursor, const char *end, float out[3])
+{
+    for (int k = 0; k < 3; k++)
+    {
+        const char *token;
+        size_t length;
+        if (!NextToken(cursor, end, token, length))
+            return false;
+        if (*token == '+')
+        {
+            token++;
+            length--;
+        }
+        std::from_chars_result result = std::from_chars(token, token + length, out[k]);
+        if (result.ec != std::errc())
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+StlLoader::StlLoader(float crease_angle_degree)
+    : crease_angle_degree(crease_angle_degree)
+{
+}
+
+bool StlLoader::IsStlFile(const string &path)
+{
+    size_t dot = path.find_last_of('.');
+    if (dot == string::npos)
+        return false;
+    string suffix = path.substr(dot + 1);
+    std::transform(suffix.begin(), suffix.end(), suffix.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return suffix == "stl";
+}
+
+bool StlLoader::Load(const string &path, MeshData &mesh)
+{
+    QFile file(QString::fromStdString(path));
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qDebug() << "ERROR::STL::cannot open" << path.c_str();
+        return false;
+    }
+    const size_t size = (size_t)file.size();
+    uchar *data = file.map(0, size);
+    QByteArray fallback;
+    if (data == nullptr)
+    {
+        // 无法映射时（如压缩的Qt资源）退化为整体读取
+        fallback = file.readAll();
+        data = reinterpret_cast<uchar *>(fallback.data());
+    }
+
+    // 二进制STL的长度由三角形数量唯一确定；否则以"solid"开头的按ASCII解析
+    bool binary = false;
+    if (size >= kStlHeaderSize)
+    {
+        uint32_t triangle_count;
+        std::memcpy(&triangle_count, data + 80, sizeof(triangle_count));
+        binary = kStlHeaderSize + (size_t)triangle_count * kStlRecordSize == size;
+    }
+    const char *text = reinterpret_cast<const char *>(data);
+    const char *text_end = text + size;
+    const char *token;
+    size_t length;
+    bool ascii = !binary && NextToken(text, text_end, token, length) && TokenIs(token, length, "solid");
+
+    bool success;
+    if (binary)
+        success = ParseBinary(data, size);
+    else if (ascii)
+        success = ParseAscii(reinterpret_cast<const char *>(data), size);
+    else
+        success = size >= kStlHeaderSize && ParseBinary(data, size);
+
+    if (success)
+        BuildMesh(mesh);
+    if (fallback.isEmpty())
+        file.unmap(data);
+    if (!success)
+        qDebug() << "ERROR::STL::invalid file" << path.c_str();
+    return success;
+}
+
+bool StlLoader::ParseBinary(const unsigned char *data, size_t size)
+{
+    uint32_t triangle_count;
+    std::memcpy(&triangle_count, data + 80, sizeof(triangle_count));
+    // 对末尾带有多余字节的文件，按实际能容纳的三角形数量截断
+    triangle_count = (uint32_t)std::min<size_t>(triangle_count, (size - kStlHeaderSize) / kStlRecordSize);
+    if (triangle_count == 0)
+        return false;
+
+    // 直接引用映射内存中的三角形记录，不做拷贝
+    triangle_base = data + kStlHeaderSize + 12;
+    triangle_stride = kStlRecordSize;
+    triangle_count_parsed = triangle_count;
+    return true;
+}
+
+bool StlLoader::ParseAscii(const char *data, size_t size)
+{
+    const char *cursor = data;
+    const char *end = data + size;
+    const char *token;
+    size_t length;
+
+    corner_positions.clear();
+    vector<float> polygon;
+    while (NextToken(cursor, end, token, length))
+    {
+        if (TokenIs(token, length, "solid"))
+        {
+            // 跳过实体名称（可能含空格）
+            while (cursor < end && *cursor != '\n')
+                cursor++;
+        }
+        else if (TokenIs(token, length, "facet"))
+        {
+            polygon.clear();
+        }
+        else if (TokenIs(token, length, "vertex"))
+        {
+            float v[3];
+            if (!ReadFloat3(cursor, end, v))
+                return false;
+            polygon.insert(polygon.end(), v, v + 3);
+        }
+        else if (TokenIs(token, length, "endfacet"))
+        {
+            // 规范要求每个面恰好3个顶点，多于3个时按扇形三角化
+            size_t vertex_count = polygon.size() / 3;
+            for (size_t k = 2; k < vertex_count; k++)
+            {
+                corner_positions.insert(corner_positions.end(), polygon.begin(), polygon.begin() + 3);
+                corner_positions.insert(corner_positions.end(), polygon.begin() + (k - 1) * 3, polygon.begin() + (k + 1) * 3);
+            }
+        }
+        // normal、outer loop、endloop、endsolid等单词不携带几何信息，直接跳过
+    }
+    triangle_base = reinterpret_cast<const unsigned char *>(corner_positions.data());
+    triangle_stride = 9 * sizeof(float);
+    triangle_count_parsed = corner_positions.size() / 9;
+    return triangle_count_parsed > 0;
+}
+
+void StlLoader::BuildMesh(MeshData &mesh)
+{
+    const size_t triangle_count = triangle_count_parsed;
+    const size_t corner_count = triangle_count * 3;
+
+    // 读取第c个角的位置，二进制记录未按4字节对齐，用memcpy读取
+    auto corner = [&](size_t c) {
+        float p[3];
+        std::memcpy(p, triangle_base + (c / 3) * triangle_stride + (c % 3) * 3 * sizeof(float), sizeof(p));
+        return QVector3D(p[0], p[1], p[2]);
+    };
+
+    // 1. 位置去重：每个角映射到唯一位置编号
+    vector<uint32_t> corner_position_id(corner_count);
+    vector<QVector3D> unique_positions;
+    unique_positions.reserve(corner_count / 4);
+    {
+        IdHashTable table(corner_count / 4);
+        for (size_t c = 0; c < corner_count; c++)
+        {
+            QVector3D p = corner(c);
+            uint32_t bits[3] = {FloatBits(p.x()), FloatBits(p.y()), FloatBits(p.z())};
+            uint32_t id = table.FindOrInsert(HashBits(bits, 3), (uint32_t)unique_positions.size(), [&](uint32_t other) {
+                const QVector3D &q = unique_positions[other];
+                return FloatBits(q.x()) == bits[0] && FloatBits(q.y()) == bits[1] && FloatBits(q.z()) == bits[2];
+            });
+            if (id == unique_positions.size())
+                unique_positions.push_back(p);
+            corner_position_id[c] = id;
+        }
+    }
+    const size_t position_count = unique_positions.size();
+
+    // 2. 面法线：叉积的模为面积的两倍，未归一化的叉积即面积加权法线
+    vector<QVector3D> face_weighted(triangle_count);
+    vector<QVector3D> face_unit(triangle_count);
+    for (size_t f = 0; f < triangle_count; f++)
+    {
+        const QVector3D &p0 = unique_positions[corner_position_id[f * 3 + 0]];
+        const QVector3D &p1 = unique_positions[corner_position_id[f * 3 + 1]];
+        const QVector3D &p2 = unique_positions[corner_position_id[f * 3 + 2]];
+        face_weighted[f] = QVector3D::crossProduct(p1 - p0, p2 - p0);
+        face_unit[f] = face_weighted[f].normalized();
+    }
+
+    // 3. 每个位置相邻的角列表（CSR格式）
+    vector<uint32_t> adjacency_offset(position_count + 1, 0);
+    for (size_t c = 0; c < corner_count; c++)
+        adjacency_offset[corner_position_id[c] + 1]++;
+    for (size_t i = 0; i < position_count; i++)
+        adjacency_offset[i + 1] += adjacency_offset[i];
+    vector<uint32_t> adjacency(corner_count);
+    {
+        vector<uint32_t> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+        for (size_t c = 0; c < corner_count; c++)
+            adjacency[fill[corner_position_id[c]]++] = (uint32_t)c;
+    }
+
+    // 4. 每个角的法线：累加同一位置上与本面夹角小于折痕角的相邻面，
+    //    再按(位置, 法线)去重得到最终顶点
+    const float cos_crease = std::cos(crease_angle_degree * 3.14159265358979f / 180.0f) - 1e-6f;
+    vector<uint32_t> vertex_position_id;
+    vertex_position_id.reserve(position_count + position_count / 2);
+    mesh.vertices.clear();
+    mesh.vertices.reserve(position_count + position_count / 2);
+    mesh.indices.resize(corner_count);
+    IdHashTable vertex_table(position_count + position_count / 2);
+    for (size_t c = 0; c < corner_count; c++)
+    {
+        const size_t face = c / 3;
+        const uint32_t pid = corner_position_id[c];
+        const bool degenerate = face_unit[face].isNull();
+        QVector3D normal;
+        for (uint32_t k = adjacency_offset[pid]; k < adjacency_offset[pid + 1]; k++)
+        {
+            size_t other_face = adjacency[k] / 3;
+            if (degenerate || QVector3D::dotProduct(face_unit[face], face_unit[other_face]) >= cos_crease)
+                normal += face_weighted[other_face];
+        }
+        normal.normalize();
+
+        uint32_t bits[4] = {pid, FloatBits(normal.x()), FloatBits(normal.y()), FloatBits(normal.z())};
+        uint32_t id = vertex_table.FindOrInsert(HashBits(bits, 4), (uint32_t)mesh.vertices.size(), [&](uint32_t other) {
+            const QVector3D &n = mesh.vertices[other].Normal;
+            return vertex_position_id[other] == pid &&
+                   FloatBits(n.x()) == bits[1] && FloatBits(n.y()) == bits[2] && FloatBits(n.z()) == bits[3];
+        });
+        if (id == mesh.vertices.size())
+        {
+            Vertex vertex;
+            vertex.Position = unique_positions[pid];
+            vertex.Normal = normal;
+            vertex.TexCoords = QVector2D(0.0f, 0.0f);
+            mesh.vertices.push_back(vertex);
+            vertex_position_id.push_back(pid);
+        }
+        mesh.indices[c] = id;
+    }
+    mesh.textures.clear();
+
+    corner_positions.clear();
+    corner_positions.shrink_to_fit();
+}
@@ -0,0 +1,89 @@
+/**
+  ******************************************************************************
+  * @file           : stlloader.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了STL模型加载类的定义，支持二进制和ASCII两种STL格式，不依赖Assimp
+  * 文件通过内存映射读取，顶点位置用哈希表去重，按折痕角生成顶点法线并构建索引，结果直接填入MeshData
+  ******************************************************************************
+  * @attention
+  *     STL文件的每个三角形都单独存储3个顶点，同一位置的顶点会重复出现多次。
+  * 去重后，夹角小于折痕角的相邻面共享平滑法线，夹角更大的面在该位置拆分为不同顶点，保留硬边
+  ******************************************************************************
+  */
+
+#ifndef STLLOADER_H
+#define STLLOADER_H
+
+#include "mesh.h"
+#include <cstdint>
+
+class StlLoader
+{
+public:
+    // 折痕角，单位：度，相邻面法线夹角小于该值时共享平滑法线，取0时为完全的面法线
+    float crease_angle_degree;
+
+public:
+    /**
+      * @brief  构造函数
+      * @author agent
+      * @param  crease_angle_degree: 折痕角，单位：度
+      * @retval none
+      */
+    explicit StlLoader(float crease_angle_degree = 30.0f);
+
+    /**
+      * @brief  加载STL文件，自动识别二进制或ASCII格式
+      * @author agent
+      * @param  path: 文件路径，可以是磁盘文件或Qt资源
+      * @param  mesh: 输出的网格数据
+      * @retval 是否加载成功
+      */
+    bool Load(const string &path, MeshData &mesh);
+
+    /**
+      * @brief  判断文件是否为STL格式（按扩展名）
+      * @author agent
+      * @param  path: 文件路径
+      * @retval 是否为STL文件
+      */
+    static bool IsStlFile(const string &path);
+
+private:
+    // 解析得到的三角形：第i个三角形的9个顶点坐标位于triangle_base + i * triangle_stride，
+    // 二进制STL直接指向映射内存，ASCII STL指向corner_positions
+    const unsigned char *triangle_base = nullptr;
+    size_t triangle_stride = 0;
+    size_t triangle_count_parsed = 0;
+    vector<float> corner_positions;
+
+    /**
+      * @brief  解析二进制STL
+      * @author agent
+      * @param  data: 文件数据
+      * @param  size: 文件长度
+      * @retval 是否解析成功
+      */
+    bool ParseBinary(const unsigned char *data, size_t size);
+
+    /**
+      * @brief  解析ASCII STL
+      * @author agent
+      * @param  data: 文件数据
+      * @param  size: 文件长度
+      * @retval 是否解析成功
+      */
+    bool ParseAscii(const char *data, size_t size);
+
+    /**
+      * @brief  位置去重、按折痕角生成法线并构建顶点和索引
+      * @author agent
+      * @param  mesh: 输出的网格数据
+      * @retval none
+      */
+    void BuildMesh(MeshData &mesh);
+};
+
+#endif // STLLOADER_H
@@ -0,0 +1,151 @@
+#include "streambuffer.h"
+#include "glstatecache.h"
+#include <QOpenGLContext>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+
+namespace {
+
+const GLbitfield kStreamMapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+// 每个上下文一个流式缓冲，与GLStateCache相同
+std::unordered_map<QOpenGLContext *, std::unique_ptr<StreamBuffer>> stream_buffers;
+QOpenGLContext *p_last_context = nullptr;
+StreamBuffer *p_last_stream_buffer = nullptr;
+
+} // namespace
+
+StreamBuffer &StreamBuffer::Current(void)
+{
+    QOpenGLContext *p_context = QOpenGLContext::currentContext();
+    if (p_context == p_last_context)
+        return *p_last_stream_buffer;
+
+    std::unique_ptr<StreamBuffer> &stream_buffer = stream_buffers[p_context];
+    if (!stream_buffer)
+    {
+        stream_buffer.reset(new StreamBuffer(p_context));
+        QObject::connect(p_context, &QOpenGLContext::aboutToBeDestroyed, [p_context]() {
+            if (p_last_context == p_context)
+            {
+                p_last_context = nullptr;
+                p_last_stream_buffer = nullptr;
+            }
+            stream_buffers.erase(p_context);
+        });
+    }
+    p_last_context = p_context;
+    p_last_stream_buffer = stream_buffer.get();
+    return *stream_buffer;
+}
+
+StreamBuffer::StreamBuffer(QOpenGLContext *p_context)
+    : p_context(p_context), p_gl_funs(p_context->versionFunctions<QOpenGLFunctions_4_5_Core>()), p_gl_state(&GLStateCache::Current()),
+      buffer(0), p_mapped(nullptr), frame_bytes(0), frame(0), head(0)
+{
+    GLint alignment = 256;
+    p_gl_funs->glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    uniform_alignment = (size_t)std::max(alignment, 1);
+    alignment = 256;
+    p_gl_funs->glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    storage_alignment = (size_t)std::max(alignment, 1);
+
+    std::fill(fences, fences + kStreamFrameCount, nullptr);
+    Create(kStreamInitialFrameBytes);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    // 上下文销毁时不一定为当前，此时缓冲和栅栏随上下文一起释放
+    if (QOpenGLContext::currentContext() != p_context)
+        return;
+    for (GLsync fence : fences)
+    {
+        if (fence != nullptr)
+            p_gl_funs->glDeleteSync(fence);
+    }
+    // 上下文的aboutToBeDestroyed中状态缓存先于本对象删除，直接调用OpenGL，不经过p_gl_state
+    retired.push_back(buffer);
+    p_gl_funs->glDeleteBuffers((GLsizei)retired.size(), retired.data());
+}
+
+void StreamBuffer::BeginFrame(void)
+{
+    if (!retired.empty())
+    {
+        // 删除被GPU使用中的缓冲时驱动会推迟释放存储，这里只需保证本帧之后不再引用
+        p_gl_state->DeleteBuffers((GLsizei)retired.size(), retired.data());
+        retired.clear();
+    }
+    // 上一帧的命令都已提交，栅栏在它们执行完后触发
+    if (fences[frame] != nullptr)
+        p_gl_funs->glDeleteSync(fences[frame]);
+    fences[frame] = p_gl_funs->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    frame = (frame + 1) % kStreamFrameCount;
+    head = 0;
+    Wait(fences[frame]);
+}
+
+StreamAllocation StreamBuffer::Allocate(size_t bytes, size_t alignment)
+{
+    if (bytes == 0)
+        return StreamAllocation{nullptr, buffer, 0, 0};
+    size_t offset = (head + alignment - 1) / alignment * alignment;
+    if (offset + bytes > frame_bytes)
+    {
+        // 本帧已分配的区间仍在旧缓冲中，旧缓冲保持映射，留到下一帧开始时删除；新缓冲的各段都未被使用
+        retired.push_back(buffer);
+        Create(std::max(frame_bytes * 2, bytes + alignment));
+        offset = 0;
+    }
+    head = offset + bytes;
+    const size_t frame_offset = frame * frame_bytes + offset;
+    return StreamAllocation{p_mapped + frame_offset, buffer, frame_offset, bytes};
+}
+
+StreamAllocation StreamBuffer::Write(const void *data, size_t bytes, size_t alignment)
+{
+    StreamAllocation allocation = Allocate(bytes, alignment);
+    if (bytes != 0)
+        std::memcpy(allocation.p_data, data, bytes);
+    return allocation;
+}
+
+void StreamBuffer::Create(size_t bytes_per_frame)
+{
+    // 段的起点按最严格的对齐要求对齐，段内的对齐才与缓冲内的对齐一致
+    const size_t frame_alignment = std::max(std::max(uniform_alignment, storage_alignment), (size_t)256);
+    frame_bytes = (bytes_per_frame + frame_alignment - 1) / frame_alignment * frame_alignment;
+    for (GLsync &fence : fences)
+    {
+        if (fence != nullptr)
+            p_gl_funs->glDeleteSync(fence);
+        fence = nullptr;
+    }
+    head = 0;
+
+    const GLsizeiptr total = (GLsizeiptr)(frame_bytes * kStreamFrameCount);
+    p_gl_funs->glCreateBuffers(1, &buffer);
+    p_gl_funs->glNamedBufferStorage(buffer, total, nullptr, kStreamMapFlags);
+    p_mapped = static_cast<unsigned char *>(p_gl_funs->glMapNamedBufferRange(buffer, 0, total, kStreamMapFlags));
+}
+
+void StreamBuffer::Wait(GLsync &fence)
+{
+    if (fence == nullptr)
+        return;
+    // 第一次等待时刷新命令，保证栅栏会被提交
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    for (;;)
+    {
+        const GLenum status = p_gl_funs->glClientWaitSync(fence, flags, 1000000);
+        if (status != GL_TIMEOUT_EXPIRED)
+            break;
+        flags = 0;
+    }
+    p_gl_funs->glDeleteSync(fence);
+    fence = nullptr;
+}
@@ -0,0 +1,124 @@
+/**
+  ******************************************************************************
+  * @file           : streambuffer.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了逐帧流式缓冲的定义。一个用glBufferStorage创建、持久且一致映射的缓冲
+  * 分为kStreamFrameCount段，每帧使用一段，帧内线性子分配；实例数据、逐帧uniform、
+  * 公告板实例和逐帧间接命令直接写入映射内存，不再每帧glBufferData重新分配存储，
+  * 驱动也不再复制一份数据。每段在下一次被使用前等待其栅栏，即GPU读完该段之前的那一帧
+  ******************************************************************************
+  * @attention
+  *     分配结果只在当前帧有效，下一次BeginFrame之后不得再写入或绑定；
+  * 一帧的用量超过一段时换用更大的缓冲，旧缓冲在下一帧开始时删除，此前分配的区间仍然有效；
+  * 每个OpenGL上下文一个，只能在上下文所在线程、上下文为当前时使用
+  ******************************************************************************
+  */
+
+#ifndef STREAMBUFFER_H
+#define STREAMBUFFER_H
+
+#include <QOpenGLFunctions_4_5_Core>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class GLStateCache;
+class QOpenGLContext;
+
+// 缓冲的段数：CPU写一帧时GPU最多还在读前两帧
+const uint32_t kStreamFrameCount = 3;
+// 每段的初始大小（字节）
+const size_t kStreamInitialFrameBytes = 1 << 20;
+
+// 一次子分配：p_data为映射内存中的地址，绑定和绘制时使用buffer和offset
+struct StreamAllocation {
+    unsigned char *p_data;
+    unsigned int buffer;
+    size_t offset;
+    size_t size;
+};
+
+class StreamBuffer
+{
+public:
+    /**
+      * @brief  获取当前OpenGL上下文的流式缓冲，首次获取时创建，上下文销毁时随之释放
+      * @author agent
+      * @param  none
+      * @retval 流式缓冲
+      */
+    static StreamBuffer &Current(void);
+
+    /**
+      * @brief  构造函数，创建并映射缓冲，查询uniform和SSBO的偏移对齐要求
+      * @author agent
+      * @param  p_context: 所属的OpenGL上下文，须为当前
+      * @retval none
+      */
+    explicit StreamBuffer(QOpenGLContext *p_context);
+    ~StreamBuffer();
+    StreamBuffer(const StreamBuffer &) = delete;
+    StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+    /**
+      * @brief  开始新的一帧：为上一帧提交的命令放置栅栏，切换到下一段并等待该段的栅栏
+      * @author agent
+      * @param  none
+      * @retval none
+      */
+    void BeginFrame(void);
+
+    /**
+      * @brief  在当前帧的段中分配一段连续内存
+      * @author agent
+      * @param  bytes: 大小（字节），为0时返回空分配
+      * @param  alignment: 偏移的对齐要求（字节），如uniform_alignment、storage_alignment
+      * @retval 分配结果
+      */
+    StreamAllocation Allocate(size_t bytes, size_t alignment = 16);
+
+    /**
+      * @brief  分配并写入数据，是Allocate后memcpy的简写
+      * @author agent
+      * @param  data: 数据首地址
+      * @param  bytes: 大小（字节）
+      * @param  alignment: 偏移的对齐要求（字节）
+      * @retval 分配结果
+      */
+    StreamAllocation Write(const void *data, size_t bytes, size_t alignment = 16);
+
+    size_t uniform_alignment;   // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    size_t storage_alignment;   // GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+
+private:
+    /**
+      * @brief  创建并持久映射缓冲，各段清空
+      * @author agent
+      * @param  bytes_per_frame: 每段的大小（字节），向上对齐
+      * @retval none
+      */
+    void Create(size_t bytes_per_frame);
+
+    /**
+      * @brief  等待并删除一个栅栏
+      * @author agent
+      * @param  fence: 栅栏，为空时直接返回
+      * @retval none
+      */
+    void Wait(GLsync &fence);
+
+    QOpenGLContext *p_context;
+    QOpenGLFunctions_4_5_Core *p_gl_funs;
+    GLStateCache *p_gl_state;
+    unsigned int buffer;
+    unsigned char *p_mapped;
+    size_t frame_bytes;                     // 每段的大小
+    uint32_t frame;                         // 当前段
+    size_t head;                            // 当前段中下一次分配的起点
+    GLsync fences[kStreamFrameCount];       // 各段最近一次使用的栅栏
+    std::vector<unsigned int> retired;      // 本帧扩容换下的缓冲，下一帧开始时删除
+};
+
+#endif // STREAMBUFFER_H
@@ -2,9 +2,15 @@
 
 in vec2 TexCoord;
 
+#ifdef FEATURE_TEXTURED
 layout(binding = 0) uniform sampler2D theTex;
+#endif
 layout(location = 0) out vec4 FragColor;
 
 void main() {
+#ifdef FEATURE_TEXTURED
     FragColor = texture(theTex, TexCoord);
+#else
+    FragColor = vec4(0.5, 0.5, 0.5, 1.0);
+#endif
 }
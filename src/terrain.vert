@@ -5,8 +5,15 @@ layout (location = 1) in vec2 VertexTexCoord;
 
 out vec2 TexCoord;
 
-uniform mat4 projection;
-uniform mat4 view;
+// 逐帧数据，由FrameUniforms每帧上传一次，布局须与FrameData一致
+layout (std140, binding = 0) uniform FrameBlock
+{
+    mat4 projection;
+    mat4 view;
+    vec4 view_pos;
+    vec4 light_position;
+    vec4 light_color;
+};
 uniform mat4 model;
 
 void main()
@@ -0,0 +1,146 @@
+#include "vertexformat.h"
+#include "mesh.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const uint32_t abs_bits = bits & 0x7FFFFFFFu;
+
+    // NaN保留为NaN，无穷大及溢出为无穷大
+    if (abs_bits > 0x7F800000u)
+        return (uint16_t)(sign | 0x7E00u);
+    if (abs_bits >= 0x477FF000u)
+        return (uint16_t)(sign | 0x7C00u);
+
+    // 非规格化半精度数（含零）：按定点数舍入
+    if (abs_bits < 0x38800000u)
+    {
+        float abs_value;
+        std::memcpy(&abs_value, &abs_bits, sizeof(abs_value));
+        return (uint16_t)(sign | (uint32_t)std::lrint(abs_value * 16777216.0f));
+    }
+
+    // 规格化数：调整指数偏置，尾数就近舍入到偶数
+    uint32_t half = abs_bits - 0x38000000u;
+    half += 0x0FFFu + ((half >> 13) & 1u);
+    return (uint16_t)(sign | (half >> 13));
+}
+
+float HalfToFloat(uint16_t half)
+{
+    const uint32_t sign = (uint32_t)(half & 0x8000u) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1Fu;
+    const uint32_t mantissa = half & 0x3FFu;
+    uint32_t bits;
+    if (exponent == 0)
+    {
+        // 零和非规格化数：尾数按2^-24定点数还原
+        float value = mantissa / 16777216.0f;
+        std::memcpy(&bits, &value, sizeof(bits));
+        bits |= sign;
+    }
+    else if (exponent == 0x1Fu)
+        bits = sign | 0x7F800000u | (mantissa << 13);
+    else
+        bits = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+void OctEncode(const QVector3D &normal, int16_t out[2])
+{
+    float l1 = std::fabs(normal.x()) + std::fabs(normal.y()) + std::fabs(normal.z());
+    if (l1 <= 0.0f)
+    {
+        out[0] = 0;
+        out[1] = 0;
+        return;
+    }
+    float x = normal.x() / l1;
+    float y = normal.y() / l1;
+    if (normal.z() < 0.0f)
+    {
+        // 下半球折叠到外侧三角形
+        float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+    out[0] = (int16_t)std::lrint(std::min(std::max(x, -1.0f), 1.0f) * 32767.0f);
+    out[1] = (int16_t)std::lrint(std::min(std::max(y, -1.0f), 1.0f) * 32767.0f);
+}
+
+QVector3D OctDecode(const int16_t encoded[2])
+{
+    float x = std::max(encoded[0] / 32767.0f, -1.0f);
+    float y = std::max(encoded[1] / 32767.0f, -1.0f);
+    float z = 1.0f - std::fabs(x) - std::fabs(y);
+    float t = std::max(-z, 0.0f);
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+    return QVector3D(x, y, z).normalized();
+}
+
+void ComputeAabb(const Vertex *vertices, size_t count, QVector3D &aabb_min, QVector3D &aabb_max)
+{
+    if (count == 0)
+    {
+        aabb_min = QVector3D(0.0f, 0.0f, 0.0f);
+        aabb_max = QVector3D(0.0f, 0.0f, 0.0f);
+        return;
+    }
+    aabb_min = aabb_max = vertices[0].Position;
+    for (size_t i = 1; i < count; i++)
+    {
+        const QVector3D &p = vertices[i].Position;
+        aabb_min = QVector3D(std::min(aabb_min.x(), p.x()), std::min(aabb_min.y(), p.y()), std::min(aabb_min.z(), p.z()));
+        aabb_max = QVector3D(std::max(aabb_max.x(), p.x()), std::max(aabb_max.y(), p.y()), std::max(aabb_max.z(), p.z()));
+    }
+}
+
+void QuantizeVertices(const Vertex *vertices, size_t count, const QVector3D &aabb_min, const QVector3D &aabb_max, std::vector<QuantizedVertex> &out)
+{
+    // 退化轴（包围盒厚度为0）的比例取0，所有顶点量化到0
+    float scale[3];
+    for (int k = 0; k < 3; k++)
+    {
+        float extent = aabb_max[k] - aabb_min[k];
+        scale[k] = extent > 0.0f ? 65535.0f / extent : 0.0f;
+    }
+
+    out.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const Vertex &v = vertices[i];
+        QuantizedVertex &q = out[i];
+        for (int k = 0; k < 3; k++)
+        {
+            float t = (v.Position[k] - aabb_min[k]) * scale[k];
+            q.position[k] = (uint16_t)std::lrint(std::min(std::max(t, 0.0f), 65535.0f));
+        }
+        q.position[3] = 0;
+        OctEncode(v.Normal, q.normal);
+        q.tex_coords[0] = FloatToHalf(v.TexCoords.x());
+        q.tex_coords[1] = FloatToHalf(v.TexCoords.y());
+    }
+}
+
+void DequantizeVertices(const QuantizedVertex *vertices, size_t count, const QVector3D &aabb_min, const QVector3D &aabb_max, std::vector<Vertex> &out)
+{
+    const QVector3D scale = (aabb_max - aabb_min) / 65535.0f;
+    out.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const QuantizedVertex &q = vertices[i];
+        Vertex &v = out[i];
+        v.Position = aabb_min + QVector3D(q.position[0], q.position[1], q.position[2]) * scale;
+        v.Normal = OctDecode(q.normal);
+        v.TexCoords = QVector2D(HalfToFloat(q.tex_coords[0]), HalfToFloat(q.tex_coords[1]));
+    }
+}
@@ -0,0 +1,111 @@
+/**
+  ******************************************************************************
+  * @file           : vertexformat.h
+  * @author         : agent
+  * @date           : 2026/10/19
+  * @brief          :
+  *     这个文件包含了上传到GPU的紧凑顶点格式定义及转换函数。
+  * 法线使用八面体编码压缩为2个16位有符号归一化整数，纹理坐标使用半精度浮点，
+  * 位置按网格包围盒量化为16位无符号归一化整数。
+  * 原始Vertex为32字节，量化格式为16字节
+  ******************************************************************************
+  * @attention
+  *     顶点着色器需要用包围盒还原位置：position = aPos * position_scale + position_offset
+  ******************************************************************************
+  */
+
+#ifndef VERTEXFORMAT_H
+#define VERTEXFORMAT_H
+
+#include <QVector2D>
+#include <QVector3D>
+#include <cstdint>
+#include <vector>
+
+struct Vertex;
+
+// 量化位置的紧凑顶点，position[3]为填充，保证法线按4字节对齐
+struct QuantizedVertex {
+    uint16_t position[4];       // GL_UNSIGNED_SHORT x3，归一化到包围盒
+    int16_t normal[2];          // GL_SHORT x2，归一化，八面体编码
+    uint16_t tex_coords[2];     // GL_HALF_FLOAT x2
+};
+static_assert(sizeof(QuantizedVertex) == 16, "QuantizedVertex must be 16 bytes");
+
+// 蒙皮数据，只有带骨骼的网格才有，与顶点一一对应，单独存放在几何池的蒙皮缓冲中
+// 每个顶点最多受4根骨骼影响，骨骼编号为模型内编号（最多256根），权重为8位归一化整数且和为255
+struct VertexSkin {
+    uint8_t joints[4];
+    uint8_t weights[4];
+};
+static_assert(sizeof(VertexSkin) == 8, "VertexSkin must be 8 bytes");
+
+/**
+  * @brief  32位浮点转半精度浮点（就近舍入，溢出为无穷大，非规格化数正确处理）
+  * @author agent
+  * @param  value: 32位浮点数
+  * @retval 半精度浮点的位模式
+  */
+uint16_t FloatToHalf(float value);
+
+/**
+  * @brief  半精度浮点转32位浮点
+  * @author agent
+  * @param  half: 半精度浮点的位模式
+  * @retval 32位浮点数
+  */
+float HalfToFloat(uint16_t half);
+
+/**
+  * @brief  单位向量的八面体编码，结果为两个16位有符号归一化整数
+  * @author agent
+  * @param  normal: 单位法向量
+  * @param  out: 输出的编码
+  * @retval none
+  */
+void OctEncode(const QVector3D &normal, int16_t out[2]);
+
+/**
+  * @brief  八面体编码的解码，与着色器中的解码一致，用于校验
+  * @author agent
+  * @param  encoded: 编码
+  * @retval 单位法向量
+  */
+QVector3D OctDecode(const int16_t encoded[2]);
+
+/**
+  * @brief  计算顶点位置的包围盒
+  * @author agent
+  * @param  vertices: 顶点首地址
+  * @param  count: 顶点数量
+  * @param  aabb_min: 输出的包围盒最小角
+  * @param  aabb_max: 输出的包围盒最大角
+  * @retval none
+  */
+void ComputeAabb(const Vertex *vertices, size_t count, QVector3D &aabb_min, QVector3D &aabb_max);
+
+/**
+  * @brief  转换为量化位置的紧凑顶点，位置相对包围盒量化
+  * @author agent
+  * @param  vertices: 顶点首地址
+  * @param  count: 顶点数量
+  * @param  aabb_min: 包围盒最小角
+  * @param  aabb_max: 包围盒最大角
+  * @param  out: 输出的紧凑顶点
+  * @retval none
+  */
+void QuantizeVertices(const Vertex *vertices, size_t count, const QVector3D &aabb_min, const QVector3D &aabb_max, std::vector<QuantizedVertex> &out);
+
+/**
+  * @brief  量化顶点还原为原始顶点，位置、法线和纹理坐标均有量化误差
+  * @author agent
+  * @param  vertices: 量化顶点首地址
+  * @param  count: 顶点数量
+  * @param  aabb_min: 量化时的包围盒最小角
+  * @param  aabb_max: 量化时的包围盒最大角
+  * @param  out: 输出的顶点
+  * @retval none
+  */
+void DequantizeVertices(const QuantizedVertex *vertices, size_t count, const QVector3D &aabb_min, const QVector3D &aabb_max, std::vector<Vertex> &out);
+
+#endif // VERTEXFORMAT_H